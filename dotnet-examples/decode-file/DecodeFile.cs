@@ -64,6 +64,7 @@ class DecodeFile
         }
 
         config.DecoderConfig.NumActivePaths = 4;
+        config.EnableStats = 0;
 
         SherpaNcnn.OnlineRecognizer recognizer = new SherpaNcnn.OnlineRecognizer(config);
 
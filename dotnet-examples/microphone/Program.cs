@@ -64,6 +64,7 @@ class Microphone
         }
 
         config.DecoderConfig.NumActivePaths = 4;
+        config.EnableStats = 0;
         config.EnableEndpoint = 1;
         config.Rule1MinTrailingSilence = 2.4F;
         config.Rule2MinTrailingSilence = 1.2F;
@@ -68,6 +68,8 @@ namespace SherpaNcnn
         public string HotwordsFile;
 
         public float HotwordsScore;
+
+        public int EnableStats;
     }
 
     // please see
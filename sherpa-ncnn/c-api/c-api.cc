@@ -22,10 +22,12 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "sherpa-ncnn/csrc/display.h"
 #include "sherpa-ncnn/csrc/model.h"
 #include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/trace.h"
 #include "sherpa-ncnn/csrc/version.h"
 
 const char *SherpaNcnnGetVersionStr() { return sherpa_ncnn::GetVersionStr(); }
@@ -78,6 +80,7 @@ SherpaNcnnRecognizer *CreateRecognizer(
   config.hotwords_score = SHERPA_NCNN_OR(in_config->hotwords_score, 1.5);
 
   config.enable_endpoint = in_config->enable_endpoint;
+  config.enable_stats = in_config->enable_stats;
 
   config.endpoint_config.rule1.min_trailing_silence =
       in_config->rule1_min_trailing_silence;
@@ -117,6 +120,21 @@ SherpaNcnnStream *CreateStream(SherpaNcnnRecognizer *p) {
 
 void DestroyStream(SherpaNcnnStream *s) { delete s; }
 
+SherpaNcnnStream *AcquireStream(SherpaNcnnRecognizer *p) {
+  auto ans = new SherpaNcnnStream;
+  ans->stream = p->recognizer->AcquireStream();
+  return ans;
+}
+
+void ReleaseStream(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
+  p->recognizer->ReleaseStream(std::move(s->stream));
+  delete s;
+}
+
+int64_t GetStreamMemoryUsage(const SherpaNcnnStream *s) {
+  return s->stream->GetMemoryUsage().Total();
+}
+
 void AcceptWaveform(SherpaNcnnStream *s, float sample_rate,
                     const float *samples, int32_t n) {
   s->stream->AcceptWaveform(sample_rate, samples, n);
@@ -177,6 +195,64 @@ int32_t IsEndpoint(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   return p->recognizer->IsEndpoint(s->stream.get());
 }
 
+const SherpaNcnnRecognizerStats *GetRecognizerStats(SherpaNcnnRecognizer *p) {
+  const sherpa_ncnn::StageStats *stats = p->recognizer->GetStageStats();
+  if (!stats) {
+    return nullptr;
+  }
+
+  std::vector<sherpa_ncnn::StageSummary> summary = stats->GetSummary();
+
+  auto ans = new SherpaNcnnRecognizerStats;
+  auto stages = new SherpaNcnnStageStats[summary.size()];
+  for (int32_t i = 0; i != static_cast<int32_t>(summary.size()); ++i) {
+    const auto &src = summary[i];
+    SherpaNcnnStageStats &dst = stages[i];
+
+    // It points to a string literal
+    dst.name = src.name;
+    dst.count = src.count;
+    dst.total_ms = src.total_ms;
+    dst.mean_ms = src.mean_ms;
+    dst.p50_ms = src.p50_ms;
+    dst.p90_ms = src.p90_ms;
+    dst.p99_ms = src.p99_ms;
+    dst.max_ms = src.max_ms;
+  }
+  ans->stages = stages;
+  ans->num_stages = static_cast<int32_t>(summary.size());
+
+  std::string text = stats->ToString();
+  auto p_text = new char[text.size() + 1];
+  std::copy(text.begin(), text.end(), p_text);
+  p_text[text.size()] = 0;
+  ans->text = p_text;
+
+  return ans;
+}
+
+void DestroyRecognizerStats(const SherpaNcnnRecognizerStats *s) {
+  if (!s) {
+    return;
+  }
+
+  delete[] s->stages;
+  delete[] s->text;
+  delete s;
+}
+
+void ResetRecognizerStats(SherpaNcnnRecognizer *p) {
+  if (auto stats = p->recognizer->GetStageStats()) {
+    stats->Reset();
+  }
+}
+
+void SherpaNcnnStartTracing() { sherpa_ncnn::StartTracing(); }
+
+int32_t SherpaNcnnStopTracing(const char *filename) {
+  return sherpa_ncnn::StopTracing(filename);
+}
+
 SherpaNcnnDisplay *CreateDisplay(int32_t max_word_per_line) {
   SherpaNcnnDisplay *ans = new SherpaNcnnDisplay;
   ans->impl = std::make_unique<sherpa_ncnn::Display>(max_word_per_line);
@@ -165,6 +165,10 @@ SHERPA_NCNN_API typedef struct SherpaNcnnRecognizerConfig {
 
   /// scale of hotwords, used only when hotwords_file is not empty
   float hotwords_score;
+
+  /// A non-zero value to record the latency of each stage of decoding.
+  /// See GetRecognizerStats().
+  int32_t enable_stats;
 } SherpaNcnnRecognizerConfig;
 
 SHERPA_NCNN_API typedef struct SherpaNcnnResult {
@@ -208,6 +212,30 @@ SHERPA_NCNN_API SherpaNcnnStream *CreateStream(SherpaNcnnRecognizer *p);
 
 SHERPA_NCNN_API void DestroyStream(SherpaNcnnStream *s);
 
+/// Like CreateStream(), but reuse a stream returned by ReleaseStream()
+/// if there is one, which is much cheaper than creating a new stream.
+///
+/// @param p A pointer returned by CreateRecognizer
+/// @return Return a pointer to a stream. The caller MUST invoke
+///         ReleaseStream() or DestroyStream() at the end to avoid memory
+///         leak.
+SHERPA_NCNN_API SherpaNcnnStream *AcquireStream(SherpaNcnnRecognizer *p);
+
+/// Return a stream to the recognizer for reuse by AcquireStream().
+/// The stream MUST NOT be used after this call.
+///
+/// @param p A pointer returned by CreateRecognizer
+/// @param s A pointer returned by CreateStream() or AcquireStream() with
+///          the same recognizer.
+SHERPA_NCNN_API void ReleaseStream(SherpaNcnnRecognizer *p,
+                                   SherpaNcnnStream *s);
+
+/// Return the number of bytes used by the features, encoder states and
+/// decoding results of a stream.
+///
+/// @param s A pointer returned by CreateStream() or AcquireStream().
+SHERPA_NCNN_API int64_t GetStreamMemoryUsage(const SherpaNcnnStream *s);
+
 /// Accept input audio samples and compute the features.
 ///
 /// @param s  A pointer returned by CreateStream().
@@ -278,6 +306,67 @@ SHERPA_NCNN_API void InputFinished(SherpaNcnnStream *s);
 SHERPA_NCNN_API int32_t IsEndpoint(SherpaNcnnRecognizer *p,
                                    SherpaNcnnStream *s);
 
+SHERPA_NCNN_API typedef struct SherpaNcnnStageStats {
+  /// Name of the stage, e.g., encoder, joiner
+  const char *name;
+
+  /// Number of times the stage was run
+  int64_t count;
+
+  /// Latencies in milliseconds. The percentiles are estimated from a
+  /// histogram and are within 12.5% of the exact values.
+  double total_ms;
+  double mean_ms;
+  double p50_ms;
+  double p90_ms;
+  double p99_ms;
+  double max_ms;
+} SherpaNcnnStageStats;
+
+SHERPA_NCNN_API typedef struct SherpaNcnnRecognizerStats {
+  /// Pointer to an array of num_stages elements
+  const SherpaNcnnStageStats *stages;
+
+  int32_t num_stages;
+
+  /// The stats formatted as a table
+  const char *text;
+} SherpaNcnnRecognizerStats;
+
+/// Get the latency of each stage of decoding, recorded across all streams
+/// of the recognizer since it was created or since the last call of
+/// ResetRecognizerStats().
+///
+/// @param p A pointer returned by CreateRecognizer().
+/// @return Return NULL if enable_stats was 0 in the config of the
+///         recognizer. Otherwise, the user has to invoke
+///         DestroyRecognizerStats() to free the returned pointer to avoid
+///         memory leak.
+SHERPA_NCNN_API const SherpaNcnnRecognizerStats *GetRecognizerStats(
+    SherpaNcnnRecognizer *p);
+
+/// Destroy the pointer returned by GetRecognizerStats().
+///
+/// @param s A pointer returned by GetRecognizerStats(). It can be NULL.
+SHERPA_NCNN_API void DestroyRecognizerStats(const SherpaNcnnRecognizerStats *s);
+
+/// Clear the stats of a recognizer. It does nothing if enable_stats was 0.
+///
+/// @param p A pointer returned by CreateRecognizer().
+SHERPA_NCNN_API void ResetRecognizerStats(SherpaNcnnRecognizer *p);
+
+/// Start recording a timeline of the work done by all threads, e.g.,
+/// feature extraction, encoder chunks and joiner calls of each stream.
+/// The spans of a previous call are discarded.
+SHERPA_NCNN_API void SherpaNcnnStartTracing();
+
+/// Stop recording and write the timeline in the Chrome trace event format.
+/// It can be opened with https://ui.perfetto.dev or chrome://tracing.
+///
+/// @param filename  Path to the JSON file.
+/// @return Return 1 on success. Return 0 if the file cannot be written.
+SHERPA_NCNN_API int32_t SherpaNcnnStopTracing(const char *filename);
+
 // for displaying results on Linux/macOS.
 SHERPA_NCNN_API typedef struct SherpaNcnnDisplay SherpaNcnnDisplay;
 
@@ -0,0 +1,149 @@
+// sherpa-ncnn/csrc/decoder-out-cache.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/decoder-out-cache.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+DecoderOutCache::DecoderOutCache(int32_t capacity)
+    : capacity_(std::max(1, capacity)) {
+  map_.reserve(capacity_);
+}
+
+size_t DecoderOutCache::KeyHash::operator()(const Key &key) const {
+  // FNV-1a
+  uint64_t h = 14695981039346656037ull;
+  for (auto i : key) {
+    h ^= static_cast<uint32_t>(i);
+    h *= 1099511628211ull;
+  }
+  return static_cast<size_t>(h);
+}
+
+ncnn::Mat DecoderOutCache::RunDecoder(Model *model,
+                                      const ncnn::Mat &decoder_input,
+                                      ExecutionContext *ctx) {
+  int32_t num_rows = decoder_input.h;
+  int32_t context_size = decoder_input.w;
+
+  std::vector<Key> keys(num_rows);
+  std::vector<ncnn::Mat> values(num_rows);
+
+  // Rows that are not in the cache. Rows with the same key are computed
+  // only once: miss_index[i] is the index into miss_rows for the i-th row.
+  std::vector<int32_t> miss_rows;
+  std::vector<int32_t> miss_index(num_rows, -1);
+  std::unordered_map<Key, int32_t, KeyHash> misses;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int32_t i = 0; i != num_rows; ++i) {
+      const int32_t *p = decoder_input.row<int32_t>(i);
+      keys[i].assign(p, p + context_size);
+
+      values[i] = Lookup(keys[i]);
+      if (!values[i].empty()) {
+        continue;
+      }
+
+      auto it = misses.find(keys[i]);
+      if (it == misses.end()) {
+        it = misses.emplace(keys[i], static_cast<int32_t>(miss_rows.size()))
+                 .first;
+        miss_rows.push_back(i);
+      }
+      miss_index[i] = it->second;
+    }
+  }
+
+  int32_t num_misses = static_cast<int32_t>(miss_rows.size());
+  num_hits_ += num_rows - num_misses;
+  num_misses_ += num_misses;
+
+  ncnn::Mat decoder_out;
+  if (num_misses > 0) {
+    ncnn::Mat input(context_size, num_misses);
+    for (int32_t k = 0; k != num_misses; ++k) {
+      const int32_t *p = decoder_input.row<int32_t>(miss_rows[k]);
+      std::copy(p, p + context_size, input.row<int32_t>(k));
+    }
+
+    decoder_out = model->RunDecoderForJoiner(input, ctx);
+
+    // decoder_out may be allocated from ctx, so the cached values are
+    // copied with the default allocator
+    std::vector<ncnn::Mat> computed(num_misses);
+    for (int32_t k = 0; k != num_misses; ++k) {
+      computed[k] = ncnn::Mat(decoder_out.w, decoder_out.row(k)).clone();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int32_t k = 0; k != num_misses; ++k) {
+      Insert(keys[miss_rows[k]], computed[k]);
+    }
+  }
+
+  int32_t decoder_dim = num_misses > 0 ? decoder_out.w : values[0].w;
+  ncnn::Mat ans(decoder_dim, num_rows);
+  for (int32_t i = 0; i != num_rows; ++i) {
+    const float *p = miss_index[i] == -1
+                         ? static_cast<const float *>(values[i])
+                         : decoder_out.row(miss_index[i]);
+    std::copy(p, p + decoder_dim, ans.row(i));
+  }
+
+  return ans;
+}
+
+float DecoderOutCache::HitRate() const {
+  int64_t hits = num_hits_;
+  int64_t total = hits + num_misses_;
+  return total > 0 ? static_cast<float>(hits) / total : 0;
+}
+
+void DecoderOutCache::ResetCounters() {
+  num_hits_ = 0;
+  num_misses_ = 0;
+}
+
+void DecoderOutCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  map_.clear();
+  list_.clear();
+}
+
+ncnn::Mat DecoderOutCache::Lookup(const Key &key) {
+  auto it = map_.find(key);
+  if (it == map_.end()) {
+    return {};
+  }
+
+  list_.splice(list_.begin(), list_, it->second);
+  return it->second->second;
+}
+
+void DecoderOutCache::Insert(Key key, ncnn::Mat value) {
+  auto it = map_.find(key);
+  if (it != map_.end()) {
+    // Another thread has inserted it
+    list_.splice(list_.begin(), list_, it->second);
+    return;
+  }
+
+  if (static_cast<int32_t>(list_.size()) >= capacity_) {
+    map_.erase(list_.back().first);
+    list_.pop_back();
+  }
+
+  list_.emplace_front(std::move(key), std::move(value));
+  map_.emplace(list_.front().first, list_.begin());
+}
+
+}  // namespace sherpa_ncnn
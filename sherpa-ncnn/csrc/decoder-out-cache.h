@@ -0,0 +1,100 @@
+// sherpa-ncnn/csrc/decoder-out-cache.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_DECODER_OUT_CACHE_H_
+#define SHERPA_NCNN_CSRC_DECODER_OUT_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/execution-context.h"
+
+namespace sherpa_ncnn {
+
+class Model;
+
+/**
+ * A bounded LRU cache from the last ContextSize() tokens to the output
+ * of the decoder network, as returned by Model::RunDecoderForJoiner().
+ *
+ * The decoder of a stateless transducer sees only the last ContextSize()
+ * tokens, so its output can be shared by all hypotheses, and all streams,
+ * that end with the same tokens.
+ *
+ * It is thread-safe. A Recognizer owns one and shares it among all of its
+ * streams.
+ */
+class DecoderOutCache {
+ public:
+  // @param capacity Maximum number of entries to keep
+  explicit DecoderOutCache(int32_t capacity);
+
+  DecoderOutCache(const DecoderOutCache &) = delete;
+  DecoderOutCache &operator=(const DecoderOutCache &) = delete;
+
+  /** Run Model::RunDecoderForJoiner() for the rows of decoder_input that
+   * are not in the cache and return the output for all rows.
+   *
+   * @param model  The model that owns the decoder network. All calls of
+   *               an object must use the same model.
+   * @param decoder_input  A 2-D mat of shape (num_rows, context_size).
+   * @param ctx  Used for running the decoder network. It can be nullptr.
+   *
+   * @return Return a 2-D mat of shape (num_rows, decoder_dim). It is
+   *         allocated with the default allocator.
+   */
+  ncnn::Mat RunDecoder(Model *model, const ncnn::Mat &decoder_input,
+                       ExecutionContext *ctx);
+
+  // Number of rows found in the cache
+  int64_t NumHits() const { return num_hits_; }
+
+  // Number of rows for which we have run the decoder network
+  int64_t NumMisses() const { return num_misses_; }
+
+  // Return NumHits() / (NumHits() + NumMisses()), or 0 if both are 0.
+  float HitRate() const;
+
+  void ResetCounters();
+
+  // Remove all entries
+  void Clear();
+
+ private:
+  using Key = std::vector<int32_t>;
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  using List = std::list<std::pair<Key, ncnn::Mat>>;
+
+  // Return the cached value of key and move it to the front of the list.
+  // Return an empty mat if key is not in the cache. The caller holds mutex_.
+  ncnn::Mat Lookup(const Key &key);
+
+  // The caller holds mutex_.
+  void Insert(Key key, ncnn::Mat value);
+
+ private:
+  int32_t capacity_;
+
+  std::mutex mutex_;  // It protects list_ and map_
+  // The most recently used entry is at the front
+  List list_;
+  std::unordered_map<Key, List::iterator, KeyHash> map_;
+
+  std::atomic<int64_t> num_hits_{0};
+  std::atomic<int64_t> num_misses_{0};
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_DECODER_OUT_CACHE_H_
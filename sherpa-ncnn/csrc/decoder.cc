@@ -22,6 +22,8 @@
 #include <sstream>
 #include <string>
 
+#include "sherpa-ncnn/csrc/stream.h"
+
 namespace sherpa_ncnn {
 
 std::string DecoderConfig::ToString() const {
@@ -29,9 +31,25 @@ std::string DecoderConfig::ToString() const {
 
   os << "DecoderConfig(";
   os << "method=\"" << method << "\", ";
-  os << "num_active_paths=" << num_active_paths << ")";
+  os << "num_active_paths=" << num_active_paths << ", ";
+  os << "decoder_out_cache_size=" << decoder_out_cache_size << ", ";
+  os << "greedy_batch_frames=" << (greedy_batch_frames ? "True" : "False")
+     << ", ";
+  os << "max_chunks_per_decode=" << max_chunks_per_decode << ", ";
+  os << "pipeline=" << (pipeline ? "True" : "False") << ")";
 
   return os.str();
 }
 
+void Decoder::Decode(ncnn::Mat *encoder_out, Stream **ss, int32_t n) {
+  for (int32_t i = 0; i != n; ++i) {
+    Stream *s = ss[i];
+    if (s->GetContextGraph()) {
+      Decode(encoder_out[i], s, &s->GetResult());
+    } else {
+      Decode(encoder_out[i], &s->GetResult());
+    }
+  }
+}
+
 }  // namespace sherpa_ncnn
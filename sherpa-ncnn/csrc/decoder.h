@@ -24,6 +24,7 @@
 
 #include "mat.h"  // NOLINT
 #include "sherpa-ncnn/csrc/hypothesis.h"
+#include "sherpa-ncnn/csrc/stage-stats.h"
 
 namespace sherpa_ncnn {
 
@@ -33,6 +34,31 @@ struct DecoderConfig {
 
   int32_t num_active_paths = 4;  // only used by modified beam search
 
+  // Maximum number of decoder outputs cached by the recognizer, shared by
+  // all of its streams. 0 disables the cache.
+  int32_t decoder_out_cache_size = 4096;
+
+  // Only used by greedy search. If true, the joiner is run on all remaining
+  // frames of a chunk at once and is re-run only after a non-blank token is
+  // emitted. It gives the same result with fewer joiner invocations.
+  bool greedy_batch_frames = false;
+
+  // Maximum number of chunks of a stream decoded by one call of
+  // Recognizer::DecodeStream() or Recognizer::DecodeStreams() if more than
+  // one chunk of the stream is ready, e.g., if the stream has fallen behind
+  // or a whole file is decoded. The encoder is run for all of them with a
+  // single call of Model::RunEncoderChunks(). 1 decodes exactly one chunk
+  // per call.
+  int32_t max_chunks_per_decode = 1;
+
+  // If true, Recognizer::DecodeStream() runs the encoder and returns
+  // without waiting for the search, which runs on a thread of the stream.
+  // The encoder of the next chunk thus runs while the search of the
+  // previous one is running. Recognizer::GetResult(), IsEndpoint() and
+  // Reset() wait for the pending searches. It is meant for a few
+  // latency-sensitive streams, since every stream gets its own thread.
+  bool pipeline = false;
+
   DecoderConfig() = default;
 
   DecoderConfig(const std::string &method, int32_t num_active_paths)
@@ -95,6 +121,27 @@ class Decoder {
     NCNN_LOGE("Please override it!");
     exit(-1);
   }
+
+  /** Run transducer search for a batch of streams.
+   *
+   * The search is frame synchronous: at each frame, the hypotheses of all
+   * streams are stacked so that the decoder and joiner networks are invoked
+   * once for the whole batch.
+   *
+   * @param encoder_out  encoder_out[i] is the output of the encoder for ss[i].
+   *                     All of them must have the same number of frames.
+   * @param ss  The result of each stream is modified in-place.
+   * @param n  Number of streams.
+   */
+  virtual void Decode(ncnn::Mat *encoder_out, Stream **ss, int32_t n);
+
+  /** Record the time spent in the decoder and joiner networks and in
+   * LogSoftmaxTopk() to stats. It is not owned. nullptr disables it.
+   */
+  void SetStageStats(StageStats *stats) { stats_ = stats; }
+
+ protected:
+  StageStats *stats_ = nullptr;
 };
 
 }  // namespace sherpa_ncnn
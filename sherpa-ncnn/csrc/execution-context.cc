@@ -0,0 +1,29 @@
+// sherpa-ncnn/csrc/execution-context.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/execution-context.h"
+
+namespace sherpa_ncnn {
+
+ncnn::Extractor ExecutionContext::CreateExtractor(const ncnn::Net &net) {
+  ncnn::Extractor ex = net.create_extractor();
+  ex.set_blob_allocator(&blob_allocator_);
+  ex.set_workspace_allocator(&workspace_allocator_);
+  return ex;
+}
+
+void ExecutionContext::Clear() {
+  blob_allocator_.clear();
+  workspace_allocator_.clear();
+}
+
+ncnn::Extractor CreateExtractor(const ncnn::Net &net, ExecutionContext *ctx) {
+  if (ctx) {
+    return ctx->CreateExtractor(net);
+  }
+
+  return net.create_extractor();
+}
+
+}  // namespace sherpa_ncnn
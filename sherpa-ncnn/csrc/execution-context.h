@@ -0,0 +1,50 @@
+// sherpa-ncnn/csrc/execution-context.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_EXECUTION_CONTEXT_H_
+#define SHERPA_NCNN_CSRC_EXECUTION_CONTEXT_H_
+
+#include "net.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/**
+ * Memory that is reused across invocations of the networks.
+ *
+ * By default, every blob produced by an extractor is allocated from the heap.
+ * Extractors created by this class take blobs and workspace memory from
+ * pool allocators instead, so once the pools are warm, running the networks
+ * does not allocate from the heap any more.
+ *
+ * The pool allocators are not thread-safe: an object of this class must not
+ * be used by two threads at the same time. Every Stream owns one, which is
+ * used while the stream is being decoded.
+ *
+ * Mats allocated from a context must be released before the context is
+ * destroyed.
+ */
+class ExecutionContext {
+ public:
+  ExecutionContext() = default;
+  ExecutionContext(const ExecutionContext &) = delete;
+  ExecutionContext &operator=(const ExecutionContext &) = delete;
+
+  // Create an extractor of the given network that allocates memory from
+  // this context.
+  ncnn::Extractor CreateExtractor(const ncnn::Net &net);
+
+  // Return cached memory that is not in use to the system.
+  void Clear();
+
+ private:
+  ncnn::UnlockedPoolAllocator blob_allocator_;
+  ncnn::UnlockedPoolAllocator workspace_allocator_;
+};
+
+// If ctx is nullptr, the returned extractor uses the allocators from net.opt.
+ncnn::Extractor CreateExtractor(const ncnn::Net &net, ExecutionContext *ctx);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_EXECUTION_CONTEXT_H_
@@ -0,0 +1,558 @@
+// sherpa-ncnn/csrc/fast-fbank.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/fast-fbank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "platform.h"  // NOLINT
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SHERPA_NCNN_FAST_FBANK_NEON 1
+#elif (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// Compiled for AVX2 regardless of the compiler flags. It is used only if
+// the CPU supports it.
+#define SHERPA_NCNN_FAST_FBANK_AVX2 1
+#define SHERPA_NCNN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(__AVX2__)
+#include <immintrin.h>
+#define SHERPA_NCNN_FAST_FBANK_AVX2 1
+#define SHERPA_NCNN_TARGET_AVX2
+#endif
+
+namespace sherpa_ncnn {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Same as in knf::MelBanks
+inline float MelScale(float freq) {
+  return 1127.0f * logf(1.0f + freq / 700.0f);
+}
+
+// Combine pairs of complex transforms of size h into transforms of size
+// 2h, i.e., one stage of a radix-2 decimation-in-time FFT. (ar, ai) and
+// (br, bi) are the first and the second transform of a pair, and
+// (wr, wi) are the h twiddle factors of the stage.
+void ButterfliesScalar(float *ar, float *ai, float *br, float *bi,
+                       const float *wr, const float *wi, int32_t start,
+                       int32_t h) {
+  for (int32_t j = start; j < h; ++j) {
+    float tr = br[j] * wr[j] - bi[j] * wi[j];
+    float ti = br[j] * wi[j] + bi[j] * wr[j];
+    br[j] = ar[j] - tr;
+    bi[j] = ai[j] - ti;
+    ar[j] += tr;
+    ai[j] += ti;
+  }
+}
+
+// Compute the power spectrum of the real FFT of size 2 * m from the complex
+// FFT (re, im) of size m of its even and odd samples. See
+// FastFbankComputer::Compute(). Bins [start, m) are computed.
+void PowerSpectrumScalar(const float *re, const float *im, const float *wr,
+                         const float *wi, int32_t start, int32_t m,
+                         float *power) {
+  for (int32_t k = std::max(start, 1); k < m; ++k) {
+    // (a + conj(b)) / 2 and -i * (a - conj(b)) / 2
+    float er = 0.5f * (re[k] + re[m - k]);
+    float ei = 0.5f * (im[k] - im[m - k]);
+    float orr = 0.5f * (im[k] + im[m - k]);
+    float oi = -0.5f * (re[k] - re[m - k]);
+
+    float xr = er + wr[k] * orr - wi[k] * oi;
+    float xi = ei + wr[k] * oi + wi[k] * orr;
+    power[k] = xr * xr + xi * xi;
+  }
+}
+
+float DotProductScalar(const float *a, const float *b, int32_t start,
+                       int32_t n) {
+  float sum = 0;
+  for (int32_t i = start; i < n; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+void LogScalar(float *x, int32_t start, int32_t n) {
+  for (int32_t i = start; i < n; ++i) {
+    x[i] = std::log(std::max(x[i], std::numeric_limits<float>::epsilon()));
+  }
+}
+
+// log() for 4 (NEON) or 8 (AVX2) positive floats. It is the polynomial
+// approximation from Cephes, as used in sse_mathfun.h
+constexpr float kLogSqrtHalf = 0.707106781186547524f;
+constexpr float kLogP0 = 7.0376836292E-2f;
+constexpr float kLogP1 = -1.1514610310E-1f;
+constexpr float kLogP2 = 1.1676998740E-1f;
+constexpr float kLogP3 = -1.2420140846E-1f;
+constexpr float kLogP4 = 1.4249322787E-1f;
+constexpr float kLogP5 = -1.6668057665E-1f;
+constexpr float kLogP6 = 2.0000714765E-1f;
+constexpr float kLogP7 = -2.4999993993E-1f;
+constexpr float kLogP8 = 3.3333331174E-1f;
+constexpr float kLogQ1 = -2.12194440e-4f;
+constexpr float kLogQ2 = 0.693359375f;
+
+#if SHERPA_NCNN_FAST_FBANK_AVX2
+
+SHERPA_NCNN_TARGET_AVX2 void ButterfliesAvx2(float *ar, float *ai, float *br,
+                                             float *bi, const float *wr,
+                                             const float *wi, int32_t h) {
+  int32_t j = 0;
+  for (; j + 8 <= h; j += 8) {
+    __m256 vbr = _mm256_loadu_ps(br + j);
+    __m256 vbi = _mm256_loadu_ps(bi + j);
+    __m256 vwr = _mm256_loadu_ps(wr + j);
+    __m256 vwi = _mm256_loadu_ps(wi + j);
+
+    __m256 tr =
+        _mm256_sub_ps(_mm256_mul_ps(vbr, vwr), _mm256_mul_ps(vbi, vwi));
+    __m256 ti =
+        _mm256_add_ps(_mm256_mul_ps(vbr, vwi), _mm256_mul_ps(vbi, vwr));
+
+    __m256 var = _mm256_loadu_ps(ar + j);
+    __m256 vai = _mm256_loadu_ps(ai + j);
+    _mm256_storeu_ps(br + j, _mm256_sub_ps(var, tr));
+    _mm256_storeu_ps(bi + j, _mm256_sub_ps(vai, ti));
+    _mm256_storeu_ps(ar + j, _mm256_add_ps(var, tr));
+    _mm256_storeu_ps(ai + j, _mm256_add_ps(vai, ti));
+  }
+
+  ButterfliesScalar(ar, ai, br, bi, wr, wi, j, h);
+}
+
+SHERPA_NCNN_TARGET_AVX2 inline __m256 Reverse256(__m256 x) {
+  return _mm256_permutevar8x32_ps(x, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+SHERPA_NCNN_TARGET_AVX2 void PowerSpectrumAvx2(const float *re,
+                                               const float *im,
+                                               const float *wr,
+                                               const float *wi, int32_t m,
+                                               float *power) {
+  __m256 half = _mm256_set1_ps(0.5f);
+
+  int32_t k = 1;
+  for (; k + 8 <= m; k += 8) {
+    __m256 ar = _mm256_loadu_ps(re + k);
+    __m256 ai = _mm256_loadu_ps(im + k);
+    // Entries m - k, m - k - 1, ..., m - k - 7
+    __m256 br = Reverse256(_mm256_loadu_ps(re + m - k - 7));
+    __m256 bi = Reverse256(_mm256_loadu_ps(im + m - k - 7));
+
+    __m256 er = _mm256_mul_ps(half, _mm256_add_ps(ar, br));
+    __m256 ei = _mm256_mul_ps(half, _mm256_sub_ps(ai, bi));
+    __m256 orr = _mm256_mul_ps(half, _mm256_add_ps(ai, bi));
+    __m256 oi = _mm256_mul_ps(half, _mm256_sub_ps(br, ar));
+
+    __m256 vwr = _mm256_loadu_ps(wr + k);
+    __m256 vwi = _mm256_loadu_ps(wi + k);
+
+    __m256 xr = _mm256_add_ps(
+        er, _mm256_sub_ps(_mm256_mul_ps(vwr, orr), _mm256_mul_ps(vwi, oi)));
+    __m256 xi = _mm256_add_ps(
+        ei, _mm256_add_ps(_mm256_mul_ps(vwr, oi), _mm256_mul_ps(vwi, orr)));
+
+    _mm256_storeu_ps(power + k, _mm256_add_ps(_mm256_mul_ps(xr, xr),
+                                              _mm256_mul_ps(xi, xi)));
+  }
+
+  PowerSpectrumScalar(re, im, wr, wi, k, m, power);
+}
+
+SHERPA_NCNN_TARGET_AVX2 float DotProductAvx2(const float *a, const float *b,
+                                             int32_t n) {
+  __m256 sum = _mm256_setzero_ps();
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    sum = _mm256_add_ps(
+        sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+
+  __m128 s =
+      _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+
+  return _mm_cvtss_f32(s) + DotProductScalar(a, b, i, n);
+}
+
+SHERPA_NCNN_TARGET_AVX2 inline __m256 Log256(__m256 x) {
+  // x = m * 2^e, where 0.5 <= m < 1
+  __m256i e = _mm256_srli_epi32(_mm256_castps_si256(x), 23);
+  x = _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x807fffff)));
+  x = _mm256_or_ps(x, _mm256_set1_ps(0.5f));
+
+  e = _mm256_sub_epi32(e, _mm256_set1_epi32(0x7f));
+  __m256 fe = _mm256_add_ps(_mm256_cvtepi32_ps(e), _mm256_set1_ps(1.0f));
+
+  // If m < sqrt(0.5), use 2m - 1 and e - 1 instead of m - 1 and e
+  __m256 mask = _mm256_cmp_ps(x, _mm256_set1_ps(kLogSqrtHalf), _CMP_LT_OS);
+  __m256 t = _mm256_and_ps(x, mask);
+  x = _mm256_sub_ps(x, _mm256_set1_ps(1.0f));
+  fe = _mm256_sub_ps(fe, _mm256_and_ps(_mm256_set1_ps(1.0f), mask));
+  x = _mm256_add_ps(x, t);
+
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 y = _mm256_set1_ps(kLogP0);
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kLogP1));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kLogP2));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kLogP3));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kLogP4));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kLogP5));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kLogP6));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kLogP7));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kLogP8));
+  y = _mm256_mul_ps(_mm256_mul_ps(y, x), z);
+
+  y = _mm256_add_ps(y, _mm256_mul_ps(fe, _mm256_set1_ps(kLogQ1)));
+  y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+  x = _mm256_add_ps(x, y);
+  return _mm256_add_ps(x, _mm256_mul_ps(fe, _mm256_set1_ps(kLogQ2)));
+}
+
+SHERPA_NCNN_TARGET_AVX2 void LogAvx2(float *x, int32_t n) {
+  __m256 eps = _mm256_set1_ps(std::numeric_limits<float>::epsilon());
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_max_ps(_mm256_loadu_ps(x + i), eps);
+    _mm256_storeu_ps(x + i, Log256(v));
+  }
+
+  LogScalar(x, i, n);
+}
+
+bool CpuSupportsAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+  static const bool ans = __builtin_cpu_supports("avx2");
+  return ans;
+#else
+  return true;  // compiled with /arch:AVX2
+#endif
+}
+
+#endif  // SHERPA_NCNN_FAST_FBANK_AVX2
+
+#if SHERPA_NCNN_FAST_FBANK_NEON
+
+void ButterfliesNeon(float *ar, float *ai, float *br, float *bi,
+                     const float *wr, const float *wi, int32_t h) {
+  int32_t j = 0;
+  for (; j + 4 <= h; j += 4) {
+    float32x4_t vbr = vld1q_f32(br + j);
+    float32x4_t vbi = vld1q_f32(bi + j);
+    float32x4_t vwr = vld1q_f32(wr + j);
+    float32x4_t vwi = vld1q_f32(wi + j);
+
+    float32x4_t tr = vmlsq_f32(vmulq_f32(vbr, vwr), vbi, vwi);
+    float32x4_t ti = vmlaq_f32(vmulq_f32(vbr, vwi), vbi, vwr);
+
+    float32x4_t var = vld1q_f32(ar + j);
+    float32x4_t vai = vld1q_f32(ai + j);
+    vst1q_f32(br + j, vsubq_f32(var, tr));
+    vst1q_f32(bi + j, vsubq_f32(vai, ti));
+    vst1q_f32(ar + j, vaddq_f32(var, tr));
+    vst1q_f32(ai + j, vaddq_f32(vai, ti));
+  }
+
+  ButterfliesScalar(ar, ai, br, bi, wr, wi, j, h);
+}
+
+inline float32x4_t Reverse128(float32x4_t x) {
+  x = vrev64q_f32(x);
+  return vcombine_f32(vget_high_f32(x), vget_low_f32(x));
+}
+
+void PowerSpectrumNeon(const float *re, const float *im, const float *wr,
+                       const float *wi, int32_t m, float *power) {
+  float32x4_t half = vdupq_n_f32(0.5f);
+
+  int32_t k = 1;
+  for (; k + 4 <= m; k += 4) {
+    float32x4_t ar = vld1q_f32(re + k);
+    float32x4_t ai = vld1q_f32(im + k);
+    // Entries m - k, m - k - 1, m - k - 2, m - k - 3
+    float32x4_t br = Reverse128(vld1q_f32(re + m - k - 3));
+    float32x4_t bi = Reverse128(vld1q_f32(im + m - k - 3));
+
+    float32x4_t er = vmulq_f32(half, vaddq_f32(ar, br));
+    float32x4_t ei = vmulq_f32(half, vsubq_f32(ai, bi));
+    float32x4_t orr = vmulq_f32(half, vaddq_f32(ai, bi));
+    float32x4_t oi = vmulq_f32(half, vsubq_f32(br, ar));
+
+    float32x4_t vwr = vld1q_f32(wr + k);
+    float32x4_t vwi = vld1q_f32(wi + k);
+
+    float32x4_t xr = vmlsq_f32(vmlaq_f32(er, vwr, orr), vwi, oi);
+    float32x4_t xi = vmlaq_f32(vmlaq_f32(ei, vwr, oi), vwi, orr);
+
+    vst1q_f32(power + k, vmlaq_f32(vmulq_f32(xr, xr), xi, xi));
+  }
+
+  PowerSpectrumScalar(re, im, wr, wi, k, m, power);
+}
+
+float DotProductNeon(const float *a, const float *b, int32_t n) {
+  float32x4_t sum = vdupq_n_f32(0);
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    sum = vmlaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+  }
+
+  float32x2_t s = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+  s = vpadd_f32(s, s);
+
+  return vget_lane_f32(s, 0) + DotProductScalar(a, b, i, n);
+}
+
+inline float32x4_t Log128(float32x4_t x) {
+  // x = m * 2^e, where 0.5 <= m < 1
+  int32x4_t e = vreinterpretq_s32_u32(
+      vshrq_n_u32(vreinterpretq_u32_f32(x), 23));
+  x = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(x),
+                                      vdupq_n_u32(0x807fffff)));
+  x = vreinterpretq_f32_u32(vorrq_u32(
+      vreinterpretq_u32_f32(x), vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+
+  e = vsubq_s32(e, vdupq_n_s32(0x7f));
+  float32x4_t fe = vaddq_f32(vcvtq_f32_s32(e), vdupq_n_f32(1.0f));
+
+  // If m < sqrt(0.5), use 2m - 1 and e - 1 instead of m - 1 and e
+  uint32x4_t mask = vcltq_f32(x, vdupq_n_f32(kLogSqrtHalf));
+  float32x4_t t =
+      vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(x), mask));
+  x = vsubq_f32(x, vdupq_n_f32(1.0f));
+  fe = vsubq_f32(fe, vreinterpretq_f32_u32(vandq_u32(
+                         vreinterpretq_u32_f32(vdupq_n_f32(1.0f)), mask)));
+  x = vaddq_f32(x, t);
+
+  float32x4_t z = vmulq_f32(x, x);
+  float32x4_t y = vdupq_n_f32(kLogP0);
+  y = vmlaq_f32(vdupq_n_f32(kLogP1), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kLogP2), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kLogP3), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kLogP4), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kLogP5), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kLogP6), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kLogP7), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kLogP8), y, x);
+  y = vmulq_f32(vmulq_f32(y, x), z);
+
+  y = vmlaq_f32(y, fe, vdupq_n_f32(kLogQ1));
+  y = vmlsq_f32(y, z, vdupq_n_f32(0.5f));
+  x = vaddq_f32(x, y);
+  return vmlaq_f32(x, fe, vdupq_n_f32(kLogQ2));
+}
+
+void LogNeon(float *x, int32_t n) {
+  float32x4_t eps = vdupq_n_f32(std::numeric_limits<float>::epsilon());
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(x + i, Log128(vmaxq_f32(vld1q_f32(x + i), eps)));
+  }
+
+  LogScalar(x, i, n);
+}
+
+#endif  // SHERPA_NCNN_FAST_FBANK_NEON
+
+void Butterflies(float *ar, float *ai, float *br, float *bi, const float *wr,
+                 const float *wi, int32_t h) {
+#if SHERPA_NCNN_FAST_FBANK_AVX2
+  if (CpuSupportsAvx2()) {
+    ButterfliesAvx2(ar, ai, br, bi, wr, wi, h);
+    return;
+  }
+#elif SHERPA_NCNN_FAST_FBANK_NEON
+  ButterfliesNeon(ar, ai, br, bi, wr, wi, h);
+  return;
+#endif
+
+  ButterfliesScalar(ar, ai, br, bi, wr, wi, 0, h);
+}
+
+void PowerSpectrum(const float *re, const float *im, const float *wr,
+                   const float *wi, int32_t m, float *power) {
+#if SHERPA_NCNN_FAST_FBANK_AVX2
+  if (CpuSupportsAvx2()) {
+    PowerSpectrumAvx2(re, im, wr, wi, m, power);
+    return;
+  }
+#elif SHERPA_NCNN_FAST_FBANK_NEON
+  PowerSpectrumNeon(re, im, wr, wi, m, power);
+  return;
+#endif
+
+  PowerSpectrumScalar(re, im, wr, wi, 1, m, power);
+}
+
+float DotProduct(const float *a, const float *b, int32_t n) {
+#if SHERPA_NCNN_FAST_FBANK_AVX2
+  if (CpuSupportsAvx2()) {
+    return DotProductAvx2(a, b, n);
+  }
+#elif SHERPA_NCNN_FAST_FBANK_NEON
+  return DotProductNeon(a, b, n);
+#endif
+
+  return DotProductScalar(a, b, 0, n);
+}
+
+void Log(float *x, int32_t n) {
+#if SHERPA_NCNN_FAST_FBANK_AVX2
+  if (CpuSupportsAvx2()) {
+    LogAvx2(x, n);
+    return;
+  }
+#elif SHERPA_NCNN_FAST_FBANK_NEON
+  LogNeon(x, n);
+  return;
+#endif
+
+  LogScalar(x, 0, n);
+}
+
+}  // namespace
+
+FastFbankComputer::FastFbankComputer(const knf::FbankOptions &opts)
+    : n_(opts.frame_opts.PaddedWindowSize()) {
+  if (opts.use_energy || !opts.use_power || !opts.use_log_fbank ||
+      opts.mel_opts.htk_mode) {
+    NCNN_LOGE("FastFbankComputer does not support the given options:\n%s",
+              opts.ToString().c_str());
+    exit(-1);
+  }
+
+  if (n_ < 16 || (n_ & (n_ - 1)) != 0) {
+    NCNN_LOGE("The padded window size %d is not a power of 2", n_);
+    exit(-1);
+  }
+
+  int32_t m = n_ / 2;
+
+  int32_t num_bits = 0;
+  while ((1 << num_bits) < m) {
+    ++num_bits;
+  }
+
+  bit_reverse_.resize(m);
+  for (int32_t i = 0; i != m; ++i) {
+    int32_t r = 0;
+    for (int32_t b = 0; b != num_bits; ++b) {
+      r |= ((i >> b) & 1) << (num_bits - 1 - b);
+    }
+    bit_reverse_[i] = r;
+  }
+
+  twiddle_re_.resize(m - 1);
+  twiddle_im_.resize(m - 1);
+  for (int32_t h = 1; h < m; h *= 2) {
+    for (int32_t j = 0; j != h; ++j) {
+      double a = -kPi * j / h;
+      twiddle_re_[h - 1 + j] = std::cos(a);
+      twiddle_im_[h - 1 + j] = std::sin(a);
+    }
+  }
+
+  post_re_.resize(m);
+  post_im_.resize(m);
+  for (int32_t k = 0; k != m; ++k) {
+    double a = -2 * kPi * k / n_;
+    post_re_[k] = std::cos(a);
+    post_im_[k] = std::sin(a);
+  }
+
+  // The same as knf::MelBanks, but only the non-zero weights are kept
+  const auto &mel_opts = opts.mel_opts;
+  float sample_freq = opts.frame_opts.samp_freq;
+  float nyquist = 0.5f * sample_freq;
+  float high_freq = mel_opts.high_freq > 0.0f ? mel_opts.high_freq
+                                              : nyquist + mel_opts.high_freq;
+  float fft_bin_width = sample_freq / n_;
+  float mel_low_freq = MelScale(mel_opts.low_freq);
+  float mel_high_freq = MelScale(high_freq);
+  float mel_freq_delta =
+      (mel_high_freq - mel_low_freq) / (mel_opts.num_bins + 1);
+
+  mel_offsets_.push_back(0);
+  for (int32_t bin = 0; bin != mel_opts.num_bins; ++bin) {
+    float left_mel = mel_low_freq + bin * mel_freq_delta;
+    float center_mel = mel_low_freq + (bin + 1) * mel_freq_delta;
+    float right_mel = mel_low_freq + (bin + 2) * mel_freq_delta;
+
+    int32_t first_bin = -1;
+    for (int32_t i = 0; i != m; ++i) {
+      float mel = MelScale(fft_bin_width * i);
+      if (mel > left_mel && mel < right_mel) {
+        float weight = mel <= center_mel
+                           ? (mel - left_mel) / (center_mel - left_mel)
+                           : (right_mel - mel) / (right_mel - center_mel);
+        if (first_bin == -1) {
+          first_bin = i;
+        }
+
+        // Zeros between the first and the last non-zero weight are kept
+        mel_weights_.resize(mel_offsets_.back() + i - first_bin + 1);
+        mel_weights_.back() = weight;
+      }
+    }
+
+    mel_first_bin_.push_back(std::max(first_bin, 0));
+    mel_offsets_.push_back(mel_weights_.size());
+  }
+
+  re_.resize(m);
+  im_.resize(m);
+  power_.resize(m);
+}
+
+void FastFbankComputer::Compute(const float *window, float *feature) {
+  int32_t m = n_ / 2;
+  float *re = re_.data();
+  float *im = im_.data();
+
+  // The even and the odd samples are the real and the imaginary parts of
+  // a complex signal of size m. They are put in bit-reversed order for the
+  // in-place FFT.
+  for (int32_t i = 0; i != m; ++i) {
+    re[bit_reverse_[i]] = window[2 * i];
+    im[bit_reverse_[i]] = window[2 * i + 1];
+  }
+
+  for (int32_t h = 1; h < m; h *= 2) {
+    const float *wr = twiddle_re_.data() + h - 1;
+    const float *wi = twiddle_im_.data() + h - 1;
+    for (int32_t s = 0; s < m; s += 2 * h) {
+      Butterflies(re + s, im + s, re + s + h, im + s + h, wr, wi, h);
+    }
+  }
+
+  // Bin k of the real FFT is E[k] + exp(-2 pi i k / n) * O[k], where E and
+  // O are the FFTs of the even and the odd samples. They are computed from
+  // bins k and m - k of the complex FFT. Bin 0 is real.
+  float *power = power_.data();
+  power[0] = (re[0] + im[0]) * (re[0] + im[0]);
+  PowerSpectrum(re, im, post_re_.data(), post_im_.data(), m, power);
+
+  int32_t dim = Dim();
+  for (int32_t i = 0; i != dim; ++i) {
+    const float *w = mel_weights_.data() + mel_offsets_[i];
+    int32_t n = mel_offsets_[i + 1] - mel_offsets_[i];
+    feature[i] = DotProduct(w, power + mel_first_bin_[i], n);
+  }
+
+  Log(feature, dim);
+}
+
+}  // namespace sherpa_ncnn
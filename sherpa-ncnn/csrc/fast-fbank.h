@@ -0,0 +1,75 @@
+// sherpa-ncnn/csrc/fast-fbank.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_FAST_FBANK_H_
+#define SHERPA_NCNN_CSRC_FAST_FBANK_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "kaldi-native-fbank/csrc/feature-fbank.h"
+
+namespace sherpa_ncnn {
+
+/**
+ * A drop-in replacement for knf::FbankComputer::Compute() for the options
+ * used by FeatureExtractor, i.e., log mel filterbank energies computed
+ * from the power spectrum, without the energy term.
+ *
+ * It uses a real FFT computed as a complex FFT of half the size, a mel
+ * filterbank that stores only the non-zero weights of each triangle, and
+ * a polynomial approximation of log(). The FFT butterflies, the power
+ * spectrum, the mel filterbank and log() use AVX2 on x86 CPUs that support
+ * it and NEON on ARM.
+ *
+ * The results are the same as those of knf::FbankComputer up to rounding
+ * errors, i.e., a relative error of about 1e-5 in the log energies.
+ */
+class FastFbankComputer {
+ public:
+  explicit FastFbankComputer(const knf::FbankOptions &opts);
+
+  int32_t Dim() const { return static_cast<int32_t>(mel_first_bin_.size()); }
+
+  /**
+   * @param window  opts.frame_opts.PaddedWindowSize() floats returned by
+   *                knf::ExtractWindow(). It is not modified.
+   * @param feature  On return, it contains Dim() log mel energies.
+   */
+  void Compute(const float *window, float *feature);
+
+ private:
+  // Size of the real FFT
+  int32_t n_;
+
+  // Bit-reversal permutation of the complex FFT of size n_ / 2
+  std::vector<int32_t> bit_reverse_;
+
+  // Twiddle factors of the complex FFT. The stage that combines two
+  // transforms of size h uses h of them starting from index h - 1.
+  std::vector<float> twiddle_re_;
+  std::vector<float> twiddle_im_;
+
+  // exp(-2 pi i k / n_), k = 0, 1, ..., n_ / 2 - 1. They turn the complex
+  // FFT of size n_ / 2 into the real FFT of size n_.
+  std::vector<float> post_re_;
+  std::vector<float> post_im_;
+
+  // The i-th mel bin is the dot product of
+  // mel_weights_[mel_offsets_[i]:mel_offsets_[i+1]] with the power spectrum
+  // starting from bin mel_first_bin_[i]. mel_offsets_ has Dim() + 1
+  // entries.
+  std::vector<float> mel_weights_;
+  std::vector<int32_t> mel_offsets_;
+  std::vector<int32_t> mel_first_bin_;
+
+  // Scratch space of n_ / 2 floats each
+  std::vector<float> re_;
+  std::vector<float> im_;
+  std::vector<float> power_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_FAST_FBANK_H_
@@ -19,29 +19,61 @@
 #include "sherpa-ncnn/csrc/features.h"
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
-#include <mutex>  // NOLINT
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
+#include "kaldi-native-fbank/csrc/feature-fbank.h"
+#include "kaldi-native-fbank/csrc/feature-window.h"
 #include "kaldi-native-fbank/csrc/online-feature.h"
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/fast-fbank.h"
+#include "sherpa-ncnn/csrc/frame-buffer.h"
 #include "sherpa-ncnn/csrc/resample.h"
+#include "sherpa-ncnn/csrc/spsc-sample-queue.h"
+#include "sherpa-ncnn/csrc/trace.h"
 
 namespace sherpa_ncnn {
 
+// AcceptWaveformOffline() does not start a thread for fewer frames
+static constexpr int32_t kMinFramesPerThread = 500;
+
+static std::unique_ptr<LinearResample> CreateResampler(
+    int32_t input_sampling_rate, int32_t output_sampling_rate) {
+  NCNN_LOGE(
+      "Creating a resampler:\n"
+      "   in_sample_rate: %d\n"
+      "   output_sample_rate: %d\n",
+      input_sampling_rate, output_sampling_rate);
+
+  float min_freq = std::min<int32_t>(input_sampling_rate, output_sampling_rate);
+  float lowpass_cutoff = 0.99 * 0.5 * min_freq;
+
+  int32_t lowpass_filter_width = 6;
+  return std::make_unique<LinearResample>(
+      input_sampling_rate, output_sampling_rate, lowpass_cutoff,
+      lowpass_filter_width);
+}
+
 std::string FeatureExtractorConfig::ToString() const {
   std::ostringstream os;
 
   os << "FeatureExtractorConfig(";
   os << "sampling_rate=" << sampling_rate << ", ";
-  os << "feature_dim=" << feature_dim << ")";
+  os << "feature_dim=" << feature_dim << ", ";
+  os << "audio_queue_size=" << audio_queue_size << ", ";
+  os << "fast_fbank=" << (fast_fbank ? "True" : "False") << ")";
 
   return os.str();
 }
 
 class FeatureExtractor::Impl {
  public:
-  explicit Impl(const FeatureExtractorConfig &config) {
+  explicit Impl(const FeatureExtractorConfig &config)
+      : frames_(config.feature_dim) {
     opts_.frame_opts.dither = 0;
     opts_.frame_opts.snip_edges = false;
     opts_.frame_opts.samp_freq = config.sampling_rate;
@@ -54,11 +86,238 @@ class FeatureExtractor::Impl {
     // https://github.com/k2-fsa/sherpa-onnx/issues/514
     opts_.mel_opts.high_freq = -400;
 
-    fbank_ = std::make_unique<knf::OnlineFbank>(opts_);
+    if (config.fast_fbank) {
+      fast_fbank_ = std::make_unique<FastFbankComputer>(opts_);
+      window_function_ = knf::FeatureWindowFunction(opts_.frame_opts);
+    } else {
+      fbank_ = std::make_unique<knf::OnlineFbank>(opts_);
+    }
+
+    if (config.audio_queue_size > 0) {
+      queue_ = std::make_unique<SpscSampleQueue>(config.audio_queue_size);
+      queue_buffer_.resize(queue_->Capacity());
+    }
   }
 
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
+    if (queue_) {
+      // We are on the producer thread, which must never block
+      queue_sampling_rate_.store(sampling_rate, std::memory_order_relaxed);
+      int32_t k = queue_->Push(waveform, n);
+      if (k != n) {
+        num_dropped_samples_.fetch_add(n - k, std::memory_order_relaxed);
+      }
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    AcceptWaveformImpl(sampling_rate, waveform, n);
+  }
+
+  void AcceptWaveformOffline(int32_t sampling_rate, const float *waveform,
+                             int32_t n, int32_t num_threads) {
+    if (queue_) {
+      NCNN_LOGE(
+          "AcceptWaveformOffline() does not support audio_queue_size > 0");
+      exit(-1);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (input_finished_ || frames_.End() != 0 || !samples_.empty()) {
+      NCNN_LOGE(
+          "AcceptWaveformOffline() can only be called on a new or reset "
+          "feature extractor");
+      exit(-1);
+    }
+
+    // knf::ExtractWindow() accepts only a std::vector
+    std::vector<float> samples;
+    if (sampling_rate != opts_.frame_opts.samp_freq) {
+      // Like AcceptWaveform(), it does not flush the resampler
+      CreateResampler(sampling_rate, opts_.frame_opts.samp_freq)
+          ->Resample(waveform, n, false, &samples);
+    } else {
+      samples.assign(waveform, waveform + n);
+    }
+
+    const auto &frame_opts = opts_.frame_opts;
+    int32_t num_frames = knf::NumFrames(samples.size(), frame_opts, true);
+
+    // Frames are independent of each other, so each thread computes a
+    // contiguous range of them and writes them straight into frames_.
+    float *p = frames_.BeginAppend(num_frames);
+    int32_t dim = frames_.Dim();
+
+    // It is the loop of knf::OnlineFbank, so the frames are the same as
+    // those computed by AcceptWaveform() + InputFinished().
+    auto compute = [&](int32_t begin, int32_t end) {
+      ScopedTraceSpan span("features");
+
+      knf::FeatureWindowFunction window_function(frame_opts);
+      std::vector<float> window;
+
+      if (fast_fbank_) {
+        FastFbankComputer computer(opts_);
+        for (int32_t f = begin; f != end; ++f) {
+          knf::ExtractWindow(0, samples, f, frame_opts, window_function,
+                             &window);
+          computer.Compute(window.data(), p + static_cast<int64_t>(f) * dim);
+        }
+        return;
+      }
+
+      knf::FbankComputer computer(opts_);
+      bool need_raw_log_energy = computer.NeedRawLogEnergy();
+
+      for (int32_t f = begin; f != end; ++f) {
+        std::fill(window.begin(), window.end(), 0);
+        float raw_log_energy = 0;
+        knf::ExtractWindow(0, samples, f, frame_opts, window_function, &window,
+                           need_raw_log_energy ? &raw_log_energy : nullptr);
+
+        computer.Compute(raw_log_energy, 1.0, &window,
+                         p + static_cast<int64_t>(f) * dim);
+      }
+    };
+
+    num_threads = std::max(
+        1, std::min(num_threads, num_frames / kMinFramesPerThread));
+    std::vector<std::thread> threads;
+    for (int32_t i = 1; i < num_threads; ++i) {
+      int32_t begin = static_cast<int64_t>(num_frames) * i / num_threads;
+      int32_t end = static_cast<int64_t>(num_frames) * (i + 1) / num_threads;
+      threads.emplace_back(compute, begin, end);
+    }
+    compute(0, num_frames / num_threads);
+
+    for (auto &t : threads) {
+      t.join();
+    }
+
+    frames_.EndAppend();
+    input_finished_ = true;
+  }
+
+  void InputFinished() {
+    if (queue_) {
+      // release: Drain() sees all samples pushed before it
+      queue_input_finished_.store(true, std::memory_order_release);
+      return;
+    }
+
     std::lock_guard<std::mutex> lock(mutex_);
+    if (input_finished_) {
+      return;
+    }
+
+    FinishInput();
+  }
+
+  int32_t NumFramesReady() {
+    auto lock = Lock();
+    return frames_.End();
+  }
+
+  bool IsLastFrame(int32_t frame) {
+    auto lock = Lock();
+    return input_finished_ && frame == frames_.End() - 1;
+  }
+
+  ncnn::Mat GetFrames(int32_t frame_index, int32_t n) {
+    auto lock = Lock();
+    if (frame_index + n > frames_.End()) {
+      NCNN_LOGE("%d + %d > %d", frame_index, n, frames_.End());
+      exit(-1);
+    }
+
+    if (frame_index < frames_.Begin()) {
+      NCNN_LOGE("first available frame: %d, frame_index_: %d",
+                frames_.Begin(), frame_index);
+      exit(-1);
+    }
+
+    Pop(frame_index);
+
+    return frames_.Get(frame_index, n);
+  }
+
+  void ReleaseFrames(int32_t frame_index) {
+    auto lock = Lock();
+    Pop(std::min(frame_index, frames_.End()));
+  }
+
+  int32_t Rebase() {
+    auto lock = Lock();
+    if (input_finished_ || frames_.Begin() < 2) {
+      return 0;
+    }
+
+    // samples_ starts at the first sample of frame frames_.Begin() - 1,
+    // so frame i of the new fbank is frame i + frames_.Begin() - 1 of the
+    // current one. With snip_edges == false, only frame 0 of the new fbank
+    // reads past the beginning of samples_ and is different, but it has
+    // been released.
+    int32_t num_frames = frames_.Begin() - 1;
+    frames_.Rebase(num_frames);
+    samples_offset_ = 0;
+
+    if (fbank_) {
+      // The new fbank recomputes the frames that are already in frames_
+      fbank_ = std::make_unique<knf::OnlineFbank>(opts_);
+      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples_.data(),
+                             samples_.size());
+      fbank_->Pop(fbank_->NumFramesReady());
+      num_fetched_frames_ = fbank_->NumFramesReady();
+    }
+
+    return num_frames;
+  }
+
+  int64_t NumBytes() {
+    auto lock = Lock();
+    int64_t num_floats =
+        samples_.capacity() + queue_buffer_.size() * (queue_ ? 2 : 0);
+    return frames_.NumBytes() + num_floats * sizeof(float);
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // knf::OnlineFbank cannot be reset, so we create a new one. The
+    // options are already computed.
+    if (fbank_) {
+      fbank_ = std::make_unique<knf::OnlineFbank>(opts_);
+    }
+    resampler_.reset();
+    frames_.Clear();
+    num_fetched_frames_ = 0;
+    input_finished_ = false;
+    samples_.clear();
+    samples_offset_ = 0;
+
+    if (queue_) {
+      queue_->Clear();
+      queue_input_finished_ = false;
+      num_dropped_samples_ = 0;
+    }
+  }
+
+ private:
+  // In SPSC mode, fbank_ is accessed only by the consumer, so no lock is
+  // needed. The samples pushed by the producer are fed to fbank_ first.
+  std::unique_lock<std::mutex> Lock() {
+    if (!queue_) {
+      return std::unique_lock<std::mutex>(mutex_);
+    }
+
+    Drain();
+    return {};
+  }
+
+  // The caller holds the lock returned by Lock().
+  void AcceptWaveformImpl(int32_t sampling_rate, const float *waveform,
+                          int32_t n) {
+    ScopedTraceSpan span("features");
+
     if (resampler_) {
       if (sampling_rate != resampler_->GetInputSamplingRate()) {
         NCNN_LOGE(
@@ -68,90 +327,164 @@ class FeatureExtractor::Impl {
         exit(-1);
       }
 
-      std::vector<float> samples;
-      resampler_->Resample(waveform, n, false, &samples);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
-                             samples.size());
+      resampler_->Resample(waveform, n, false, &resampled_);
+      AcceptSamples(resampled_.data(), resampled_.size());
       return;
     }
 
     if (sampling_rate != opts_.frame_opts.samp_freq) {
-      NCNN_LOGE(
-          "Creating a resampler:\n"
-          "   in_sample_rate: %d\n"
-          "   output_sample_rate: %d\n",
-          sampling_rate, static_cast<int32_t>(opts_.frame_opts.samp_freq));
-
-      float min_freq =
-          std::min<int32_t>(sampling_rate, opts_.frame_opts.samp_freq);
-      float lowpass_cutoff = 0.99 * 0.5 * min_freq;
-
-      int32_t lowpass_filter_width = 6;
-      resampler_ = std::make_unique<LinearResample>(
-          sampling_rate, opts_.frame_opts.samp_freq, lowpass_cutoff,
-          lowpass_filter_width);
-
-      std::vector<float> samples;
-      resampler_->Resample(waveform, n, false, &samples);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
-                             samples.size());
+      resampler_ = CreateResampler(sampling_rate, opts_.frame_opts.samp_freq);
+
+      resampler_->Resample(waveform, n, false, &resampled_);
+      AcceptSamples(resampled_.data(), resampled_.size());
       return;
     }
 
-    fbank_->AcceptWaveform(sampling_rate, waveform, n);
+    AcceptSamples(waveform, n);
   }
 
-  void InputFinished() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    fbank_->InputFinished();
+  // Feed the samples pushed by the producer to the fbank. It is called by
+  // the consumer in SPSC mode.
+  void Drain() {
+    // acquire: if it is true, all samples have been pushed
+    bool input_finished =
+        queue_input_finished_.load(std::memory_order_acquire);
+
+    int32_t n = queue_->Pop(queue_buffer_.data(), queue_buffer_.size());
+    if (n > 0) {
+      AcceptWaveformImpl(queue_sampling_rate_.load(std::memory_order_relaxed),
+                         queue_buffer_.data(), n);
+    }
+
+    int64_t num_dropped =
+        num_dropped_samples_.exchange(0, std::memory_order_relaxed);
+    if (num_dropped > 0) {
+      NCNN_LOGE(
+          "Dropped %d samples since the audio queue is full. Please increase "
+          "audio_queue_size or decode more often",
+          static_cast<int32_t>(num_dropped));
+    }
+
+    if (input_finished && !input_finished_ && queue_->Size() == 0) {
+      FinishInput();
+    }
   }
 
-  int32_t NumFramesReady() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return fbank_->NumFramesReady();
+  // Feed samples at opts_.frame_opts.samp_freq to fbank_. The caller holds
+  // the lock returned by Lock().
+  void AcceptSamples(const float *samples, int32_t n) {
+    samples_.insert(samples_.end(), samples, samples + n);
+    if (fast_fbank_) {
+      ComputeFrames(false);
+      return;
+    }
+
+    fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples, n);
+    FetchFrames();
   }
 
-  bool IsLastFrame(int32_t frame) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return fbank_->IsLastFrame(frame);
+  // Compute the remaining frames. The caller holds the lock returned by
+  // Lock().
+  void FinishInput() {
+    ScopedTraceSpan span("features");
+
+    if (fast_fbank_) {
+      ComputeFrames(true);
+    } else {
+      fbank_->InputFinished();
+      FetchFrames();
+    }
+
+    input_finished_ = true;
   }
 
-  ncnn::Mat GetFrames(int32_t frame_index, int32_t n) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (frame_index + n > fbank_->NumFramesReady()) {
-      NCNN_LOGE("%d + %d > %d", frame_index, n, fbank_->NumFramesReady());
-      exit(-1);
+  // Compute the new frames of samples_ with fast_fbank_ and append them to
+  // frames_. If flush is true, it also computes the last frames, which
+  // extend past the end of samples_. The caller holds the lock returned by
+  // Lock().
+  void ComputeFrames(bool flush) {
+    const auto &frame_opts = opts_.frame_opts;
+    int32_t num_frames =
+        knf::NumFrames(samples_offset_ + samples_.size(), frame_opts, flush);
+
+    int32_t first = frames_.End();
+    if (num_frames <= first) {
+      return;
     }
 
-    int32_t discard_num = frame_index - last_frame_index_;
-    if (discard_num < 0) {
-      NCNN_LOGE("last_frame_index_: %d, frame_index_: %d", last_frame_index_,
-                frame_index);
-      exit(-1);
+    int32_t dim = frames_.Dim();
+    float *p = frames_.BeginAppend(num_frames - first);
+    for (int32_t f = first; f != num_frames; ++f, p += dim) {
+      knf::ExtractWindow(samples_offset_, samples_, f, frame_opts,
+                         window_function_, &window_);
+      fast_fbank_->Compute(window_.data(), p);
     }
+    frames_.EndAppend();
+  }
 
-    fbank_->Pop(discard_num);
+  // Move new frames from fbank_ to frames_. The caller holds the lock
+  // returned by Lock().
+  void FetchFrames() {
+    int32_t n = fbank_->NumFramesReady();
+    for (int32_t i = num_fetched_frames_; i != n; ++i) {
+      frames_.Push(fbank_->GetFrame(i));
+    }
 
-    int32_t feature_dim = fbank_->Dim();
-    ncnn::Mat features;
-    features.create(feature_dim, n);
+    fbank_->Pop(n - num_fetched_frames_);
+    num_fetched_frames_ = n;
+  }
 
-    for (int32_t i = 0; i != n; ++i) {
-      const float *f = fbank_->GetFrame(i + frame_index);
-      std::copy(f, f + feature_dim, features.row(i));
+  // Release the frames before frame_index, and the samples that are needed
+  // only by them. The caller holds the lock returned by Lock().
+  void Pop(int32_t frame_index) {
+    if (frame_index <= frames_.Begin()) {
+      return;
     }
 
-    last_frame_index_ = frame_index;
-
-    return features;
+    frames_.Release(frame_index);
+
+    // Keep the samples from the first sample of frame frame_index - 1 on.
+    // See Rebase().
+    int64_t first_sample =
+        static_cast<int64_t>(frame_index - 1) * opts_.frame_opts.WindowShift();
+    int64_t n = std::min<int64_t>(first_sample - samples_offset_,
+                                  samples_.size());
+    if (n > 0) {
+      samples_.erase(samples_.begin(), samples_.begin() + n);
+      samples_offset_ += n;
+    }
   }
 
  private:
+  // Exactly one of fbank_ and fast_fbank_ is not null
   std::unique_ptr<knf::OnlineFbank> fbank_;
+  std::unique_ptr<FastFbankComputer> fast_fbank_;
+  knf::FeatureWindowFunction window_function_;  // used with fast_fbank_
+  std::vector<float> window_;                   // used with fast_fbank_
   knf::FbankOptions opts_;
   mutable std::mutex mutex_;
   std::unique_ptr<LinearResample> resampler_;
-  int32_t last_frame_index_ = 0;
+  std::vector<float> resampled_;  // output of resampler_, reused
+
+  // Frames computed by fbank_. The index of a frame is the same in both.
+  FrameBuffer frames_;
+
+  // Frames before it have been moved from fbank_ to frames_
+  int32_t num_fetched_frames_ = 0;
+
+  bool input_finished_ = false;
+
+  // Input samples of fbank_ starting from sample samples_offset_. They are
+  // used to re-create fbank_ in Rebase().
+  std::vector<float> samples_;
+  int64_t samples_offset_ = 0;
+
+  // Used only in SPSC mode, i.e., if config.audio_queue_size > 0.
+  std::unique_ptr<SpscSampleQueue> queue_;
+  std::vector<float> queue_buffer_;  // used by Drain()
+  std::atomic<int32_t> queue_sampling_rate_{0};
+  std::atomic<bool> queue_input_finished_{false};
+  std::atomic<int64_t> num_dropped_samples_{0};
 };
 
 FeatureExtractor::FeatureExtractor(const FeatureExtractorConfig &config)
@@ -164,6 +497,12 @@ void FeatureExtractor::AcceptWaveform(int32_t sampling_rate,
   impl_->AcceptWaveform(sampling_rate, waveform, n);
 }
 
+void FeatureExtractor::AcceptWaveformOffline(int32_t sampling_rate,
+                                             const float *waveform, int32_t n,
+                                             int32_t num_threads) {
+  impl_->AcceptWaveformOffline(sampling_rate, waveform, n, num_threads);
+}
+
 void FeatureExtractor::InputFinished() { impl_->InputFinished(); }
 
 int32_t FeatureExtractor::NumFramesReady() const {
@@ -178,4 +517,14 @@ ncnn::Mat FeatureExtractor::GetFrames(int32_t frame_index, int32_t n) const {
   return impl_->GetFrames(frame_index, n);
 }
 
+void FeatureExtractor::ReleaseFrames(int32_t frame_index) {
+  impl_->ReleaseFrames(frame_index);
+}
+
+int32_t FeatureExtractor::Rebase() { return impl_->Rebase(); }
+
+int64_t FeatureExtractor::NumBytes() const { return impl_->NumBytes(); }
+
+void FeatureExtractor::Reset() { impl_->Reset(); }
+
 }  // namespace sherpa_ncnn
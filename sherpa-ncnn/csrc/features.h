@@ -32,9 +32,28 @@ struct FeatureExtractorConfig {
   int32_t sampling_rate = 16000;
   int32_t feature_dim = 80;
 
+  // If it is positive, AcceptWaveform() and InputFinished() only put the
+  // samples into a lock-free queue of this many samples, and the features
+  // are computed by the thread that calls the other methods, e.g., the
+  // decoding thread. It allows one thread to capture audio while another
+  // thread decodes without either of them waiting for a lock. Samples that
+  // do not fit into the queue are dropped with an error message.
+  //
+  // If it is 0, all methods can be called from any thread and the features
+  // are computed in AcceptWaveform().
+  int32_t audio_queue_size = 0;
+
+  // If true, compute the features with FastFbankComputer, which uses SIMD
+  // instructions, instead of kaldi-native-fbank. The features differ from
+  // those of kaldi-native-fbank only by rounding errors.
+  bool fast_fbank = false;
+
   std::string ToString() const;
 };
 
+// If config.audio_queue_size > 0, AcceptWaveform() and InputFinished()
+// must be called from one thread, the producer, and the other methods from
+// another single thread, the consumer.
 class FeatureExtractor {
  public:
   explicit FeatureExtractor(const FeatureExtractorConfig &config);
@@ -51,6 +70,20 @@ class FeatureExtractor {
    */
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n);
 
+  /** Accept all samples of an utterance at once and compute all of its
+   * frames in parallel. It is equivalent to AcceptWaveform() followed by
+   * InputFinished() and gives bit-identical frames, but it is faster for
+   * long recordings, e.g., when decoding files.
+   *
+   * It can only be called on a new or reset feature extractor and not if
+   * config.audio_queue_size > 0. AcceptWaveform() must not be called
+   * afterwards.
+   *
+   * @param num_threads Maximum number of threads for computing the frames
+   */
+  void AcceptWaveformOffline(int32_t sampling_rate, const float *waveform,
+                             int32_t n, int32_t num_threads);
+
   // InputFinished() tells the class you won't be providing any
   // more waveform.  This will help flush out the last frame or two
   // of features, in the case where snip-edges == false; it also
@@ -69,9 +102,34 @@ class FeatureExtractor {
    * @param n  Number of frames to get.
    * @return Return a 2-D tensor of shape (n, feature_dim).
    *         ans.w == feature_dim; ans.h == n
+   *         It shares memory with this object instead of copying the
+   *         frames, and its content is valid until the frames are released,
+   *         i.e., until ReleaseFrames() or GetFrames() is called with a
+   *         larger frame index.
    */
   ncnn::Mat GetFrames(int32_t frame_index, int32_t n) const;
 
+  // Release the frames before frame_index, together with the audio samples
+  // that are needed only by them. They cannot be accessed afterwards.
+  void ReleaseFrames(int32_t frame_index);
+
+  /** Renumber the frames so that the first frame that is not released
+   * gets index 1, so that frame indexes do not overflow on streams that
+   * run for days. The features are not changed.
+   *
+   * @return Return the number that has been subtracted from the frame
+   *         indexes. It is 0 if nothing is done, e.g., after InputFinished().
+   */
+  int32_t Rebase();
+
+  // Number of bytes used by the frames and audio samples that are not
+  // released.
+  int64_t NumBytes() const;
+
+  // Discard all audio samples and features so that the object can be
+  // used for a new utterance.
+  void Reset();
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
@@ -0,0 +1,139 @@
+// sherpa-ncnn/csrc/frame-buffer.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/frame-buffer.h"
+
+#include <algorithm>
+
+#include "allocator.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+namespace {
+
+// The allocator of FrameBuffer::buffer_. A mat returned by
+// FrameBuffer::Get() points into the middle of the memory and shares its
+// reference count. Whichever mat is released last calls fastFree() with
+// its own data pointer, so we free the pointer we returned instead.
+//
+// Every allocator object is used for exactly one allocation and deletes
+// itself after freeing it.
+class FrameBufferAllocator : public ncnn::Allocator {
+ public:
+  void *fastMalloc(size_t size) override {
+    ptr_ = ncnn::fastMalloc(size);
+    return ptr_;
+  }
+
+  void fastFree(void * /*ptr*/) override {
+    ncnn::fastFree(ptr_);
+    delete this;
+  }
+
+ private:
+  void *ptr_ = nullptr;
+};
+
+}  // namespace
+
+FrameBuffer::FrameBuffer(int32_t dim, int32_t capacity)
+    : dim_(dim), capacity_(std::max(1, capacity)) {
+  buffer_.create(dim_, 2 * capacity_, 4u, new FrameBufferAllocator);
+}
+
+void FrameBuffer::Push(const float *frame) {
+  if (Size() == capacity_) {
+    Grow(2 * capacity_);
+  }
+
+  int32_t slot = (head_ + Size()) % capacity_;
+  std::copy(frame, frame + dim_, buffer_.row(slot));
+  std::copy(frame, frame + dim_, buffer_.row(slot + capacity_));
+
+  ++end_;
+}
+
+float *FrameBuffer::BeginAppend(int32_t n) {
+  if (Size() + n > capacity_) {
+    Grow(std::max(2 * capacity_, Size() + n));
+  }
+
+  num_appending_ = n;
+
+  // The rows may extend into the second copy, which is fine since we fix
+  // up the other copy in EndAppend().
+  return buffer_.row(head_ + Size());
+}
+
+void FrameBuffer::EndAppend() {
+  int32_t first = head_ + Size();
+  for (int32_t i = first; i != first + num_appending_; ++i) {
+    const float *p = buffer_.row(i);
+    int32_t mirror = i < capacity_ ? i + capacity_ : i - capacity_;
+    std::copy(p, p + dim_, buffer_.row(mirror));
+  }
+
+  end_ += num_appending_;
+  num_appending_ = 0;
+}
+
+ncnn::Mat FrameBuffer::Get(int32_t frame_index, int32_t n) const {
+  if (frame_index < begin_ || frame_index + n > end_) {
+    NCNN_LOGE("Frames [%d, %d) are not in [%d, %d)", frame_index,
+              frame_index + n, begin_, end_);
+    exit(-1);
+  }
+
+  int32_t slot = (head_ + frame_index - begin_) % capacity_;
+
+  // Share the reference count and the allocator of buffer_
+  ncnn::Mat ans = buffer_;
+  ans.data = const_cast<float *>(buffer_.row(slot));
+  ans.dims = 2;
+  ans.w = dim_;
+  ans.h = n;
+  ans.d = 1;
+  ans.c = 1;
+  ans.cstep = static_cast<size_t>(dim_) * n;
+
+  return ans;
+}
+
+void FrameBuffer::Release(int32_t frame_index) {
+  frame_index = std::min(std::max(frame_index, begin_), end_);
+  head_ = (head_ + frame_index - begin_) % capacity_;
+  begin_ = frame_index;
+}
+
+void FrameBuffer::Rebase(int32_t n) {
+  begin_ -= n;
+  end_ -= n;
+}
+
+void FrameBuffer::Clear() {
+  head_ = 0;
+  begin_ = 0;
+  end_ = 0;
+}
+
+int64_t FrameBuffer::NumBytes() const {
+  return static_cast<int64_t>(buffer_.total()) * buffer_.elemsize;
+}
+
+void FrameBuffer::Grow(int32_t capacity) {
+  // Mats returned by Get() keep the old memory alive
+  ncnn::Mat buffer;
+  buffer.create(dim_, 2 * capacity, 4u, new FrameBufferAllocator);
+
+  int32_t size = Size();
+  const float *p = buffer_.row(head_);
+  std::copy(p, p + size * dim_, buffer.row(0));
+  std::copy(p, p + size * dim_, buffer.row(capacity));
+
+  buffer_ = buffer;
+  capacity_ = capacity;
+  head_ = 0;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,102 @@
+// sherpa-ncnn/csrc/frame-buffer.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_FRAME_BUFFER_H_
+#define SHERPA_NCNN_CSRC_FRAME_BUFFER_H_
+
+#include <cstdint>
+
+#include "mat.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/**
+ * A growable ring of feature frames from which any range of frames can be
+ * returned as an ncnn::Mat without copying.
+ *
+ * Each frame is stored twice: in row `slot` and in row `slot + capacity` of
+ * a buffer with 2 * capacity rows. Any capacity consecutive frames are
+ * therefore contiguous, even if they wrap around the end of the ring.
+ *
+ * Frames are numbered in the order they are pushed. The frames in
+ * [Begin(), End()) are available.
+ */
+class FrameBuffer {
+ public:
+  // @param dim  Number of floats per frame
+  // @param capacity  Initial number of frames the ring can hold. It grows
+  //                  when it is full.
+  explicit FrameBuffer(int32_t dim, int32_t capacity = 128);
+
+  int32_t Dim() const { return dim_; }
+
+  // Index of the first available frame
+  int32_t Begin() const { return begin_; }
+
+  // One past the index of the last available frame
+  int32_t End() const { return end_; }
+
+  int32_t Size() const { return end_ - begin_; }
+
+  // Append a frame of Dim() floats
+  void Push(const float *frame);
+
+  /** Append n frames without copying them from elsewhere.
+   *
+   * It returns a pointer to n * Dim() contiguous floats in which the caller
+   * writes frames [End(), End() + n). Different frames can be written by
+   * different threads. The frames become available after EndAppend() is
+   * called, and no other method may be called before that.
+   */
+  float *BeginAppend(int32_t n);
+  void EndAppend();
+
+  /** Return frames [frame_index, frame_index + n) as a 2-D mat of shape
+   * (n, Dim()) without copying.
+   *
+   * The returned mat shares the reference count of the ring's memory, so
+   * ncnn copies it before modifying it in-place, and the memory stays
+   * alive as long as the mat does. Its content is valid until the frames
+   * are released by Release().
+   */
+  ncnn::Mat Get(int32_t frame_index, int32_t n) const;
+
+  // Release the frames before frame_index. Their rows are reused by frames
+  // pushed later.
+  void Release(int32_t frame_index);
+
+  // Subtract n from the indexes of all frames. n must not be larger than
+  // Begin().
+  void Rebase(int32_t n);
+
+  // Release all frames and restart the numbering from 0
+  void Clear();
+
+  // Number of bytes of the ring's memory
+  int64_t NumBytes() const;
+
+ private:
+  // Move the frames to a new ring that holds capacity frames
+  void Grow(int32_t capacity);
+
+ private:
+  int32_t dim_;
+  int32_t capacity_;
+
+  // 2 * capacity_ rows of dim_ floats
+  ncnn::Mat buffer_;
+
+  // Slot of frame begin_
+  int32_t head_ = 0;
+
+  int32_t begin_ = 0;
+  int32_t end_ = 0;
+
+  // Number of frames passed to BeginAppend()
+  int32_t num_appending_ = 0;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_FRAME_BUFFER_H_
@@ -18,21 +18,62 @@
  */
 #include "sherpa-ncnn/csrc/greedy-search-decoder.h"
 
+#include <algorithm>
+#include <numeric>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/stream.h"
+
 namespace sherpa_ncnn {
 
 ncnn::Mat GreedySearchDecoder::BuildDecoderInput(
-    const DecoderResult &result) const {
+    DecoderResult **results, const std::vector<int32_t> &indexes) const {
   int32_t context_size = model_->ContextSize();
-  ncnn::Mat decoder_input(context_size);
-  for (int32_t i = 0; i != context_size; ++i) {
-    static_cast<int32_t *>(decoder_input)[i] =
-        *(result.tokens.end() - context_size + i);
+  ncnn::Mat decoder_input(context_size, static_cast<int32_t>(indexes.size()));
+  auto p = static_cast<int32_t *>(decoder_input);
+
+  for (auto i : indexes) {
+    const auto &tokens = results[i]->tokens;
+    std::copy(tokens.end() - context_size, tokens.end(), p);
+    p += context_size;
   }
+
   return decoder_input;
 }
 
+// Copy the k-th row of src to the indexes[k]-th row of dst
+static void CopyRows(const ncnn::Mat &src, const std::vector<int32_t> &indexes,
+                     ncnn::Mat *dst) {
+  for (int32_t k = 0; k != static_cast<int32_t>(indexes.size()); ++k) {
+    const float *p = src.row(k);
+    std::copy(p, p + src.w, dst->row(indexes[k]));
+  }
+}
+
+ncnn::Mat GreedySearchDecoder::RunDecoder(ncnn::Mat &decoder_input,
+                                          ExecutionContext *ctx) {
+  ScopedStageTimer timer(stats_, Stage::kDecoder);
+
+  if (cache_) {
+    return cache_->RunDecoder(model_, decoder_input, ctx);
+  }
+
+  return model_->RunDecoderForJoiner(decoder_input, ctx);
+}
+
+ncnn::Mat GreedySearchDecoder::RunJoiner(ncnn::Mat &encoder_out,
+                                         ncnn::Mat &decoder_out,
+                                         ExecutionContext *ctx) {
+  ScopedStageTimer timer(stats_, Stage::kJoiner);
+
+  if (model_->HasJoinerProjections()) {
+    return model_->RunJoinerFromProjections(encoder_out, decoder_out, ctx);
+  }
+
+  ncnn::Extractor joiner_ex = CreateExtractor(model_->GetJoiner(), ctx);
+  return model_->RunJoiner(encoder_out, decoder_out, &joiner_ex);
+}
+
 DecoderResult GreedySearchDecoder::GetEmptyResult() const {
   int32_t context_size = model_->ContextSize();
   int32_t blank_id = 0;  // always 0
@@ -52,38 +93,231 @@ void GreedySearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
 }
 
 void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
-  // TODO(fangjun): Cache the result of decoder_out
-  ncnn::Mat decoder_out = result->decoder_out;
-  if (decoder_out.empty()) {
-    ncnn::Mat decoder_input = BuildDecoderInput(*result);
-    decoder_out = model_->RunDecoder(decoder_input);
+  DecodeBatch(&encoder_out, &result, 1, nullptr);
+}
+
+void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
+                                 DecoderResult *result) {
+  DecodeBatch(&encoder_out, &result, 1, s->GetExecutionContext());
+}
+
+void GreedySearchDecoder::Decode(ncnn::Mat *encoder_out, Stream **ss,
+                                 int32_t n) {
+  std::vector<DecoderResult *> results(n);
+  for (int32_t i = 0; i != n; ++i) {
+    results[i] = &ss[i]->GetResult();
+  }
+
+  for (int32_t i = 1; i != n; ++i) {
+    if (encoder_out[i].h != encoder_out[0].h) {
+      // It should not happen for streams decoded by the same model
+      for (int32_t k = 0; k != n; ++k) {
+        DecodeBatch(encoder_out + k, results.data() + k, 1,
+                    ss[k]->GetExecutionContext());
+      }
+      return;
+    }
+  }
+
+  // The streams are decoded by the current thread, so we can use the
+  // context of any of them. Blobs allocated from it are released before
+  // DecodeBatch() returns.
+  DecodeBatch(encoder_out, results.data(), n, ss[0]->GetExecutionContext());
+}
+
+void GreedySearchDecoder::DecodeBatch(ncnn::Mat *encoder_out,
+                                      DecoderResult **results, int32_t n,
+                                      ExecutionContext *ctx) {
+  // Row i of decoder_out belongs to results[i]. Reuse the cached decoder_out
+  // and compute the missing ones with a single decoder invocation.
+  std::vector<int32_t> indexes;
+  for (int32_t i = 0; i != n; ++i) {
+    if (results[i]->decoder_out.empty()) {
+      indexes.push_back(i);
+    }
+  }
+
+  ncnn::Mat tmp;
+  if (!indexes.empty()) {
+    ncnn::Mat decoder_input = BuildDecoderInput(results, indexes);
+    tmp = RunDecoder(decoder_input, ctx);
+  }
+
+  int32_t decoder_dim = indexes.empty() ? results[0]->decoder_out.w : tmp.w;
+  ncnn::Mat decoder_out(decoder_dim, n);
+  for (int32_t i = 0; i != n; ++i) {
+    const ncnn::Mat &cached = results[i]->decoder_out;
+    if (!cached.empty()) {
+      const float *p = cached;
+      std::copy(p, p + decoder_dim, decoder_out.row(i));
+    }
+  }
+  CopyRows(tmp, indexes, &decoder_out);
+
+  // Project the encoder output of all frames at once, so that only the
+  // rest of the joiner is run for each frame
+  std::vector<ncnn::Mat> encoder_proj;
+  if (model_->HasJoinerProjections()) {
+    encoder_proj.resize(n);
+    ScopedStageTimer timer(stats_, Stage::kJoiner);
+    for (int32_t i = 0; i != n; ++i) {
+      encoder_proj[i] = model_->RunJoinerEncoderProj(encoder_out[i], ctx);
+    }
+    encoder_out = encoder_proj.data();
+  }
+
+  if (batch_frames_) {
+    DecodeFramesSpeculatively(encoder_out, results, n, &decoder_out, ctx);
+  } else {
+    DecodeFrameByFrame(encoder_out, results, n, &decoder_out, ctx);
+  }
+
+  for (int32_t i = 0; i != n; ++i) {
+    results[i]->frame_offset += encoder_out[0].h;
+    results[i]->decoder_out =
+        ncnn::Mat(decoder_dim, decoder_out.row(i)).clone();
   }
+}
+
+void GreedySearchDecoder::DecodeFrameByFrame(ncnn::Mat *encoder_out,
+                                             DecoderResult **results,
+                                             int32_t n, ncnn::Mat *decoder_out,
+                                             ExecutionContext *ctx) {
+  int32_t num_frames = encoder_out[0].h;
+  int32_t encoder_dim = encoder_out[0].w;
+  ncnn::Mat encoder_out_t(encoder_dim, n);
+
+  std::vector<int32_t> indexes;
+
+  for (int32_t t = 0; t != num_frames; ++t) {
+    for (int32_t i = 0; i != n; ++i) {
+      const float *p = encoder_out[i].row(t);
+      std::copy(p, p + encoder_dim, encoder_out_t.row(i));
+    }
+
+    // joiner_out.w == vocab_size
+    // joiner_out.h == n
+    ncnn::Mat joiner_out = RunJoiner(encoder_out_t, *decoder_out, ctx);
+
+    indexes.clear();
+    for (int32_t i = 0; i != n; ++i) {
+      const float *joiner_out_ptr = joiner_out.row(i);
 
-  int32_t frame_offset = result->frame_offset;
-  for (int32_t t = 0; t != encoder_out.h; ++t) {
-    ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
-
-    const float *joiner_out_ptr = joiner_out.row(0);
-
-    auto new_token = static_cast<int32_t>(std::distance(
-        joiner_out_ptr,
-        std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
-
-    // the blank ID is fixed to 0
-    if (new_token != 0 && new_token != 2) {
-      result->tokens.push_back(new_token);
-      ncnn::Mat decoder_input = BuildDecoderInput(*result);
-      decoder_out = model_->RunDecoder(decoder_input);
-      result->num_trailing_blanks = 0;
-      result->timestamps.push_back(t + frame_offset);
-    } else {
-      ++result->num_trailing_blanks;
+      auto new_token = static_cast<int32_t>(std::distance(
+          joiner_out_ptr,
+          std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
+
+      DecoderResult *result = results[i];
+      // the blank ID is fixed to 0
+      if (new_token != 0 && new_token != 2) {
+        result->tokens.push_back(new_token);
+        result->num_trailing_blanks = 0;
+        result->timestamps.push_back(t + result->frame_offset);
+        indexes.push_back(i);
+      } else {
+        ++result->num_trailing_blanks;
+      }
+    }
+
+    if (!indexes.empty()) {
+      ncnn::Mat decoder_input = BuildDecoderInput(results, indexes);
+      ncnn::Mat tmp = RunDecoder(decoder_input, ctx);
+      CopyRows(tmp, indexes, decoder_out);
     }
   }
+}
+
+void GreedySearchDecoder::DecodeFramesSpeculatively(ncnn::Mat *encoder_out,
+                                                    DecoderResult **results,
+                                                    int32_t n,
+                                                    ncnn::Mat *decoder_out,
+                                                    ExecutionContext *ctx) {
+  int32_t num_frames = encoder_out[0].h;
+  int32_t encoder_dim = encoder_out[0].w;
+  int32_t decoder_dim = decoder_out->w;
+
+  // pos[i] is the first frame of the i-th stream that is not decoded yet
+  std::vector<int32_t> pos(n, 0);
 
-  result->frame_offset += encoder_out.h;
-  result->decoder_out = decoder_out;
+  // Streams that have frames left
+  std::vector<int32_t> active(n);
+  std::iota(active.begin(), active.end(), 0);
+  std::vector<int32_t> next_active;
+
+  // Rows [row_start[k], row_start[k+1]) belong to the stream active[k]
+  std::vector<int32_t> row_start;
+  std::vector<int32_t> indexes;
+
+  while (!active.empty()) {
+    int32_t num_active = static_cast<int32_t>(active.size());
+    row_start.resize(num_active + 1);
+    row_start[0] = 0;
+    for (int32_t k = 0; k != num_active; ++k) {
+      row_start[k + 1] = row_start[k] + num_frames - pos[active[k]];
+    }
+
+    // Pair all remaining frames of a stream with its current decoder_out
+    int32_t num_rows = row_start[num_active];
+    ncnn::Mat encoder_rows(encoder_dim, num_rows);
+    ncnn::Mat decoder_rows(decoder_dim, num_rows);
+    for (int32_t k = 0; k != num_active; ++k) {
+      int32_t i = active[k];
+      const float *q = decoder_out->row(i);
+      for (int32_t t = pos[i], r = row_start[k]; t != num_frames; ++t, ++r) {
+        const float *p = encoder_out[i].row(t);
+        std::copy(p, p + encoder_dim, encoder_rows.row(r));
+        std::copy(q, q + decoder_dim, decoder_rows.row(r));
+      }
+    }
+
+    // joiner_out.w == vocab_size
+    // joiner_out.h == num_rows
+    ncnn::Mat joiner_out = RunJoiner(encoder_rows, decoder_rows, ctx);
+
+    // Accept the frames up to and including the first non-blank one. The
+    // rows after it were computed with a decoder_out that is out of date.
+    indexes.clear();
+    next_active.clear();
+    for (int32_t k = 0; k != num_active; ++k) {
+      int32_t i = active[k];
+      DecoderResult *result = results[i];
+
+      int32_t t = pos[i];
+      for (int32_t r = row_start[k]; t != num_frames; ++t, ++r) {
+        const float *joiner_out_ptr = joiner_out.row(r);
+
+        auto new_token = static_cast<int32_t>(std::distance(
+            joiner_out_ptr,
+            std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
+
+        // the blank ID is fixed to 0
+        if (new_token != 0 && new_token != 2) {
+          result->tokens.push_back(new_token);
+          result->num_trailing_blanks = 0;
+          result->timestamps.push_back(t + result->frame_offset);
+          break;
+        }
+
+        ++result->num_trailing_blanks;
+      }
+
+      if (t != num_frames) {
+        indexes.push_back(i);
+        pos[i] = t + 1;
+        if (pos[i] != num_frames) {
+          next_active.push_back(i);
+        }
+      }
+    }
+
+    if (!indexes.empty()) {
+      ncnn::Mat decoder_input = BuildDecoderInput(results, indexes);
+      ncnn::Mat tmp = RunDecoder(decoder_input, ctx);
+      CopyRows(tmp, indexes, decoder_out);
+    }
+
+    active.swap(next_active);
+  }
 }
 
 }  // namespace sherpa_ncnn
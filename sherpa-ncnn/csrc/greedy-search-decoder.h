@@ -20,6 +20,9 @@
 #ifndef SHERPA_NCNN_CSRC_GREEDY_SEARCH_DECODER_H_
 #define SHERPA_NCNN_CSRC_GREEDY_SEARCH_DECODER_H_
 
+#include <vector>
+
+#include "sherpa-ncnn/csrc/decoder-out-cache.h"
 #include "sherpa-ncnn/csrc/decoder.h"
 #include "sherpa-ncnn/csrc/model.h"
 
@@ -27,7 +30,13 @@ namespace sherpa_ncnn {
 
 class GreedySearchDecoder : public Decoder {
  public:
-  explicit GreedySearchDecoder(Model *model) : model_(model) {}
+  // @param cache If not nullptr, it is used to look up the decoder output
+  //              before running the decoder network. Not owned.
+  // @param batch_frames If true, run the joiner on all remaining frames of
+  //                     a chunk at once. See DecodeFramesSpeculatively().
+  explicit GreedySearchDecoder(Model *model, DecoderOutCache *cache = nullptr,
+                               bool batch_frames = false)
+      : model_(model), cache_(cache), batch_frames_(batch_frames) {}
 
   DecoderResult GetEmptyResult() const override;
 
@@ -35,11 +44,53 @@ class GreedySearchDecoder : public Decoder {
 
   void Decode(ncnn::Mat encoder_out, DecoderResult *result) override;
 
+  void Decode(ncnn::Mat encoder_out, Stream *s, DecoderResult *result) override;
+
+  void Decode(ncnn::Mat *encoder_out, Stream **ss, int32_t n) override;
+
  private:
-  ncnn::Mat BuildDecoderInput(const DecoderResult &result) const;
+  // Return a 2-D mat of shape (indexes.size(), context_size)
+  ncnn::Mat BuildDecoderInput(DecoderResult **results,
+                              const std::vector<int32_t> &indexes) const;
+
+  // See Model::RunDecoderForJoiner()
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input, ExecutionContext *ctx);
+
+  // If the joiner has projections, encoder_out and decoder_out are the
+  // outputs of the projections. See Model::HasJoinerProjections().
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ExecutionContext *ctx);
+
+  // ctx is used for running the networks. It can be nullptr.
+  void DecodeBatch(ncnn::Mat *encoder_out, DecoderResult **results, int32_t n,
+                   ExecutionContext *ctx);
+
+  // Run the joiner once per frame for all streams.
+  //
+  // decoder_out is of shape (n, decoder_dim). Row i belongs to results[i].
+  // It is updated in-place.
+  void DecodeFrameByFrame(ncnn::Mat *encoder_out, DecoderResult **results,
+                          int32_t n, ncnn::Mat *decoder_out,
+                          ExecutionContext *ctx);
+
+  // Run the joiner on all remaining frames of all streams at once with the
+  // current decoder_out of each stream. For each stream, the frames up to
+  // the first non-blank one are accepted, and the joiner is run again from
+  // the next frame after updating decoder_out. The result is the same as
+  // DecodeFrameByFrame(), but the joiner is invoked once per emitted token
+  // instead of once per frame, at the cost of computing rows that are
+  // discarded after an emission.
+  //
+  // The arguments are the same as DecodeFrameByFrame().
+  void DecodeFramesSpeculatively(ncnn::Mat *encoder_out,
+                                 DecoderResult **results, int32_t n,
+                                 ncnn::Mat *decoder_out,
+                                 ExecutionContext *ctx);
 
  private:
-  Model *model_;  // not owned
+  Model *model_;            // not owned
+  DecoderOutCache *cache_;  // not owned
+  bool batch_frames_;
 };
 
 }  // namespace sherpa_ncnn
@@ -25,14 +25,90 @@
 
 namespace sherpa_ncnn {
 
+HypothesisNode::~HypothesisNode() {
+  std::shared_ptr<HypothesisNode> p = std::move(parent);
+  while (p && p.use_count() == 1) {
+    // We are the only owner of p, so its parent is released by us
+    // instead of by the destructor of p
+    std::shared_ptr<HypothesisNode> next = std::move(p->parent);
+    p = std::move(next);
+  }
+}
+
+Hypothesis::Hypothesis(const std::vector<int32_t> &ys, double log_prob,
+                       const ContextState *context_state /*= nullptr*/)
+    : log_prob(log_prob), context_state(context_state) {
+  for (auto i : ys) {
+    Append(i, -1);
+  }
+}
+
+void Hypothesis::Append(int32_t token, int32_t t) {
+  node_ = std::make_shared<HypothesisNode>(token, t, std::move(node_));
+  ++num_tokens_;
+
+  // FNV-1a style rolling hash over the token sequence
+  key_ ^= static_cast<uint32_t>(token) + 1;
+  key_ *= 1099511628211ull;
+}
+
+std::vector<int32_t> Hypothesis::Ys() const {
+  std::vector<int32_t> ans(num_tokens_);
+  GetLastTokens(num_tokens_, ans.data());
+  return ans;
+}
+
+std::vector<int32_t> Hypothesis::Timestamps() const {
+  std::vector<int32_t> ans;
+  for (const auto *p = node_.get(); p; p = p->parent.get()) {
+    if (p->timestamp >= 0) {
+      ans.push_back(p->timestamp);
+    }
+  }
+
+  std::reverse(ans.begin(), ans.end());
+  return ans;
+}
+
+void Hypothesis::GetLastTokens(int32_t n, int32_t *out) const {
+  const auto *p = node_.get();
+  for (int32_t i = n - 1; i >= 0; --i, p = p->parent.get()) {
+    out[i] = p->token;
+  }
+}
+
+bool Hypothesis::HasSameTokens(const Hypothesis &other) const {
+  if (num_tokens_ != other.num_tokens_ || key_ != other.key_) {
+    return false;
+  }
+
+  // Hypotheses from the same stream share a prefix, so we usually reach
+  // a common node after a few steps
+  const auto *p = node_.get();
+  const auto *q = other.node_.get();
+  while (p != q) {
+    if (p->token != q->token) {
+      return false;
+    }
+    p = p->parent.get();
+    q = q->parent.get();
+  }
+
+  return true;
+}
+
 void Hypotheses::Add(Hypothesis hyp) {
-  auto key = hyp.Key();
-  auto it = hyps_dict_.find(key);
-  if (it == hyps_dict_.end()) {
-    hyps_dict_[key] = std::move(hyp);
-  } else {
-    it->second.log_prob = LogAdd<double>()(it->second.log_prob, hyp.log_prob);
+  auto range = hyps_dict_.equal_range(hyp.Key());
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.HasSameTokens(hyp)) {
+      it->second.log_prob =
+          LogAdd<double>()(it->second.log_prob, hyp.log_prob);
+      return;
+    }
   }
+
+  uint64_t key = hyp.Key();
+  hyps_dict_.emplace(key, std::move(hyp));
 }
 
 Hypothesis Hypotheses::GetMostProbable(bool length_norm) const {
@@ -48,8 +124,8 @@ Hypothesis Hypotheses::GetMostProbable(bool length_norm) const {
     return std::max_element(
                hyps_dict_.begin(), hyps_dict_.end(),
                [](const auto &left, const auto &right) -> bool {
-                 return left.second.log_prob / left.second.ys.size() <
-                        right.second.log_prob / right.second.ys.size();
+                 return left.second.log_prob / left.second.NumTokens() <
+                        right.second.log_prob / right.second.NumTokens();
                })
         ->second;
   }
@@ -69,8 +145,8 @@ std::vector<Hypothesis> Hypotheses::GetTopK(int32_t k, bool length_norm) const {
     // for length_norm is true
     std::partial_sort(all_hyps.begin(), all_hyps.begin() + k, all_hyps.end(),
                       [](const auto &a, const auto &b) {
-                        return a.log_prob / a.ys.size() >
-                               b.log_prob / b.ys.size();
+                        return a.log_prob / a.NumTokens() >
+                               b.log_prob / b.NumTokens();
                       });
   }
 
@@ -19,6 +19,8 @@
 #ifndef SHERPA_NCNN_CSRC_HYPOTHESIS_H_
 #define SHERPA_NCNN_CSRC_HYPOTHESIS_H_
 
+#include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -29,43 +31,81 @@
 
 namespace sherpa_ncnn {
 
-struct Hypothesis {
-  // The predicted tokens so far. Newly predicated tokens are appended.
-  std::vector<int32_t> ys;
+// A token of a hypothesis. Nodes form a prefix tree: hypotheses that share
+// a prefix share the nodes of the prefix, so extending a hypothesis by a
+// token does not copy the tokens decoded so far.
+struct HypothesisNode {
+  int32_t token;
+
+  // The frame number after subsampling on which token is decoded.
+  // It is -1 for the blanks added by Decoder::GetEmptyResult().
+  int32_t timestamp;
+
+  std::shared_ptr<HypothesisNode> parent;
 
-  // timestamps[i] contains the frame number after subsampling
-  // on which ys[i] is decoded.
-  std::vector<int32_t> timestamps;
+  HypothesisNode(int32_t token, int32_t timestamp,
+                 std::shared_ptr<HypothesisNode> parent)
+      : token(token), timestamp(timestamp), parent(std::move(parent)) {}
 
-  // The total score of ys in log space.
+  // Release the chain of parents iteratively to avoid deep recursion for
+  // long utterances.
+  ~HypothesisNode();
+};
+
+struct Hypothesis {
+  // The total score of the tokens in log space.
   double log_prob = 0;
-  const ContextState *context_state;
+  const ContextState *context_state = nullptr;
   int32_t num_trailing_blanks = 0;
 
   Hypothesis() = default;
   Hypothesis(const std::vector<int32_t> &ys, double log_prob,
-             const ContextState *context_state = nullptr)
-      : ys(ys), log_prob(log_prob), context_state(context_state) {}
+             const ContextState *context_state = nullptr);
 
-  // If two Hypotheses have the same `Key`, then they contain
-  // the same token sequence.
-  std::string Key() const {
-    // TODO(fangjun): Use a hash function?
-    std::ostringstream os;
-    std::string sep = "-";
-    for (auto i : ys) {
-      os << i << sep;
-      sep = "-";
-    }
-    return os.str();
-  }
+  // Append a token decoded on frame t.
+  void Append(int32_t token, int32_t t);
+
+  // Number of tokens, including the leading blanks
+  int32_t NumTokens() const { return num_tokens_; }
+
+  // The predicted tokens so far, including the leading blanks.
+  // It takes O(NumTokens()) time.
+  std::vector<int32_t> Ys() const;
+
+  // timestamps[i] contains the frame number after subsampling on which
+  // the i-th non-leading-blank token is decoded.
+  // It takes O(NumTokens()) time.
+  std::vector<int32_t> Timestamps() const;
+
+  // Copy the last n tokens to out. It takes O(n) time.
+  //
+  // @param n  It must not be larger than NumTokens().
+  void GetLastTokens(int32_t n, int32_t *out) const;
+
+  // If two Hypotheses contain the same token sequence, they have the same
+  // `Key`. It is updated incrementally in Append().
+  uint64_t Key() const { return key_; }
+
+  // Return true if this object contains the same tokens as other.
+  bool HasSameTokens(const Hypothesis &other) const;
 
   // For debugging
   std::string ToString() const {
     std::ostringstream os;
-    os << "(" << Key() << ", " << log_prob << ")";
+    os << "(";
+    std::string sep;
+    for (auto i : Ys()) {
+      os << sep << i;
+      sep = "-";
+    }
+    os << ", " << log_prob << ")";
     return os.str();
   }
+
+ private:
+  std::shared_ptr<HypothesisNode> node_;  // the last token
+  int32_t num_tokens_ = 0;
+  uint64_t key_ = 0;
 };
 
 class Hypotheses {
@@ -74,25 +114,25 @@ class Hypotheses {
 
   explicit Hypotheses(std::vector<Hypothesis> hyps) {
     for (auto &h : hyps) {
-      hyps_dict_[h.Key()] = std::move(h);
+      Add(std::move(h));
     }
   }
 
-  explicit Hypotheses(std::unordered_map<std::string, Hypothesis> hyps_dict)
-      : hyps_dict_(std::move(hyps_dict)) {}
-
   // Add hyp to this object. If it already exists, its log_prob
   // is updated with the given hyp using log-sum-exp.
   void Add(Hypothesis hyp);
 
   // Get the hyp that has the largest log_prob.
   // If length_norm is true, hyp's log_prob is divided by
-  // len(hyp.ys) before comparison.
+  // its number of tokens before comparison.
   Hypothesis GetMostProbable(bool length_norm) const;
 
   // Get the k hyps that have the largest log_prob.
   // If length_norm is true, hyp's log_prob is divided by
-  // len(hyp.ys) before comparison.
+  // its number of tokens before comparison.
+  //
+  // Copying a hypothesis does not copy its tokens, so it does not depend
+  // on the length of the hypothesis.
   std::vector<Hypothesis> GetTopK(int32_t k, bool length_norm) const;
 
   int32_t Size() const { return hyps_dict_.size(); }
@@ -124,7 +164,9 @@ class Hypotheses {
   }
 
  private:
-  using Map = std ::unordered_map<std::string, Hypothesis>;
+  // Hypotheses with different tokens can have the same key in case of
+  // a hash collision, so it is a multimap.
+  using Map = std::unordered_multimap<uint64_t, Hypothesis>;
   Map hyps_dict_;
 };
 
@@ -0,0 +1,299 @@
+// sherpa-ncnn/csrc/layer-profile.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/layer-profile.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include "sherpa-ncnn/csrc/trace.h"
+
+namespace sherpa_ncnn {
+
+struct LayerProfile::Counter {
+  std::string net;
+  std::string type;
+  std::string name;
+
+  std::atomic<int64_t> count{0};
+  std::atomic<int64_t> total_ns{0};
+};
+
+// It takes the place of a layer in the network and forwards the calls to
+// it. ncnn decides how to call a layer and how to convert its inputs from
+// the flags of the layer, e.g., one_blob_only, support_inplace and
+// support_packing, so they are copied from the original layer.
+class LayerProfile::ProfiledLayer : public ncnn::Layer {
+ public:
+  ProfiledLayer(ncnn::Layer *layer, Counter *counter)
+      : layer_(layer), counter_(counter) {
+    ncnn::Layer::operator=(*layer);
+  }
+
+  ~ProfiledLayer() override { delete layer_; }
+
+  using ncnn::Layer::forward;
+  using ncnn::Layer::forward_inplace;
+
+  int load_param(const ncnn::ParamDict &pd) override {
+    return layer_->load_param(pd);
+  }
+
+  int load_model(const ncnn::ModelBin &mb) override {
+    return layer_->load_model(mb);
+  }
+
+  int create_pipeline(const ncnn::Option &opt) override {
+    return layer_->create_pipeline(opt);
+  }
+
+  int destroy_pipeline(const ncnn::Option &opt) override {
+    return layer_->destroy_pipeline(opt);
+  }
+
+  int forward(const std::vector<ncnn::Mat> &bottom_blobs,
+              std::vector<ncnn::Mat> &top_blobs,
+              const ncnn::Option &opt) const override {
+    Timer timer(counter_);
+    return layer_->forward(bottom_blobs, top_blobs, opt);
+  }
+
+  int forward(const ncnn::Mat &bottom_blob, ncnn::Mat &top_blob,
+              const ncnn::Option &opt) const override {
+    Timer timer(counter_);
+    return layer_->forward(bottom_blob, top_blob, opt);
+  }
+
+  int forward_inplace(std::vector<ncnn::Mat> &bottom_top_blobs,
+                      const ncnn::Option &opt) const override {
+    Timer timer(counter_);
+    return layer_->forward_inplace(bottom_top_blobs, opt);
+  }
+
+  int forward_inplace(ncnn::Mat &bottom_top_blob,
+                      const ncnn::Option &opt) const override {
+    Timer timer(counter_);
+    return layer_->forward_inplace(bottom_top_blob, opt);
+  }
+
+ private:
+  class Timer {
+   public:
+    explicit Timer(Counter *counter)
+        : counter_(counter), start_ns_(TraceNowNs()) {}
+
+    ~Timer() {
+      counter_->count.fetch_add(1, std::memory_order_relaxed);
+      counter_->total_ns.fetch_add(TraceNowNs() - start_ns_,
+                                   std::memory_order_relaxed);
+    }
+
+   private:
+    Counter *counter_;
+    int64_t start_ns_;
+  };
+
+  ncnn::Layer *layer_;
+  Counter *counter_;
+};
+
+LayerProfile::LayerProfile() = default;
+
+LayerProfile::~LayerProfile() = default;
+
+void LayerProfile::Attach(const std::string &net_name, ncnn::Net *net) {
+  if (net->opt.use_vulkan_compute) {
+    NCNN_LOGE("Skip profiling the layers of %s since it uses Vulkan",
+              net_name.c_str());
+    return;
+  }
+
+  if (std::find(net_names_.begin(), net_names_.end(), net_name) ==
+      net_names_.end()) {
+    net_names_.push_back(net_name);
+  }
+
+  for (auto &layer : net->mutable_layers()) {
+    if (layer->type == "SherpaMetaData") {
+      continue;
+    }
+
+    auto counter = std::make_unique<Counter>();
+    counter->net = net_name;
+    counter->type = layer->type;
+    counter->name = layer->name;
+
+    layer = new ProfiledLayer(layer, counter.get());
+    counters_.push_back(std::move(counter));
+  }
+}
+
+std::vector<LayerProfileEntry> LayerProfile::Group(bool by_name) const {
+  std::vector<LayerProfileEntry> ans;
+
+  for (const auto &net_name : net_names_) {
+    std::map<std::string, LayerProfileEntry> groups;
+    double net_total_ms = 0;
+
+    for (const auto &c : counters_) {
+      if (c->net != net_name) {
+        continue;
+      }
+
+      LayerProfileEntry &e = groups[by_name ? c->name : c->type];
+      e.net = c->net;
+      e.type = c->type;
+      if (by_name) {
+        e.name = c->name;
+      }
+
+      double ms = c->total_ns.load(std::memory_order_relaxed) / 1e6;
+      e.num_layers += 1;
+      e.count += c->count.load(std::memory_order_relaxed);
+      e.total_ms += ms;
+      net_total_ms += ms;
+    }
+
+    size_t begin = ans.size();
+    for (auto &p : groups) {
+      LayerProfileEntry &e = p.second;
+      e.mean_ms = e.count ? e.total_ms / e.count : 0;
+      e.share = net_total_ms > 0 ? 100 * e.total_ms / net_total_ms : 0;
+      ans.push_back(std::move(e));
+    }
+
+    std::stable_sort(
+        ans.begin() + begin, ans.end(),
+        [](const LayerProfileEntry &a, const LayerProfileEntry &b) {
+          return a.total_ms > b.total_ms;
+        });
+  }
+
+  return ans;
+}
+
+std::vector<LayerProfileEntry> LayerProfile::ByType() const {
+  return Group(false);
+}
+
+std::vector<LayerProfileEntry> LayerProfile::ByName() const {
+  return Group(true);
+}
+
+std::string LayerProfile::ToString(int32_t max_layers /*= 20*/) const {
+  std::vector<LayerProfileEntry> by_type = ByType();
+  std::vector<LayerProfileEntry> by_name = ByName();
+
+  std::ostringstream os;
+  char buf[512];
+
+  for (const auto &net_name : net_names_) {
+    double total_ms = 0;
+    int64_t num_layers = 0;
+    for (const auto &e : by_type) {
+      if (e.net == net_name) {
+        total_ms += e.total_ms;
+        num_layers += e.num_layers;
+      }
+    }
+
+    snprintf(buf, sizeof(buf), "%s: %lld layers, %.3f ms\n", net_name.c_str(),
+             static_cast<long long>(num_layers), total_ms);  // NOLINT
+    os << buf;
+
+    snprintf(buf, sizeof(buf), "  %-28s %7s %10s %11s %6s %10s\n", "type",
+             "layers", "calls", "total(ms)", "share", "mean(ms)");
+    os << buf;
+
+    for (const auto &e : by_type) {
+      if (e.net != net_name) {
+        continue;
+      }
+
+      snprintf(buf, sizeof(buf), "  %-28s %7d %10lld %11.3f %5.1f%% %10.4f\n",
+               e.type.c_str(), e.num_layers,
+               static_cast<long long>(e.count), e.total_ms,  // NOLINT
+               e.share, e.mean_ms);
+      os << buf;
+    }
+
+    snprintf(buf, sizeof(buf), "  %-40s %-28s %11s %6s %10s\n", "layer",
+             "type", "total(ms)", "share", "mean(ms)");
+    os << buf;
+
+    int32_t k = 0;
+    for (const auto &e : by_name) {
+      if (e.net != net_name || k == max_layers) {
+        continue;
+      }
+      ++k;
+
+      snprintf(buf, sizeof(buf), "  %-40s %-28s %11.3f %5.1f%% %10.4f\n",
+               e.name.c_str(), e.type.c_str(), e.total_ms, e.share,
+               e.mean_ms);
+      os << buf;
+    }
+
+    os << "\n";
+  }
+
+  return os.str();
+}
+
+// Quote a field of a CSV file if needed
+static std::string CsvField(const std::string &s) {
+  if (s.find_first_of(",\"\n") == std::string::npos) {
+    return s;
+  }
+
+  std::string ans = "\"";
+  for (char c : s) {
+    if (c == '"') {
+      ans += '"';
+    }
+    ans += c;
+  }
+  ans += '"';
+
+  return ans;
+}
+
+bool LayerProfile::WriteCsv(const std::string &filename) const {
+  FILE *fp = fopen(filename.c_str(), "w");
+  if (!fp) {
+    return false;
+  }
+
+  fprintf(fp, "net,group,type,name,layers,calls,total_ms,mean_ms,share\n");
+
+  auto write = [fp](const std::vector<LayerProfileEntry> &entries,
+                    const char *group) {
+    for (const auto &e : entries) {
+      fprintf(fp, "%s,%s,%s,%s,%d,%lld,%.6f,%.6f,%.3f\n",
+              CsvField(e.net).c_str(), group, CsvField(e.type).c_str(),
+              CsvField(e.name).c_str(), e.num_layers,
+              static_cast<long long>(e.count),  // NOLINT
+              e.total_ms, e.mean_ms, e.share);
+    }
+  };
+
+  write(ByType(), "type");
+  write(ByName(), "name");
+
+  return fclose(fp) == 0;
+}
+
+void LayerProfile::Reset() {
+  for (auto &c : counters_) {
+    c->count.store(0, std::memory_order_relaxed);
+    c->total_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace sherpa_ncnn
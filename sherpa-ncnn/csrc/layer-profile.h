@@ -0,0 +1,112 @@
+// sherpa-ncnn/csrc/layer-profile.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_LAYER_PROFILE_H_
+#define SHERPA_NCNN_CSRC_LAYER_PROFILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "net.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+struct LayerProfileEntry {
+  // e.g., encoder, decoder, decoder2d, joiner
+  std::string net;
+
+  // Layer type, e.g., Convolution, TensorAsStrided
+  std::string type;
+
+  // Layer name. It is empty for an entry of LayerProfile::ByType()
+  std::string name;
+
+  // Number of layers added up in this entry
+  int32_t num_layers = 0;
+
+  // Number of forward calls
+  int64_t count = 0;
+
+  double total_ms = 0;
+
+  // Per forward call
+  double mean_ms = 0;
+
+  // Percentage of the total time of the layers of the net
+  double share = 0;
+};
+
+// Time spent in each layer of ncnn networks, without rebuilding ncnn
+// with NCNN_BENCHMARK.
+//
+// Attach() replaces the layers of a network with proxies that time the
+// forward calls of the original layers. The times are added up over all
+// runs of the network, from all threads, and can be grouped by layer type
+// or by layer name.
+//
+// The time of a layer includes the conversion of its outputs, e.g., from
+// fp16 to fp32, done inside the layer, but not the conversion of its
+// inputs done by ncnn before calling it.
+class LayerProfile {
+ public:
+  LayerProfile();
+  ~LayerProfile();
+
+  LayerProfile(const LayerProfile &) = delete;
+  LayerProfile &operator=(const LayerProfile &) = delete;
+
+  /** Time the layers of a network.
+   *
+   * It must be called after the network is loaded and before it is run.
+   * Afterwards, net->layers() returns the proxies, so the layers can no
+   * longer be cast to their own classes. The SherpaMetaData layers are
+   * left untouched for that reason.
+   *
+   * The network is not profiled if it uses Vulkan, since the layers are
+   * then run asynchronously on the GPU.
+   *
+   * @param net_name  Name of the network in the report, e.g., decoder or
+   *                  decoder2d. The layers of networks attached with the
+   *                  same name are reported together.
+   * @param net  The network. The proxies are owned by it and they must not
+   *             be run after this object is destroyed.
+   */
+  void Attach(const std::string &net_name, ncnn::Net *net);
+
+  // Return the times grouped by net and layer type, sorted by net in
+  // the order of Attach() and then by decreasing total time
+  std::vector<LayerProfileEntry> ByType() const;
+
+  // The same as ByType() but grouped by net and layer name
+  std::vector<LayerProfileEntry> ByName() const;
+
+  /** Return tables of ByType() and of the top layers of ByName() of each
+   * net.
+   *
+   * @param max_layers  Maximum number of layers listed per net.
+   */
+  std::string ToString(int32_t max_layers = 20) const;
+
+  // Write ByType() and ByName() as CSV. The column group is either
+  // "type" or "name". Return false if the file cannot be written.
+  bool WriteCsv(const std::string &filename) const;
+
+  // It is not atomic with respect to running the networks
+  void Reset();
+
+ private:
+  struct Counter;
+  class ProfiledLayer;
+
+  std::vector<LayerProfileEntry> Group(bool by_name) const;
+
+  std::vector<std::string> net_names_;
+  std::vector<std::unique_ptr<Counter>> counters_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_LAYER_PROFILE_H_
@@ -0,0 +1,364 @@
+// sherpa-ncnn/csrc/log-softmax-topk.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/log-softmax-topk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SHERPA_NCNN_LOG_SOFTMAX_TOPK_NEON 1
+#elif (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// Compiled for AVX2 regardless of the compiler flags. It is used only if
+// the CPU supports it.
+#define SHERPA_NCNN_LOG_SOFTMAX_TOPK_AVX2 1
+#define SHERPA_NCNN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(__AVX2__)
+#include <immintrin.h>
+#define SHERPA_NCNN_LOG_SOFTMAX_TOPK_AVX2 1
+#define SHERPA_NCNN_TARGET_AVX2
+#endif
+
+namespace sherpa_ncnn {
+
+namespace {
+
+// Keep the k largest (value, index) pairs seen so far
+class TopkHeap {
+ public:
+  explicit TopkHeap(int32_t k) : k_(k) { items_.reserve(k); }
+
+  // A value that is not larger than it does not enter the heap
+  float Threshold() const {
+    return static_cast<int32_t>(items_.size()) < k_
+               ? -std::numeric_limits<float>::infinity()
+               : items_.front().first;
+  }
+
+  void Push(float value, int32_t index) {
+    if (static_cast<int32_t>(items_.size()) < k_) {
+      items_.emplace_back(value, index);
+      std::push_heap(items_.begin(), items_.end(), Greater());
+    } else if (value > items_.front().first) {
+      std::pop_heap(items_.begin(), items_.end(), Greater());
+      items_.back() = {value, index};
+      std::push_heap(items_.begin(), items_.end(), Greater());
+    }
+  }
+
+  std::vector<std::pair<float, int32_t>> &Items() { return items_; }
+
+  void Clear() { items_.clear(); }
+
+ private:
+  // The smallest value is at the front
+  using Greater = std::greater<std::pair<float, int32_t>>;
+
+  int32_t k_;
+  std::vector<std::pair<float, int32_t>> items_;
+};
+
+float RowMaxScalar(const float *p, int32_t n) {
+  return *std::max_element(p, p + n);
+}
+
+// Return sum_i exp(p[i] - m) and push p[i] to heap if it may be among
+// the top k of the row
+float RowSumExpScalar(const float *p, int32_t n, float m, int32_t start,
+                      TopkHeap *heap) {
+  float sum = 0;
+  float threshold = heap->Threshold();
+  for (int32_t i = start; i < n; ++i) {
+    sum += std::exp(p[i] - m);
+    if (p[i] > threshold) {
+      heap->Push(p[i], i);
+      threshold = heap->Threshold();
+    }
+  }
+  return sum;
+}
+
+// exp() for 8 (AVX2) or 4 (NEON) floats. It is the polynomial
+// approximation from Cephes, as used in sse_mathfun.h
+constexpr float kExpHi = 88.3762626647949f;
+constexpr float kExpLo = -88.3762626647949f;
+constexpr float kLog2e = 1.44269504088896341f;
+constexpr float kExpC1 = 0.693359375f;
+constexpr float kExpC2 = -2.12194440e-4f;
+constexpr float kExpP0 = 1.9875691500e-4f;
+constexpr float kExpP1 = 1.3981999507e-3f;
+constexpr float kExpP2 = 8.3334519073e-3f;
+constexpr float kExpP3 = 4.1665795894e-2f;
+constexpr float kExpP4 = 1.6666665459e-1f;
+constexpr float kExpP5 = 5.0000001201e-1f;
+
+#if SHERPA_NCNN_LOG_SOFTMAX_TOPK_AVX2
+
+SHERPA_NCNN_TARGET_AVX2 inline __m256 Exp256(__m256 x) {
+  x = _mm256_min_ps(x, _mm256_set1_ps(kExpHi));
+  x = _mm256_max_ps(x, _mm256_set1_ps(kExpLo));
+
+  // exp(x) = 2^n * exp(r), where n = floor(x * log2(e) + 0.5)
+  __m256 fx = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(kLog2e)),
+                            _mm256_set1_ps(0.5f));
+  fx = _mm256_floor_ps(fx);
+
+  x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(kExpC1)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(kExpC2)));
+
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 y = _mm256_set1_ps(kExpP0);
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kExpP1));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kExpP2));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kExpP3));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kExpP4));
+  y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(kExpP5));
+  y = _mm256_add_ps(_mm256_mul_ps(y, z), x);
+  y = _mm256_add_ps(y, _mm256_set1_ps(1.0f));
+
+  __m256i n = _mm256_cvttps_epi32(fx);
+  n = _mm256_add_epi32(n, _mm256_set1_epi32(127));
+  n = _mm256_slli_epi32(n, 23);
+
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(n));
+}
+
+SHERPA_NCNN_TARGET_AVX2 inline float HorizontalSum(__m256 x) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+SHERPA_NCNN_TARGET_AVX2 inline float HorizontalMax(__m256 x) {
+  __m128 s = _mm_max_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_max_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+SHERPA_NCNN_TARGET_AVX2 float RowMaxAvx2(const float *p, int32_t n) {
+  if (n < 8) {
+    return RowMaxScalar(p, n);
+  }
+
+  __m256 m = _mm256_loadu_ps(p);
+  int32_t i = 8;
+  for (; i + 8 <= n; i += 8) {
+    m = _mm256_max_ps(m, _mm256_loadu_ps(p + i));
+  }
+
+  float ans = HorizontalMax(m);
+  for (; i < n; ++i) {
+    ans = std::max(ans, p[i]);
+  }
+  return ans;
+}
+
+SHERPA_NCNN_TARGET_AVX2 float RowSumExpAvx2(const float *p, int32_t n,
+                                            float m, TopkHeap *heap) {
+  __m256 vm = _mm256_set1_ps(m);
+  __m256 vsum = _mm256_setzero_ps();
+  float threshold = heap->Threshold();
+  __m256 vthreshold = _mm256_set1_ps(threshold);
+
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(p + i);
+    vsum = _mm256_add_ps(vsum, Exp256(_mm256_sub_ps(x, vm)));
+
+    int32_t mask =
+        _mm256_movemask_ps(_mm256_cmp_ps(x, vthreshold, _CMP_GT_OQ));
+    if (mask) {
+      for (int32_t j = 0; j != 8; ++j) {
+        if (((mask >> j) & 1) && p[i + j] > threshold) {
+          heap->Push(p[i + j], i + j);
+          threshold = heap->Threshold();
+        }
+      }
+      vthreshold = _mm256_set1_ps(threshold);
+    }
+  }
+
+  return HorizontalSum(vsum) + RowSumExpScalar(p, n, m, i, heap);
+}
+
+bool CpuSupportsAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+  static const bool ans = __builtin_cpu_supports("avx2");
+  return ans;
+#else
+  return true;  // compiled with /arch:AVX2
+#endif
+}
+
+#endif  // SHERPA_NCNN_LOG_SOFTMAX_TOPK_AVX2
+
+#if SHERPA_NCNN_LOG_SOFTMAX_TOPK_NEON
+
+inline float32x4_t Exp128(float32x4_t x) {
+  x = vminq_f32(x, vdupq_n_f32(kExpHi));
+  x = vmaxq_f32(x, vdupq_n_f32(kExpLo));
+
+  // exp(x) = 2^n * exp(r), where n = floor(x * log2(e) + 0.5)
+  float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(kLog2e));
+
+  // floor(): truncate, then subtract 1 where truncation rounded up
+  float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+  uint32x4_t mask = vcgtq_f32(t, fx);
+  fx = vsubq_f32(t, vreinterpretq_f32_u32(
+                        vandq_u32(mask, vreinterpretq_u32_f32(
+                                            vdupq_n_f32(1.0f)))));
+
+  x = vmlsq_f32(x, fx, vdupq_n_f32(kExpC1));
+  x = vmlsq_f32(x, fx, vdupq_n_f32(kExpC2));
+
+  float32x4_t z = vmulq_f32(x, x);
+  float32x4_t y = vdupq_n_f32(kExpP0);
+  y = vmlaq_f32(vdupq_n_f32(kExpP1), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP2), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP3), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP4), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP5), y, x);
+  y = vmlaq_f32(x, y, z);
+  y = vaddq_f32(y, vdupq_n_f32(1.0f));
+
+  int32x4_t n = vcvtq_s32_f32(fx);
+  n = vaddq_s32(n, vdupq_n_s32(127));
+  n = vshlq_n_s32(n, 23);
+
+  return vmulq_f32(y, vreinterpretq_f32_s32(n));
+}
+
+inline float HorizontalSum(float32x4_t x) {
+  float32x2_t s = vadd_f32(vget_low_f32(x), vget_high_f32(x));
+  s = vpadd_f32(s, s);
+  return vget_lane_f32(s, 0);
+}
+
+inline float HorizontalMax(float32x4_t x) {
+  float32x2_t s = vmax_f32(vget_low_f32(x), vget_high_f32(x));
+  s = vpmax_f32(s, s);
+  return vget_lane_f32(s, 0);
+}
+
+float RowMaxNeon(const float *p, int32_t n) {
+  if (n < 4) {
+    return RowMaxScalar(p, n);
+  }
+
+  float32x4_t m = vld1q_f32(p);
+  int32_t i = 4;
+  for (; i + 4 <= n; i += 4) {
+    m = vmaxq_f32(m, vld1q_f32(p + i));
+  }
+
+  float ans = HorizontalMax(m);
+  for (; i < n; ++i) {
+    ans = std::max(ans, p[i]);
+  }
+  return ans;
+}
+
+float RowSumExpNeon(const float *p, int32_t n, float m, TopkHeap *heap) {
+  float32x4_t vm = vdupq_n_f32(m);
+  float32x4_t vsum = vdupq_n_f32(0);
+  float threshold = heap->Threshold();
+  float32x4_t vthreshold = vdupq_n_f32(threshold);
+
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t x = vld1q_f32(p + i);
+    vsum = vaddq_f32(vsum, Exp128(vsubq_f32(x, vm)));
+
+    uint32x4_t c = vcgtq_f32(x, vthreshold);
+    uint32x2_t any = vorr_u32(vget_low_u32(c), vget_high_u32(c));
+    if (vget_lane_u32(any, 0) | vget_lane_u32(any, 1)) {
+      for (int32_t j = 0; j != 4; ++j) {
+        if (p[i + j] > threshold) {
+          heap->Push(p[i + j], i + j);
+          threshold = heap->Threshold();
+        }
+      }
+      vthreshold = vdupq_n_f32(threshold);
+    }
+  }
+
+  return HorizontalSum(vsum) + RowSumExpScalar(p, n, m, i, heap);
+}
+
+#endif  // SHERPA_NCNN_LOG_SOFTMAX_TOPK_NEON
+
+// Return the max of the row and the sum of exp(p[i] - max). Candidates for
+// the top k of the row are pushed to heap.
+void ProcessRow(const float *p, int32_t n, TopkHeap *heap, float *max,
+                float *sum) {
+#if SHERPA_NCNN_LOG_SOFTMAX_TOPK_AVX2
+  if (CpuSupportsAvx2()) {
+    *max = RowMaxAvx2(p, n);
+    *sum = RowSumExpAvx2(p, n, *max, heap);
+    return;
+  }
+#elif SHERPA_NCNN_LOG_SOFTMAX_TOPK_NEON
+  *max = RowMaxNeon(p, n);
+  *sum = RowSumExpNeon(p, n, *max, heap);
+  return;
+#endif
+
+  *max = RowMaxScalar(p, n);
+  *sum = RowSumExpScalar(p, n, *max, 0, heap);
+}
+
+}  // namespace
+
+void LogSoftmaxTopk(const float *x, int32_t num_rows, int32_t num_cols,
+                    const float *offsets, int32_t k,
+                    std::vector<int32_t> *indexes,
+                    std::vector<float> *values /*= nullptr*/) {
+  k = std::max(1, std::min(k, num_rows * num_cols));
+
+  // Entries of a row keep their order after log_softmax, so the top k of
+  // the whole matrix are among the top k of each row.
+  TopkHeap row_heap(k);
+  TopkHeap heap(k);
+
+  for (int32_t r = 0; r != num_rows; ++r) {
+    const float *p = x + static_cast<int64_t>(r) * num_cols;
+
+    float max = 0;
+    float sum = 0;
+    row_heap.Clear();
+    ProcessRow(p, num_cols, &row_heap, &max, &sum);
+
+    float shift = (offsets ? offsets[r] : 0) - (max + std::log(sum));
+    for (const auto &item : row_heap.Items()) {
+      heap.Push(item.first + shift, r * num_cols + item.second);
+    }
+  }
+
+  auto &items = heap.Items();
+  std::sort(items.begin(), items.end(),
+            std::greater<std::pair<float, int32_t>>());
+
+  indexes->resize(items.size());
+  if (values) {
+    values->resize(items.size());
+  }
+
+  for (int32_t i = 0; i != static_cast<int32_t>(items.size()); ++i) {
+    (*indexes)[i] = items[i].second;
+    if (values) {
+      (*values)[i] = items[i].first;
+    }
+  }
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,43 @@
+// sherpa-ncnn/csrc/log-softmax-topk.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_LOG_SOFTMAX_TOPK_H_
+#define SHERPA_NCNN_CSRC_LOG_SOFTMAX_TOPK_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+/** Compute log_softmax() of each row of x, add offsets[r] to the r-th row,
+ * and find the k largest entries of the result among all rows.
+ *
+ * It is equivalent to calling LogSoftmax() on each row, adding the offsets,
+ * and calling TopkIndex() on the whole matrix, but x is not modified, no
+ * index array of size num_rows * num_cols is allocated, and each row is
+ * read only twice: once for its maximum and once for the sum of
+ * exponentials, during which the candidates for the top k are collected.
+ *
+ * It uses AVX2 on x86 CPUs that support it and NEON on ARM.
+ *
+ * @param x  A row-major matrix of shape (num_rows, num_cols)
+ * @param num_rows  Number of rows of x
+ * @param num_cols  Number of columns of x, e.g., the vocabulary size
+ * @param offsets  An array of num_rows entries, e.g., the log_prob of each
+ *                 hypothesis. If it is nullptr, no offsets are added.
+ * @param k  Number of entries to return
+ * @param indexes  On return, it contains min(k, num_rows * num_cols) indexes
+ *                 into the flattened x, i.e., r * num_cols + c, sorted by
+ *                 their values in descending order.
+ * @param values  If not nullptr, on return it contains the log_softmax value,
+ *                plus the offset, of each entry in indexes.
+ */
+void LogSoftmaxTopk(const float *x, int32_t num_rows, int32_t num_cols,
+                    const float *offsets, int32_t k,
+                    std::vector<int32_t> *indexes,
+                    std::vector<float> *values = nullptr);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_LOG_SOFTMAX_TOPK_H_
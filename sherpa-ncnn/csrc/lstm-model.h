@@ -84,6 +84,10 @@ class LstmModel : public Model {
   // running the encoder network
   int32_t Offset() const override { return 4; }
 
+ protected:
+  // The encoder takes the number of frames as an input
+  bool EncoderAcceptsVariableLength() const override { return true; }
+
  private:
   void InitEncoder(const std::string &encoder_param,
                    const std::string &encoder_bin);
@@ -17,10 +17,19 @@
  */
 #include "sherpa-ncnn/csrc/model.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "sherpa-ncnn/csrc/conv-emformer-model.h"
 #include "sherpa-ncnn/csrc/lstm-model.h"
+#include "sherpa-ncnn/csrc/math.h"
 #include "sherpa-ncnn/csrc/meta-data.h"
 #include "sherpa-ncnn/csrc/poolingmodulenoproj.h"
 #include "sherpa-ncnn/csrc/simpleupsample.h"
@@ -28,6 +37,10 @@
 #include "sherpa-ncnn/csrc/tensorasstrided.h"
 #include "sherpa-ncnn/csrc/zipformer-model.h"
 
+#if __ANDROID_API__ >= 9
+#include "android/asset_manager.h"
+#endif
+
 namespace sherpa_ncnn {
 
 std::string ModelConfig::ToString() const {
@@ -40,9 +53,11 @@ std::string ModelConfig::ToString() const {
   os << "joiner_param=\"" << joiner_param << "\", ";
   os << "joiner_bin=\"" << joiner_bin << "\", ";
   os << "tokens=\"" << tokens << "\", ";
+  os << "feature_dim=" << feature_dim << ", ";
   os << "encoder num_threads=" << encoder_opt.num_threads << ", ";
   os << "decoder num_threads=" << decoder_opt.num_threads << ", ";
-  os << "joiner num_threads=" << joiner_opt.num_threads << ")";
+  os << "joiner num_threads=" << joiner_opt.num_threads << ", ";
+  os << "profile_layers=" << (profile_layers ? "True" : "False") << ")";
 
   return os.str();
 }
@@ -151,6 +166,614 @@ void Model::InitNet(AAssetManager *mgr, ncnn::Net &net,
 }
 #endif
 
+void Model::EnableLayerProfile() {
+  if (layer_profile_) {
+    return;
+  }
+
+  layer_profile_ = std::make_unique<LayerProfile>();
+  layer_profile_->Attach("encoder", &GetEncoder());
+  layer_profile_->Attach("decoder", &GetDecoder());
+  if (has_decoder2d_.load(std::memory_order_acquire)) {
+    layer_profile_->Attach("decoder2d", &decoder2d_);
+  }
+  layer_profile_->Attach("joiner", &GetJoiner());
+}
+
+std::vector<ncnn::Mat> Model::RunEncoderBatch(
+    const std::vector<ncnn::Mat> &features,
+    std::vector<std::vector<ncnn::Mat>> *states,
+    const std::vector<ExecutionContext *> &ctx) {
+  int32_t n = static_cast<int32_t>(features.size());
+  std::vector<ncnn::Mat> encoder_out(n);
+
+  const ncnn::Option &opt = GetEncoder().opt;
+
+  // Concurrent extractors on the same net are fine for the CPU. Layers
+  // invoked inside the parallel region below run with a single thread
+  // since nested OpenMP parallelism is disabled by default.
+  int32_t num_threads = opt.use_vulkan_compute ? 1 : opt.num_threads;
+  num_threads = std::max(1, std::min(num_threads, n));
+
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+  for (int32_t i = 0; i < n; ++i) {
+    ncnn::Mat f = features[i];
+    ncnn::Extractor ex =
+        CreateExtractor(GetEncoder(), ctx.empty() ? nullptr : ctx[i]);
+    std::tie(encoder_out[i], (*states)[i]) = RunEncoder(f, (*states)[i], &ex);
+  }
+
+  return encoder_out;
+}
+
+std::vector<ncnn::Mat> Model::RunEncoderChunksBatch(
+    const std::vector<ncnn::Mat> &features,
+    const std::vector<int32_t> &num_chunks,
+    std::vector<std::vector<ncnn::Mat>> *states,
+    const std::vector<ExecutionContext *> &ctx) {
+  int32_t n = static_cast<int32_t>(features.size());
+  std::vector<ncnn::Mat> encoder_out(n);
+
+  const ncnn::Option &opt = GetEncoder().opt;
+
+  // See RunEncoderBatch()
+  int32_t num_threads = opt.use_vulkan_compute ? 1 : opt.num_threads;
+  num_threads = std::max(1, std::min(num_threads, n));
+
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+  for (int32_t i = 0; i < n; ++i) {
+    ncnn::Mat f = features[i];
+    std::tie(encoder_out[i], (*states)[i]) =
+        RunEncoderChunks(f, num_chunks[i], (*states)[i],
+                         ctx.empty() ? nullptr : ctx[i]);
+  }
+
+  return encoder_out;
+}
+
+std::pair<ncnn::Mat, std::vector<ncnn::Mat>> Model::RunEncoderChunks(
+    ncnn::Mat &features, int32_t num_chunks,
+    const std::vector<ncnn::Mat> &states, ExecutionContext *ctx) {
+  if (num_chunks > 1 && has_variable_length_encoder_) {
+    ncnn::Extractor ex = CreateExtractor(GetEncoder(), ctx);
+    return RunEncoder(features, states, &ex);
+  }
+
+  return RunEncoderChunkByChunk(features, num_chunks, states, ctx);
+}
+
+std::pair<ncnn::Mat, std::vector<ncnn::Mat>> Model::RunEncoderChunkByChunk(
+    ncnn::Mat &features, int32_t num_chunks,
+    const std::vector<ncnn::Mat> &states, ExecutionContext *ctx) {
+  int32_t segment = Segment();
+  int32_t offset = Offset();
+
+  std::vector<ncnn::Mat> encoder_out(num_chunks);
+  std::vector<ncnn::Mat> next_states = states;
+  int32_t num_frames = 0;
+
+  for (int32_t i = 0; i != num_chunks; ++i) {
+    // A view of the frames of the chunk that shares the reference count of
+    // features, so that ncnn copies it before modifying it in-place
+    ncnn::Mat chunk = features;
+    chunk.data = features.row(i * offset);
+    chunk.h = segment;
+    chunk.cstep = static_cast<size_t>(chunk.w) * segment;
+
+    ncnn::Extractor ex = CreateExtractor(GetEncoder(), ctx);
+    std::tie(encoder_out[i], next_states) = RunEncoder(chunk, next_states, &ex);
+    num_frames += encoder_out[i].h;
+  }
+
+  if (num_chunks == 1) {
+    return {encoder_out[0], next_states};
+  }
+
+  ncnn::Mat ans(encoder_out[0].w, num_frames);
+  float *p = ans;
+  for (const auto &m : encoder_out) {
+    const float *q = m;
+    p = std::copy(q, q + m.w * m.h, p);
+  }
+
+  return {ans, next_states};
+}
+
+void Model::InitVariableLengthEncoder(int32_t feature_dim) {
+  if (!EncoderAcceptsVariableLength()) {
+    return;
+  }
+
+  int32_t num_chunks = 3;
+  int32_t num_frames = Segment() + (num_chunks - 1) * Offset();
+
+  ncnn::Mat features(feature_dim, num_frames);
+  RandomVectorFill(features, feature_dim * num_frames, -1, 1);
+
+  std::vector<ncnn::Mat> states = GetEncoderInitStates();
+
+  ncnn::Mat expected_out;
+  std::vector<ncnn::Mat> expected_states;
+  std::tie(expected_out, expected_states) =
+      RunEncoderChunkByChunk(features, num_chunks, states, nullptr);
+
+  ncnn::Mat encoder_out;
+  std::vector<ncnn::Mat> next_states;
+  ncnn::Extractor ex = GetEncoder().create_extractor();
+  std::tie(encoder_out, next_states) = RunEncoder(features, states, &ex);
+
+  auto is_close = [](const ncnn::Mat &a, const ncnn::Mat &b) {
+    if (a.total() != b.total() || a.w != b.w) {
+      return false;
+    }
+
+    const float *p = a;
+    const float *q = b;
+    for (size_t i = 0; i != a.total(); ++i) {
+      // fp16 storage and arithmetic may be enabled
+      if (std::abs(p[i] - q[i]) > 1e-2f + 1e-2f * std::abs(q[i])) {
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  if (!is_close(encoder_out, expected_out) ||
+      next_states.size() != expected_states.size()) {
+    return;
+  }
+
+  for (size_t i = 0; i != next_states.size(); ++i) {
+    if (!is_close(next_states[i], expected_states[i])) {
+      return;
+    }
+  }
+
+  has_variable_length_encoder_ = true;
+}
+
+ncnn::Mat Model::RunDecoder2D(ncnn::Mat &decoder_input,
+                              ExecutionContext *ctx) {
+  if (decoder_input.h == 1 ||
+      !has_decoder2d_.load(std::memory_order_acquire)) {
+    return RunDecoderRowByRow(decoder_input, ctx);
+  }
+
+  ncnn::Extractor ex = CreateExtractor(decoder2d_, ctx);
+  ex.input("in0", decoder_input);
+
+  ncnn::Mat decoder_out;
+  ex.extract("out0", decoder_out);
+
+  return decoder_out;
+}
+
+ncnn::Mat Model::RunDecoderRowByRow(ncnn::Mat &decoder_input,
+                                    ExecutionContext *ctx) {
+  ncnn::Mat decoder_out;
+  int32_t h = decoder_input.h;
+
+  for (int32_t y = 0; y != h; ++y) {
+    ncnn::Mat decoder_input_t =
+        ncnn::Mat(decoder_input.w, decoder_input.row(y));
+
+    ncnn::Extractor ex = CreateExtractor(GetDecoder(), ctx);
+    ncnn::Mat tmp = RunDecoder(decoder_input_t, &ex);
+
+    if (y == 0) {
+      decoder_out = ncnn::Mat(tmp.w, h);
+    }
+
+    const float *ptr = tmp;
+    float *out_ptr = decoder_out.row(y);
+    std::copy(ptr, ptr + tmp.w, out_ptr);
+  }
+
+  return decoder_out;
+}
+
+// Return an empty string if the file cannot be read
+static std::string ReadFile(const std::string &filename) {
+  std::ifstream is(filename);
+  if (!is) {
+    return {};
+  }
+
+  std::ostringstream os;
+  os << is.rdbuf();
+  return os.str();
+}
+
+#if __ANDROID_API__ >= 9
+static std::string ReadFile(AAssetManager *mgr, const std::string &filename) {
+  AAsset *asset = AAssetManager_open(mgr, filename.c_str(), AASSET_MODE_BUFFER);
+  if (!asset) {
+    return {};
+  }
+
+  auto p = reinterpret_cast<const char *>(AAsset_getBuffer(asset));
+  std::string ans(p, AAsset_getLength(asset));
+  AAsset_close(asset);
+  return ans;
+}
+#endif
+
+// Return the decoder param with the stride of the depthwise convolution
+// set to its kernel size. Return an empty string if the network does not
+// look like the decoder of a stateless transducer.
+static std::string ConvertDecoderParamTo2D(const std::string &param,
+                                           int32_t context_size) {
+  std::istringstream is(param);
+  std::ostringstream os;
+
+  std::string line;
+  int32_t num_conv = 0;
+  int32_t num_embed = 0;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    std::vector<std::string> fields;
+    std::string f;
+    while (iss >> f) {
+      fields.push_back(f);
+    }
+
+    if (fields.empty() || fields[0] != "ConvolutionDepthWise1D") {
+      if (!fields.empty() && fields[0] == "Embed") {
+        ++num_embed;
+      }
+      os << line << "\n";
+      continue;
+    }
+
+    ++num_conv;
+    if (fields.size() < 4) {
+      return {};
+    }
+
+    // type name num_bottoms num_tops bottoms... tops... key=value...
+    int32_t start = 4 + atoi(fields[2].c_str()) + atoi(fields[3].c_str());
+    if (start > static_cast<int32_t>(fields.size())) {
+      return {};
+    }
+
+    for (int32_t i = 0; i != start; ++i) {
+      os << fields[i] << " ";
+    }
+
+    int32_t kernel_w = 0;
+    for (int32_t i = start; i < static_cast<int32_t>(fields.size()); ++i) {
+      const std::string &kv = fields[i];
+      auto pos = kv.find('=');
+      if (pos == std::string::npos) {
+        return {};
+      }
+
+      int32_t key = atoi(kv.substr(0, pos).c_str());
+      int32_t value = atoi(kv.substr(pos + 1).c_str());
+      switch (key) {
+        case 1:  // kernel_w
+          kernel_w = value;
+          break;
+        case 2:  // dilation_w
+          if (value != 1) return {};
+          break;
+        case 3:  // stride_w
+          if (value != 1) return {};
+          continue;  // replaced below
+        case 4:   // pad_left
+        case 15:  // pad_right
+        case 18:  // pad_value
+          if (value != 0) return {};
+          break;
+        default:
+          break;
+      }
+      os << kv << " ";
+    }
+
+    if (kernel_w != context_size) {
+      return {};
+    }
+
+    os << "3=" << context_size << "\n";
+  }
+
+  if (num_embed != 1 || num_conv != (context_size > 1 ? 1 : 0)) {
+    return {};
+  }
+
+  return os.str();
+}
+
+void Model::InitDecoder2D(const std::string &param, const std::string &bin) {
+  std::string param_2d =
+      ConvertDecoderParamTo2D(ReadFile(param), ContextSize());
+  if (param_2d.empty()) {
+    return;
+  }
+
+  decoder2d_.opt = GetDecoder().opt;
+  RegisterCustomLayers(decoder2d_);
+
+  if (decoder2d_.load_param_mem(param_2d.c_str()) ||
+      decoder2d_.load_model(bin.c_str())) {
+    decoder2d_.clear();
+    return;
+  }
+
+  if (!CheckDecoder2D()) {
+    decoder2d_.clear();
+    return;
+  }
+
+  if (layer_profile_) {
+    layer_profile_->Attach("decoder2d", &decoder2d_);
+  }
+
+  has_decoder2d_.store(true, std::memory_order_release);
+}
+
+#if __ANDROID_API__ >= 9
+void Model::InitDecoder2D(AAssetManager *mgr, const std::string &param,
+                          const std::string &bin) {
+  std::string param_2d =
+      ConvertDecoderParamTo2D(ReadFile(mgr, param), ContextSize());
+  if (param_2d.empty()) {
+    return;
+  }
+
+  decoder2d_.opt = GetDecoder().opt;
+  RegisterCustomLayers(decoder2d_);
+
+  if (decoder2d_.load_param_mem(param_2d.c_str()) ||
+      decoder2d_.load_model(mgr, bin.c_str())) {
+    decoder2d_.clear();
+    return;
+  }
+
+  if (!CheckDecoder2D()) {
+    decoder2d_.clear();
+    return;
+  }
+
+  if (layer_profile_) {
+    layer_profile_->Attach("decoder2d", &decoder2d_);
+  }
+
+  has_decoder2d_.store(true, std::memory_order_release);
+}
+#endif
+
+void Model::EnableDecoder2D() {
+  std::call_once(decoder2d_once_, [this]() {
+#if __ANDROID_API__ >= 9
+    if (mgr_) {
+      InitDecoder2D(mgr_, decoder_param_, decoder_bin_);
+      return;
+    }
+#endif
+
+    InitDecoder2D(decoder_param_, decoder_bin_);
+  });
+}
+
+bool Model::CheckDecoder2D() {
+  int32_t context_size = ContextSize();
+  int32_t num_rows = 3;
+
+  ncnn::Mat decoder_input(context_size, num_rows);
+  for (int32_t i = 0; i != context_size * num_rows; ++i) {
+    // Token IDs that exist in any vocabulary. The blank is included
+    static_cast<int32_t *>(decoder_input)[i] = i % 5;
+  }
+
+  ncnn::Mat expected = RunDecoderRowByRow(decoder_input, nullptr);
+
+  ncnn::Extractor ex = decoder2d_.create_extractor();
+  ex.input("in0", decoder_input);
+
+  ncnn::Mat decoder_out;
+  if (ex.extract("out0", decoder_out) != 0 || decoder_out.dims != 2 ||
+      decoder_out.w != expected.w || decoder_out.h != num_rows) {
+    return false;
+  }
+
+  for (int32_t y = 0; y != num_rows; ++y) {
+    const float *p = decoder_out.row(y);
+    const float *q = expected.row(y);
+    for (int32_t x = 0; x != expected.w; ++x) {
+      // fp16 storage and arithmetic may be enabled
+      if (std::abs(p[x] - q[x]) > 1e-2f + 1e-2f * std::abs(q[x])) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+ncnn::Mat Model::RunJoinerEncoderProj(ncnn::Mat &encoder_out,
+                                      ExecutionContext *ctx) {
+  ncnn::Extractor ex = CreateExtractor(GetJoiner(), ctx);
+  ex.input(joiner_encoder_in_, encoder_out);
+
+  ncnn::Mat encoder_proj;
+  ex.extract(joiner_encoder_proj_, encoder_proj);
+  return encoder_proj;
+}
+
+ncnn::Mat Model::RunJoinerDecoderProj(ncnn::Mat &decoder_out,
+                                      ExecutionContext *ctx) {
+  ncnn::Extractor ex = CreateExtractor(GetJoiner(), ctx);
+  ex.input(joiner_decoder_in_, decoder_out);
+
+  ncnn::Mat decoder_proj;
+  ex.extract(joiner_decoder_proj_, decoder_proj);
+  return decoder_proj;
+}
+
+ncnn::Mat Model::RunJoinerFromProjections(ncnn::Mat &encoder_proj,
+                                          ncnn::Mat &decoder_proj,
+                                          ExecutionContext *ctx) {
+  // The projection layers are skipped since their outputs are given
+  ncnn::Extractor ex = CreateExtractor(GetJoiner(), ctx);
+  ex.input(joiner_encoder_proj_, encoder_proj);
+  ex.input(joiner_decoder_proj_, decoder_proj);
+
+  ncnn::Mat joiner_out;
+  ex.extract(joiner_out_, joiner_out);
+  return joiner_out;
+}
+
+ncnn::Mat Model::RunDecoderForJoiner(ncnn::Mat &decoder_input,
+                                     ExecutionContext *ctx) {
+  ncnn::Mat decoder_out = RunDecoder2D(decoder_input, ctx);
+  if (!has_joiner_projections_) {
+    return decoder_out;
+  }
+
+  return RunJoinerDecoderProj(decoder_out, ctx);
+}
+
+// Return the input dimension of the InnerProduct layer with the given name,
+// i.e., weight_data_size / num_output. Return 0 if it is not found.
+static int32_t InnerProductNumInput(const std::string &param,
+                                    const std::string &name) {
+  std::istringstream is(param);
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    std::string type;
+    std::string layer_name;
+    if (!(iss >> type >> layer_name) || type != "InnerProduct" ||
+        layer_name != name) {
+      continue;
+    }
+
+    int32_t num_output = 0;
+    int64_t weight_data_size = 0;
+    std::string kv;
+    while (iss >> kv) {
+      if (kv.compare(0, 2, "0=") == 0) {
+        num_output = atoi(kv.c_str() + 2);
+      } else if (kv.compare(0, 2, "2=") == 0) {
+        weight_data_size = atoll(kv.c_str() + 2);
+      }
+    }
+
+    if (num_output <= 0 || weight_data_size % num_output != 0) {
+      return 0;
+    }
+
+    return static_cast<int32_t>(weight_data_size / num_output);
+  }
+
+  return 0;
+}
+
+void Model::InitJoinerProjections(const std::string &param) {
+  const ncnn::Net &joiner = GetJoiner();
+  const auto &blobs = joiner.blobs();
+  const auto &layers = joiner.layers();
+
+  auto find_blob = [&blobs](const char *name) -> int32_t {
+    for (int32_t i = 0; i != static_cast<int32_t>(blobs.size()); ++i) {
+      if (blobs[i].name == name) return i;
+    }
+    return -1;
+  };
+
+  // Return the layer producing the given blob if its type is the given one
+  auto producer = [&blobs, &layers](int32_t blob,
+                                    const char *type) -> const ncnn::Layer * {
+    if (blob < 0 || blob >= static_cast<int32_t>(blobs.size())) {
+      return nullptr;
+    }
+
+    int32_t i = blobs[blob].producer;
+    if (i < 0 || i >= static_cast<int32_t>(layers.size()) ||
+        layers[i]->type != type) {
+      return nullptr;
+    }
+
+    return layers[i];
+  };
+
+  int32_t encoder_in = find_blob("in0");
+  int32_t decoder_in = find_blob("in1");
+  int32_t out = find_blob("out0");
+
+  const ncnn::Layer *out_proj = producer(out, "InnerProduct");
+  if (!out_proj || out_proj->bottoms.size() != 1) return;
+
+  const ncnn::Layer *tanh = producer(out_proj->bottoms[0], "TanH");
+  if (!tanh || tanh->bottoms.size() != 1) return;
+
+  const ncnn::Layer *add = producer(tanh->bottoms[0], "BinaryOp");
+  if (!add || add->bottoms.size() != 2) return;
+
+  int32_t encoder_proj = -1;
+  int32_t decoder_proj = -1;
+  int32_t encoder_dim = 0;
+  int32_t decoder_dim = 0;
+  for (int32_t b : add->bottoms) {
+    const ncnn::Layer *proj = producer(b, "InnerProduct");
+    if (!proj || proj->bottoms.size() != 1) return;
+
+    if (proj->bottoms[0] == encoder_in) {
+      encoder_proj = b;
+      encoder_dim = InnerProductNumInput(param, proj->name);
+    } else if (proj->bottoms[0] == decoder_in) {
+      decoder_proj = b;
+      decoder_dim = InnerProductNumInput(param, proj->name);
+    }
+  }
+
+  if (encoder_proj == -1 || decoder_proj == -1 || encoder_dim <= 0 ||
+      decoder_dim <= 0) {
+    return;
+  }
+
+  joiner_encoder_in_ = encoder_in;
+  joiner_decoder_in_ = decoder_in;
+  joiner_encoder_proj_ = encoder_proj;
+  joiner_decoder_proj_ = decoder_proj;
+  joiner_out_ = out;
+
+  // The add may also be something else, e.g., a multiplication, so we
+  // compare the result with the one from the whole joiner
+  int32_t num_rows = 3;
+  ncnn::Mat encoder_out(encoder_dim, num_rows);
+  ncnn::Mat decoder_out(decoder_dim, num_rows);
+  RandomVectorFill(encoder_out, encoder_dim * num_rows, -1, 1);
+  RandomVectorFill(decoder_out, decoder_dim * num_rows, -1, 1);
+
+  ncnn::Extractor ex = GetJoiner().create_extractor();
+  ncnn::Mat expected = RunJoiner(encoder_out, decoder_out, &ex);
+
+  ncnn::Mat encoder_proj_out = RunJoinerEncoderProj(encoder_out, nullptr);
+  ncnn::Mat decoder_proj_out = RunJoinerDecoderProj(decoder_out, nullptr);
+  ncnn::Mat joiner_out =
+      RunJoinerFromProjections(encoder_proj_out, decoder_proj_out, nullptr);
+
+  if (joiner_out.dims != expected.dims || joiner_out.w != expected.w ||
+      joiner_out.h != expected.h) {
+    return;
+  }
+
+  for (int32_t i = 0; i != expected.w * expected.h; ++i) {
+    float p = joiner_out[i];
+    float q = expected[i];
+    // fp16 storage and arithmetic may be enabled
+    if (std::abs(p - q) > 1e-2f + 1e-2f * std::abs(q)) {
+      return;
+    }
+  }
+
+  has_joiner_projections_ = true;
+}
+
 void Model::RegisterCustomLayers(ncnn::Net &net) {
   RegisterMetaDataLayer(net);
 
@@ -176,16 +799,24 @@ std::unique_ptr<Model> Model::Create(const ModelConfig &config) {
     return nullptr;
   }
 
+  std::unique_ptr<Model> model;
   if (IsLstmModel(net)) {
-    return std::make_unique<LstmModel>(config);
+    model = std::make_unique<LstmModel>(config);
+  } else if (IsConvEmformerModel(net)) {
+    model = std::make_unique<ConvEmformerModel>(config);
+  } else if (IsZipformerModel(net)) {
+    model = std::make_unique<ZipformerModel>(config);
   }
 
-  if (IsConvEmformerModel(net)) {
-    return std::make_unique<ConvEmformerModel>(config);
-  }
-
-  if (IsZipformerModel(net)) {
-    return std::make_unique<ZipformerModel>(config);
+  if (model) {
+    model->decoder_param_ = config.decoder_param;
+    model->decoder_bin_ = config.decoder_bin;
+    model->InitJoinerProjections(ReadFile(config.joiner_param));
+    model->InitVariableLengthEncoder(config.feature_dim);
+    if (config.profile_layers) {
+      model->EnableLayerProfile();
+    }
+    return model;
   }
 
   NCNN_LOGE(
@@ -214,16 +845,25 @@ std::unique_ptr<Model> Model::Create(AAssetManager *mgr,
     return nullptr;
   }
 
+  std::unique_ptr<Model> model;
   if (IsLstmModel(net)) {
-    return std::make_unique<LstmModel>(mgr, config);
+    model = std::make_unique<LstmModel>(mgr, config);
+  } else if (IsConvEmformerModel(net)) {
+    model = std::make_unique<ConvEmformerModel>(mgr, config);
+  } else if (IsZipformerModel(net)) {
+    model = std::make_unique<ZipformerModel>(mgr, config);
   }
 
-  if (IsConvEmformerModel(net)) {
-    return std::make_unique<ConvEmformerModel>(mgr, config);
-  }
-
-  if (IsZipformerModel(net)) {
-    return std::make_unique<ZipformerModel>(mgr, config);
+  if (model) {
+    model->decoder_param_ = config.decoder_param;
+    model->decoder_bin_ = config.decoder_bin;
+    model->mgr_ = mgr;
+    model->InitJoinerProjections(ReadFile(mgr, config.joiner_param));
+    model->InitVariableLengthEncoder(config.feature_dim);
+    if (config.profile_layers) {
+      model->EnableLayerProfile();
+    }
+    return model;
   }
 
   NCNN_LOGE(
@@ -19,12 +19,16 @@
 #ifndef SHERPA_NCNN_CSRC_MODEL_H_
 #define SHERPA_NCNN_CSRC_MODEL_H_
 
+#include <atomic>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/execution-context.h"
+#include "sherpa-ncnn/csrc/layer-profile.h"
 
 namespace sherpa_ncnn {
 
@@ -38,6 +42,13 @@ struct ModelConfig {
   std::string tokens;         // path to tokens.txt
   bool use_vulkan_compute = true;
 
+  // Dimension of the features given to the encoder. Recognizer sets it
+  // from FeatureExtractorConfig::feature_dim
+  int32_t feature_dim = 80;
+
+  // true to time every layer of the networks. See Model::GetLayerProfile()
+  bool profile_layers = false;
+
   ncnn::Option encoder_opt;
   ncnn::Option decoder_opt;
   ncnn::Option joiner_opt;
@@ -91,6 +102,81 @@ class Model {
       ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
       ncnn::Extractor *extractor) = 0;
 
+  /** Run the encoder network for a batch of streams.
+   *
+   * The exported models have no batch axis, so there is one network
+   * execution per stream. The executions are independent and are spread
+   * over encoder_opt.num_threads threads, each of which runs a whole
+   * network, instead of splitting every tiny matrix across all threads.
+   *
+   * @param features  features[i] is the input of the i-th stream. See
+   *                  RunEncoder() above for its shape.
+   * @param states  (*states)[i] contains the states of the i-th stream.
+   *                On return, it is replaced by the next states.
+   * @param ctx  If not empty, ctx[i] is used to run the network for the i-th
+   *             stream. Its entries may be nullptr.
+   *
+   * @return Return encoder_out of each stream.
+   */
+  virtual std::vector<ncnn::Mat> RunEncoderBatch(
+      const std::vector<ncnn::Mat> &features,
+      std::vector<std::vector<ncnn::Mat>> *states,
+      const std::vector<ExecutionContext *> &ctx);
+
+  /** Run the encoder network on consecutive chunks of a stream.
+   *
+   * It is equivalent to calling RunEncoder() on each chunk in turn, with
+   * the states returned for one chunk passed to the next one.
+   *
+   * If HasVariableLengthEncoder() is true, the network is run only once
+   * for all chunks. Otherwise, it is run for each chunk with extractors
+   * from the same context, and the states of one chunk are passed directly
+   * to the next one.
+   *
+   * @param features  A 2-d mat of shape
+   *                  (Segment() + (num_chunks - 1) * Offset(), feature_dim).
+   *                  Chunk i starts at frame i * Offset().
+   * @param num_chunks  Number of chunks in features.
+   * @param states  The states before the first chunk.
+   * @param ctx  If not nullptr, it provides memory for running the network.
+   *
+   * @return Return a pair containing:
+   *   - encoder_out of all chunks, one after another
+   *   - the states after the last chunk
+   */
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoderChunks(
+      ncnn::Mat &features, int32_t num_chunks,
+      const std::vector<ncnn::Mat> &states, ExecutionContext *ctx);
+
+  /** Run RunEncoderChunks() for a batch of streams.
+   *
+   * The streams are spread over threads the same way as RunEncoderBatch().
+   *
+   * @param features  features[i] contains num_chunks[i] chunks of the i-th
+   *                  stream. See RunEncoderChunks() for its shape.
+   * @param num_chunks  Number of chunks of each stream.
+   * @param states  (*states)[i] contains the states of the i-th stream.
+   *                On return, it is replaced by the states after its last
+   *                chunk.
+   * @param ctx  If not empty, ctx[i] is used to run the network for the i-th
+   *             stream. Its entries may be nullptr.
+   *
+   * @return Return encoder_out of each stream, with the frames of all of
+   *         its chunks.
+   */
+  std::vector<ncnn::Mat> RunEncoderChunksBatch(
+      const std::vector<ncnn::Mat> &features,
+      const std::vector<int32_t> &num_chunks,
+      std::vector<std::vector<ncnn::Mat>> *states,
+      const std::vector<ExecutionContext *> &ctx);
+
+  /** Return true if RunEncoderChunks() runs the encoder network only once
+   * for all chunks. See InitVariableLengthEncoder().
+   */
+  bool HasVariableLengthEncoder() const {
+    return has_variable_length_encoder_;
+  }
+
   /** Run the decoder network.
    *
    * @param  decoder_input A mat of shape (context_size,). Note: Its underlying
@@ -106,12 +192,35 @@ class Model {
   virtual ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
                                ncnn::Extractor *extractor) = 0;
 
+  /** Run the decoder network for a batch of decoder inputs.
+   *
+   * If EnableDecoder2D() has been called and the decoder network can be
+   * converted to accept 2-D inputs (see InitDecoder2D()), all rows are
+   * computed with a single invocation of the network. Otherwise, the
+   * network is run row by row.
+   *
+   * @param decoder_input A 2-D mat of shape (num_rows, context_size). Note: Its
+   *                      underlying content consists of integers, though its
+   *                      type is float.
+   *
+   * @param ctx  If not nullptr, it provides memory for running the network.
+   *
+   * @return Return a 2-D mat of shape (num_rows, decoder_dim)
+   */
+  virtual ncnn::Mat RunDecoder2D(ncnn::Mat &decoder_input,
+                                 ExecutionContext *ctx);
+
   /** Run the joiner network.
    *
    * @param encoder_out  A mat of shape (encoder_dim,)
    * @param decoder_out  A mat of shape (decoder_dim,)
    *
    * @return Return the joiner output which is of shape (vocab_size,)
+   *
+   * Note: The joiner also accepts 2-D inputs. If encoder_out is of shape
+   * (num_rows, encoder_dim) and decoder_out is of shape
+   * (num_rows, decoder_dim), it returns a mat of shape (num_rows, vocab_size).
+   * encoder_out may also have a single row, which is broadcast.
    */
   virtual ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
                               ncnn::Mat &decoder_out) = 0;
@@ -121,6 +230,54 @@ class Model {
   virtual ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
                               ncnn::Extractor *extractor) = 0;
 
+  /** Return true if the joiner is of the form
+   *
+   *   out_proj(tanh(encoder_proj(encoder_out) + decoder_proj(decoder_out)))
+   *
+   * and it can be run in parts, so that the projections are computed once
+   * and reused. See InitJoinerProjections().
+   */
+  bool HasJoinerProjections() const { return has_joiner_projections_; }
+
+  /** Run encoder_proj of the joiner.
+   *
+   * It must be called only if HasJoinerProjections() is true.
+   *
+   * @param encoder_out  A 2-D mat of shape (num_rows, encoder_dim)
+   * @param ctx  If not nullptr, it provides memory for running the network.
+   *
+   * @return Return a 2-D mat of shape (num_rows, joiner_dim)
+   */
+  ncnn::Mat RunJoinerEncoderProj(ncnn::Mat &encoder_out,
+                                 ExecutionContext *ctx);
+
+  /** Run decoder_proj of the joiner. See RunJoinerEncoderProj().
+   */
+  ncnn::Mat RunJoinerDecoderProj(ncnn::Mat &decoder_out,
+                                 ExecutionContext *ctx);
+
+  /** Run the rest of the joiner given the outputs of RunJoinerEncoderProj()
+   * and RunJoinerDecoderProj().
+   *
+   * The same as RunJoiner(), encoder_proj may have a single row, which is
+   * broadcast to all rows of decoder_proj.
+   *
+   * @return Return a 2-D mat of shape (num_rows, vocab_size)
+   */
+  ncnn::Mat RunJoinerFromProjections(ncnn::Mat &encoder_proj,
+                                     ncnn::Mat &decoder_proj,
+                                     ExecutionContext *ctx);
+
+  /** Run the decoder network for a batch of decoder inputs and, if
+   * HasJoinerProjections() is true, decoder_proj of the joiner.
+   *
+   * This is what the search code keeps as the decoder output of a
+   * hypothesis: pass it to RunJoinerFromProjections() if
+   * HasJoinerProjections() is true and to RunJoiner() otherwise.
+   */
+  ncnn::Mat RunDecoderForJoiner(ncnn::Mat &decoder_input,
+                                ExecutionContext *ctx);
+
   virtual int32_t ContextSize() const { return 2; }
 
   virtual int32_t BlankId() const { return 0; }
@@ -132,6 +289,33 @@ class Model {
   // running the encoder network
   virtual int32_t Offset() const = 0;
 
+  /** Time every layer of the encoder, decoder and joiner networks from now
+   * on. It must not be called while the networks are running.
+   *
+   * The 2-D decoder network, if any, is reported as decoder2d, so that
+   * its layers are not mixed up with those of the decoder.
+   *
+   * Afterwards, the layers of the networks can no longer be cast to their
+   * own classes. See LayerProfile::Attach().
+   */
+  void EnableLayerProfile();
+
+  // Return nullptr if EnableLayerProfile() has not been called
+  LayerProfile *GetLayerProfile() const { return layer_profile_.get(); }
+
+  /** Build the 2-D decoder network used by RunDecoder2D().
+   *
+   * It holds a second copy of the decoder weights, so it is built only for
+   * callers that run the decoder on more than one row at a time, e.g.,
+   * modified beam search and Recognizer::DecodeStreams(). A single stream
+   * decoded with greedy search never does.
+   *
+   * It does nothing after the first call and is thread-safe. It may be
+   * called while the networks are running. If the model was created from
+   * an AAssetManager, the manager must still be valid.
+   */
+  void EnableDecoder2D();
+
   static void InitNet(ncnn::Net &net, const std::string &param,
                       const std::string &bin);
 
@@ -139,6 +323,96 @@ class Model {
   static void InitNet(AAssetManager *mgr, ncnn::Net &net,
                       const std::string &param, const std::string &bin);
 #endif
+
+ protected:
+  /** Return true if the encoder network may accept
+   * Segment() + k * Offset() frames for any k >= 0 and output the frames of
+   * k + 1 chunks, e.g., if it takes the number of frames as an input.
+   * It is verified by InitVariableLengthEncoder() before it is used.
+   */
+  virtual bool EncoderAcceptsVariableLength() const { return false; }
+
+ private:
+  /** Create a copy of the decoder network that accepts a 2-D input of
+   * shape (num_rows, context_size).
+   *
+   * The embedding layer flattens its input, so the only layer that mixes
+   * rows is the depthwise convolution over the context. Setting its stride
+   * to context_size makes every output frame see only the tokens of a
+   * single row.
+   *
+   * The converted network is used only if it gives the same output as the
+   * original one on a test input. Otherwise, RunDecoder2D() falls back to
+   * running the decoder row by row.
+   *
+   * @param param  Path to decoder.ncnn.param
+   * @param bin  Path to decoder.ncnn.bin
+   */
+  void InitDecoder2D(const std::string &param, const std::string &bin);
+
+#if __ANDROID_API__ >= 9
+  void InitDecoder2D(AAssetManager *mgr, const std::string &param,
+                     const std::string &bin);
+#endif
+
+  // Run the decoder row by row
+  ncnn::Mat RunDecoderRowByRow(ncnn::Mat &decoder_input,
+                               ExecutionContext *ctx);
+
+  // Return true if decoder2d_ gives the same output as RunDecoderRowByRow()
+  bool CheckDecoder2D();
+
+  /** Find the projections in the joiner network. If found, and running the
+   * joiner in parts gives the same result as running it as a whole,
+   * HasJoinerProjections() returns true.
+   *
+   * The joiner is not split into several networks. Instead, the extractor
+   * is given the outputs of the projections as inputs, so that ncnn runs
+   * only the layers after them.
+   *
+   * @param param  Content of joiner.ncnn.param. It is used to get the
+   *               input dimensions of the projections.
+   */
+  void InitJoinerProjections(const std::string &param);
+
+  /** If EncoderAcceptsVariableLength() is true and running the encoder
+   * network once on several chunks gives the same result as running it
+   * chunk by chunk, HasVariableLengthEncoder() returns true.
+   *
+   * @param feature_dim  Dimension of the features given to the encoder.
+   */
+  void InitVariableLengthEncoder(int32_t feature_dim);
+
+  // Run the encoder network for each chunk
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoderChunkByChunk(
+      ncnn::Mat &features, int32_t num_chunks,
+      const std::vector<ncnn::Mat> &states, ExecutionContext *ctx);
+
+ private:
+  // Used by EnableDecoder2D()
+  std::string decoder_param_;
+  std::string decoder_bin_;
+#if __ANDROID_API__ >= 9
+  AAssetManager *mgr_ = nullptr;
+#endif
+  std::once_flag decoder2d_once_;
+
+  // Used only if has_decoder2d_ is true
+  ncnn::Net decoder2d_;
+  std::atomic<bool> has_decoder2d_{false};
+
+  // Blob indexes in the joiner network. Used only if
+  // has_joiner_projections_ is true
+  int32_t joiner_encoder_in_ = -1;
+  int32_t joiner_decoder_in_ = -1;
+  int32_t joiner_encoder_proj_ = -1;
+  int32_t joiner_decoder_proj_ = -1;
+  int32_t joiner_out_ = -1;
+  bool has_joiner_projections_ = false;
+
+  bool has_variable_length_encoder_ = false;
+
+  std::unique_ptr<LayerProfile> layer_profile_;
 };
 
 }  // namespace sherpa_ncnn
@@ -23,7 +23,7 @@
 #include <utility>
 #include <vector>
 
-#include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/log-softmax-topk.h"
 
 namespace sherpa_ncnn {
 
@@ -45,76 +45,52 @@ void ModifiedBeamSearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
   int32_t context_size = model_->ContextSize();
   auto hyp = r->hyps.GetMostProbable(true);
 
-  auto start = hyp.ys.begin() + context_size;
-  auto end = hyp.ys.end();
-
-  r->tokens = std::vector<int32_t>(start, end);
-  r->timestamps = std::move(hyp.timestamps);
+  std::vector<int32_t> ys = hyp.Ys();
+  r->tokens = std::vector<int32_t>(ys.begin() + context_size, ys.end());
+  r->timestamps = hyp.Timestamps();
   r->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
-// Compute log_softmax in-place.
-//
-// The log_softmax of each row is computed.
-//
-// @param in_out A 2-D tensor
-static void LogSoftmax(ncnn::Mat *in_out) {
-  int32_t h = in_out->h;
-  int32_t w = in_out->w;
-  for (int32_t y = 0; y != h; ++y) {
-    float *p = in_out->row(y);
-    LogSoftmax(p, w);
-  }
-}
-
-// The decoder model contains an embedding layer, which only supports
-// 1-D output.
-// This is a wrapper to support 2-D decoder output.
-//
-// @param model_ The NN model.
-// @param decoder_input A 2-D tensor of shape (num_active_paths, context_size)
-// @return Return a 2-D tensor of shape (num_active_paths, decoder_dim)
-//
-// TODO(fangjun): Change Embed in ncnn to output 2-d tensors
-static ncnn::Mat RunDecoder2D(Model *model_, ncnn::Mat decoder_input) {
-  ncnn::Mat decoder_out;
-  int32_t h = decoder_input.h;
-
-  for (int32_t y = 0; y != h; ++y) {
-    ncnn::Mat decoder_input_t =
-        ncnn::Mat(decoder_input.w, decoder_input.row(y));
-
-    ncnn::Mat tmp = model_->RunDecoder(decoder_input_t);
-
-    if (y == 0) {
-      decoder_out = ncnn::Mat(tmp.w, h);
-    }
-
-    const float *ptr = tmp;
-    float *out_ptr = decoder_out.row(y);
-    std::copy(ptr, ptr + tmp.w, out_ptr);
-  }
-
-  return decoder_out;
-}
-
 ncnn::Mat ModifiedBeamSearchDecoder::BuildDecoderInput(
-    const std::vector<Hypothesis> &hyps) const {
+    const std::vector<const Hypothesis *> &hyps) const {
   int32_t num_hyps = static_cast<int32_t>(hyps.size());
   int32_t context_size = model_->ContextSize();
 
   ncnn::Mat decoder_input(context_size, num_hyps);
   auto p = static_cast<int32_t *>(decoder_input);
 
-  for (const auto &hyp : hyps) {
-    const auto &ys = hyp.ys;
-    std::copy(ys.end() - context_size, ys.end(), p);
+  for (const auto *hyp : hyps) {
+    hyp->GetLastTokens(context_size, p);
     p += context_size;
   }
 
   return decoder_input;
 }
 
+ncnn::Mat ModifiedBeamSearchDecoder::RunDecoder(ncnn::Mat &decoder_input,
+                                                ExecutionContext *ctx) {
+  ScopedStageTimer timer(stats_, Stage::kDecoder);
+
+  if (cache_) {
+    return cache_->RunDecoder(model_, decoder_input, ctx);
+  }
+
+  return model_->RunDecoderForJoiner(decoder_input, ctx);
+}
+
+ncnn::Mat ModifiedBeamSearchDecoder::RunJoiner(ncnn::Mat &encoder_out,
+                                               ncnn::Mat &decoder_out,
+                                               ExecutionContext *ctx) {
+  ScopedStageTimer timer(stats_, Stage::kJoiner);
+
+  if (model_->HasJoinerProjections()) {
+    return model_->RunJoinerFromProjections(encoder_out, decoder_out, ctx);
+  }
+
+  ncnn::Extractor joiner_ex = CreateExtractor(model_->GetJoiner(), ctx);
+  return model_->RunJoiner(encoder_out, decoder_out, &joiner_ex);
+}
+
 void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out,
                                        DecoderResult *result) {
   Decode(encoder_out, nullptr, result);
@@ -122,86 +98,221 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out,
 
 void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
                                        DecoderResult *result) {
+  DecodeBatch(&encoder_out, &s, &result, 1,
+              s ? s->GetExecutionContext() : nullptr);
+}
+
+void ModifiedBeamSearchDecoder::Decode(ncnn::Mat *encoder_out, Stream **ss,
+                                       int32_t n) {
+  std::vector<DecoderResult *> results(n);
+  for (int32_t i = 0; i != n; ++i) {
+    results[i] = &ss[i]->GetResult();
+  }
+
+  for (int32_t i = 1; i != n; ++i) {
+    if (encoder_out[i].h != encoder_out[0].h) {
+      // It should not happen for streams decoded by the same model
+      for (int32_t k = 0; k != n; ++k) {
+        DecodeBatch(encoder_out + k, ss + k, results.data() + k, 1,
+                    ss[k]->GetExecutionContext());
+      }
+      return;
+    }
+  }
+
+  // The streams are decoded by the current thread, so we can use the
+  // context of any of them. Blobs allocated from it are released before
+  // DecodeBatch() returns.
+  DecodeBatch(encoder_out, ss, results.data(), n,
+              ss[0]->GetExecutionContext());
+}
+
+void ModifiedBeamSearchDecoder::DecodeBatch(ncnn::Mat *encoder_out,
+                                            Stream **ss,
+                                            DecoderResult **results,
+                                            int32_t n, ExecutionContext *ctx) {
   int32_t context_size = model_->ContextSize();
-  Hypotheses cur = std::move(result->hyps);
+
+  std::vector<Hypotheses> cur(n);
+  for (int32_t i = 0; i != n; ++i) {
+    cur[i] = std::move(results[i]->hyps);
+  }
+
+  std::vector<std::vector<Hypothesis>> prev(n);
+
+  // Hypotheses of all streams are stacked. Rows
+  // [row_start[i], row_start[i+1]) belong to the i-th stream
+  std::vector<int32_t> row_start(n + 1);
+
+  // rows for which we need to run the decoder network
+  std::vector<int32_t> rows;
+  std::vector<const Hypothesis *> hyps;
+
+  std::vector<float> offsets;
+  std::vector<int32_t> topk;
+  std::vector<float> topk_values;
+
+  // Project the encoder output of all frames at once, so that only the
+  // rest of the joiner is run for each frame
+  std::vector<ncnn::Mat> encoder_proj;
+  if (model_->HasJoinerProjections()) {
+    encoder_proj.resize(n);
+    ScopedStageTimer timer(stats_, Stage::kJoiner);
+    for (int32_t i = 0; i != n; ++i) {
+      encoder_proj[i] = model_->RunJoinerEncoderProj(encoder_out[i], ctx);
+    }
+    encoder_out = encoder_proj.data();
+  }
+
+  int32_t num_frames = encoder_out[0].h;
+  int32_t encoder_dim = encoder_out[0].w;
+
   /* encoder_out.w == encoder_out_dim, encoder_out.h == num_frames. */
-  for (int32_t t = 0; t != encoder_out.h; ++t) {
-    std::vector<Hypothesis> prev = cur.GetTopK(num_active_paths_, true);
-    cur.Clear();
+  for (int32_t t = 0; t != num_frames; ++t) {
+    rows.clear();
+    hyps.clear();
+    for (int32_t i = 0; i != n; ++i) {
+      prev[i] = cur[i].GetTopK(num_active_paths_, true);
+      cur[i].Clear();
+
+      int32_t num_hyps = static_cast<int32_t>(prev[i].size());
+      row_start[i + 1] = row_start[i] + num_hyps;
+
+      if (t == 0 && num_hyps == 1 &&
+          prev[i][0].NumTokens() == context_size &&
+          !results[i]->decoder_out.empty()) {
+        // When an endpoint is detected, we keep the decoder_out
+        continue;
+      }
+
+      for (int32_t k = 0; k != num_hyps; ++k) {
+        rows.push_back(row_start[i] + k);
+        hyps.push_back(&prev[i][k]);
+      }
+    }
+
+    int32_t num_rows = row_start[n];
+    int32_t num_computed_rows = static_cast<int32_t>(rows.size());
 
-    ncnn::Mat decoder_input = BuildDecoderInput(prev);
     ncnn::Mat decoder_out;
-    if (t == 0 && prev.size() == 1 && prev[0].ys.size() == context_size &&
-        !result->decoder_out.empty()) {
-      // When an endpoint is detected, we keep the decoder_out
-      decoder_out = result->decoder_out;
+    if (num_computed_rows == num_rows) {
+      ncnn::Mat decoder_input = BuildDecoderInput(hyps);
+      decoder_out = RunDecoder(decoder_input, ctx);
     } else {
-      decoder_out = RunDecoder2D(model_, decoder_input);
+      ncnn::Mat tmp;
+      if (!rows.empty()) {
+        ncnn::Mat decoder_input = BuildDecoderInput(hyps);
+        tmp = RunDecoder(decoder_input, ctx);
+      }
+
+      // Streams that are not in rows have a single hypothesis
+      int32_t decoder_dim = 0;
+      for (int32_t i = 0; i != n && decoder_dim == 0; ++i) {
+        decoder_dim = results[i]->decoder_out.w;
+      }
+
+      decoder_out.create(decoder_dim, num_rows);
+      for (int32_t i = 0, k = 0; i != n; ++i) {
+        if (k < num_computed_rows && rows[k] == row_start[i]) {
+          for (; k < num_computed_rows && rows[k] < row_start[i + 1]; ++k) {
+            const float *p = tmp.row(k);
+            std::copy(p, p + decoder_dim, decoder_out.row(rows[k]));
+          }
+        } else {
+          const float *p = results[i]->decoder_out;
+          std::copy(p, p + decoder_dim, decoder_out.row(row_start[i]));
+        }
+      }
     }
 
     // decoder_out.w == decoder_dim
-    // decoder_out.h == num_active_paths
-    ncnn::Mat encoder_out_t(encoder_out.w, 1, encoder_out.row(t));
+    // decoder_out.h == num_rows
+    ncnn::Mat encoder_out_t;
+    if (n == 1) {
+      // the joiner broadcasts it to all rows of decoder_out
+      encoder_out_t = ncnn::Mat(encoder_dim, 1, encoder_out[0].row(t));
+    } else {
+      encoder_out_t.create(encoder_dim, num_rows);
+      for (int32_t i = 0; i != n; ++i) {
+        const float *p = encoder_out[i].row(t);
+        for (int32_t r = row_start[i]; r != row_start[i + 1]; ++r) {
+          std::copy(p, p + encoder_dim, encoder_out_t.row(r));
+        }
+      }
+    }
 
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    ncnn::Mat joiner_out = RunJoiner(encoder_out_t, decoder_out, ctx);
     // joiner_out.w == vocab_size
-    // joiner_out.h == num_active_paths
-    LogSoftmax(&joiner_out);
+    // joiner_out.h == num_rows
+    int32_t vocab_size = joiner_out.w;
 
-    float *p_joiner_out = joiner_out;
+    for (int32_t i = 0; i != n; ++i) {
+      int32_t num_hyps = static_cast<int32_t>(prev[i].size());
 
-    for (int32_t i = 0; i != joiner_out.h; ++i) {
-      float prev_log_prob = prev[i].log_prob;
-      for (int32_t k = 0; k != joiner_out.w; ++k, ++p_joiner_out) {
-        *p_joiner_out += prev_log_prob;
+      offsets.resize(num_hyps);
+      for (int32_t k = 0; k != num_hyps; ++k) {
+        offsets[k] = prev[i][k].log_prob;
       }
-    }
 
-    auto topk = TopkIndex(static_cast<float *>(joiner_out),
-                          joiner_out.w * joiner_out.h, num_active_paths_);
-
-    int32_t frame_offset = result->frame_offset;
-    for (auto i : topk) {
-      int32_t hyp_index = i / joiner_out.w;
-      int32_t new_token = i % joiner_out.w;
-
-      const float *p = joiner_out.row(hyp_index);
-
-      Hypothesis new_hyp = prev[hyp_index];
-      // const float prev_lm_log_prob = new_hyp.lm_log_prob;
-      float context_score = 0;
-      auto context_state = new_hyp.context_state;
-      // blank id is fixed to 0
-      if (new_token != 0 && new_token != 2) {
-        new_hyp.ys.push_back(new_token);
-        new_hyp.num_trailing_blanks = 0;
-        new_hyp.timestamps.push_back(t + frame_offset);
-        if (s && s->GetContextGraph()) {
-          auto context_res = s->GetContextGraph()->ForwardOneStep(
-              context_state, new_token, false /*strict_mode*/);
-          context_score = std::get<0>(context_res);
-          new_hyp.context_state = std::get<1>(context_res);
-        }
-      } else {
-        ++new_hyp.num_trailing_blanks;
+      // topk_values[j] is log_softmax(joiner_out)[topk[j]] plus the log_prob
+      // of the hypothesis it extends
+      {
+        ScopedStageTimer timer(stats_, Stage::kLogSoftmaxTopk);
+        LogSoftmaxTopk(joiner_out.row(row_start[i]), num_hyps, vocab_size,
+                       offsets.data(), num_active_paths_, &topk, &topk_values);
       }
-      // We have already added prev[hyp_index].log_prob to p[new_token]
-      new_hyp.log_prob = p[new_token] + context_score;
 
-      cur.Add(std::move(new_hyp));
+      Stream *s = ss[i];
+      int32_t frame_offset = results[i]->frame_offset;
+      for (int32_t j = 0; j != static_cast<int32_t>(topk.size()); ++j) {
+        int32_t hyp_index = topk[j] / vocab_size;
+        int32_t new_token = topk[j] % vocab_size;
+
+        Hypothesis new_hyp = prev[i][hyp_index];
+        // const float prev_lm_log_prob = new_hyp.lm_log_prob;
+        float context_score = 0;
+        auto context_state = new_hyp.context_state;
+        // blank id is fixed to 0
+        if (new_token != 0 && new_token != 2) {
+          new_hyp.Append(new_token, t + frame_offset);
+          new_hyp.num_trailing_blanks = 0;
+          if (s && s->GetContextGraph()) {
+            auto context_res = s->GetContextGraph()->ForwardOneStep(
+                context_state, new_token, false /*strict_mode*/);
+            context_score = std::get<0>(context_res);
+            new_hyp.context_state = std::get<1>(context_res);
+          }
+        } else {
+          ++new_hyp.num_trailing_blanks;
+        }
+        new_hyp.log_prob = topk_values[j] + context_score;
+
+        cur[i].Add(std::move(new_hyp));
+      }
     }
   }
 
-  result->hyps = std::move(cur);
-  result->frame_offset += encoder_out.h;
-  auto hyp = result->hyps.GetMostProbable(true);
+  std::vector<Hypothesis> best(n);
+  hyps.clear();
+  for (int32_t i = 0; i != n; ++i) {
+    results[i]->hyps = std::move(cur[i]);
+    results[i]->frame_offset += num_frames;
+    best[i] = results[i]->hyps.GetMostProbable(true);
+    hyps.push_back(&best[i]);
+  }
 
   // set decoder_out in case of endpointing
-  ncnn::Mat decoder_input = BuildDecoderInput({hyp});
-  result->decoder_out = model_->RunDecoder(decoder_input);
-
-  result->tokens = std::move(hyp.ys);
-  result->num_trailing_blanks = hyp.num_trailing_blanks;
+  ncnn::Mat decoder_input = BuildDecoderInput(hyps);
+  ncnn::Mat decoder_out = RunDecoder(decoder_input, ctx);
+
+  for (int32_t i = 0; i != n; ++i) {
+    results[i]->decoder_out =
+        ncnn::Mat(decoder_out.w, decoder_out.row(i)).clone();
+    // results[i]->tokens is set by StripLeadingBlanks() when the result
+    // is requested, so that the cost of a chunk does not grow with the
+    // length of the utterance
+    results[i]->num_trailing_blanks = best[i].num_trailing_blanks;
+  }
 }
 
 }  // namespace sherpa_ncnn
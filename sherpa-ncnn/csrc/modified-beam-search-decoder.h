@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/decoder-out-cache.h"
 #include "sherpa-ncnn/csrc/decoder.h"
 #include "sherpa-ncnn/csrc/model.h"
 #include "sherpa-ncnn/csrc/stream.h"
@@ -32,8 +33,11 @@ namespace sherpa_ncnn {
 
 class ModifiedBeamSearchDecoder : public Decoder {
  public:
-  ModifiedBeamSearchDecoder(Model *model, int32_t num_active_paths)
-      : model_(model), num_active_paths_(num_active_paths) {}
+  // @param cache If not nullptr, it is used to look up the decoder output
+  //              before running the decoder network. Not owned.
+  ModifiedBeamSearchDecoder(Model *model, int32_t num_active_paths,
+                            DecoderOutCache *cache = nullptr)
+      : model_(model), num_active_paths_(num_active_paths), cache_(cache) {}
 
   DecoderResult GetEmptyResult() const override;
 
@@ -42,12 +46,29 @@ class ModifiedBeamSearchDecoder : public Decoder {
   void Decode(ncnn::Mat encoder_out, DecoderResult *result) override;
   void Decode(ncnn::Mat encoder_out, Stream *s, DecoderResult *result) override;
 
+  void Decode(ncnn::Mat *encoder_out, Stream **ss, int32_t n) override;
+
  private:
-  ncnn::Mat BuildDecoderInput(const std::vector<Hypothesis> &hyps) const;
+  ncnn::Mat BuildDecoderInput(
+      const std::vector<const Hypothesis *> &hyps) const;
+
+  // See Model::RunDecoderForJoiner()
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input, ExecutionContext *ctx);
+
+  // If the joiner has projections, encoder_out and decoder_out are the
+  // outputs of the projections. See Model::HasJoinerProjections().
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ExecutionContext *ctx);
+
+  // ss[i] may be nullptr, in which case hotwords are not used for results[i]
+  // ctx is used for running the networks. It can be nullptr.
+  void DecodeBatch(ncnn::Mat *encoder_out, Stream **ss,
+                   DecoderResult **results, int32_t n, ExecutionContext *ctx);
 
  private:
   Model *model_;  // not owned
   int32_t num_active_paths_;
+  DecoderOutCache *cache_;  // not owned
 };
 
 }  // namespace sherpa_ncnn
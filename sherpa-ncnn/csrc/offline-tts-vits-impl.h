@@ -19,6 +19,7 @@
 #include "sherpa-ncnn/csrc/math.h"
 #include "sherpa-ncnn/csrc/offline-tts-vits-model.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
+#include "sherpa-ncnn/csrc/trace.h"
 
 namespace sherpa_ncnn {
 
@@ -43,6 +44,8 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
   GeneratedAudio Generate(const TtsArgs &_args,
                           GeneratedAudioCallback callback = nullptr,
                           void *callback_arg = nullptr) const override {
+    ScopedTraceSpan span("tts_generate", "tts");
+
     TtsArgs args = _args;
     if (args.text.empty() && args.tokens.empty()) {
       SHERPA_NCNN_LOGE("Both text and tokens are empty.");
@@ -55,6 +58,7 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     }
 
     if (!args.text.empty()) {
+      ScopedTraceSpan convert_span("tts_text_to_tokens", "tts");
       args.tokens = Convert(args.text);
     }
 
@@ -113,6 +117,8 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
  private:
   ncnn::Mat Process(const std::vector<int32_t> &_tokens, int32_t sid,
                     float noise_scale_w, float noise_scale, float speed) const {
+    ScopedTraceSpan span("tts_sentence", "tts");
+
     // add bos, eos, and pad
     const auto &meta = model_->GetMetaData();
     int32_t bos = meta.bos;
@@ -14,6 +14,7 @@
 
 #include "net.h"  // NOLINT
 #include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/trace.h"
 
 namespace sherpa_ncnn {
 
@@ -314,6 +315,8 @@ class OfflineTtsVitsModel::Impl {
   const OfflineTtsVitsModelMetaData &GetMetaData() const { return meta_; }
 
   std::vector<ncnn::Mat> RunEncoder(const ncnn::Mat &sequence) const {
+    ScopedTraceSpan span("tts_encoder", "tts");
+
     ncnn::Extractor ex = enc_p_.create_extractor();
 
     ex.input("in0", sequence);
@@ -331,6 +334,8 @@ class OfflineTtsVitsModel::Impl {
 
   ncnn::Mat RunDurationPredictor(const ncnn::Mat &x, const ncnn::Mat &noise,
                                  const ncnn::Mat &g) const {
+    ScopedTraceSpan span("tts_duration_predictor", "tts");
+
     ncnn::Extractor ex = dp_.create_extractor();
 
     ex.input("in0", x);
@@ -347,6 +352,8 @@ class OfflineTtsVitsModel::Impl {
   }
 
   ncnn::Mat RunFlow(const ncnn::Mat &z_p, const ncnn::Mat &g) const {
+    ScopedTraceSpan span("tts_flow", "tts");
+
     ncnn::Extractor ex = flow_.create_extractor();
 
     ex.input("in0", z_p);
@@ -361,6 +368,8 @@ class OfflineTtsVitsModel::Impl {
   }
 
   ncnn::Mat RunDecoder(const ncnn::Mat &z, const ncnn::Mat &g) const {
+    ScopedTraceSpan span("tts_decoder", "tts");
+
     ncnn::Extractor ex = decoder_.create_extractor();
 
     ex.input("in0", z);
@@ -382,6 +391,7 @@ class OfflineTtsVitsModel::Impl {
     sid = sid < 0 ? 0 : sid;
     sid = sid > meta_.num_speakers - 1 ? meta_.num_speakers - 1 : sid;
 
+    ScopedTraceSpan span("tts_embedding", "tts");
     ncnn::Extractor ex = embedding_.create_extractor();
 
     ncnn::Mat in(1);
@@ -516,6 +526,7 @@ ncnn::Mat OfflineTtsVitsModel::PathAttention(const ncnn::Mat &logw,
                                              const ncnn::Mat &m_p,
                                              ncnn::Mat &logs_p,
                                              float noise_scale, float speed) {
+  ScopedTraceSpan span("tts_path_attention", "tts");
   return PathAttentionImpl(logw, m_p, logs_p, noise_scale, speed);
 }
 
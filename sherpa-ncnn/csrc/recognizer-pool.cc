@@ -0,0 +1,259 @@
+// sherpa-ncnn/csrc/recognizer-pool.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/recognizer-pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <exception>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/trace.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+struct Request {
+  std::promise<void> promise;
+  RecognizerPool::Callback callback;
+};
+
+struct StreamEntry {
+  // Requests that are not handled by a worker yet
+  std::vector<Request> pending;
+};
+
+// Each worker has its own queue. It takes streams from the front of its
+// own queue and steals from the back of the queues of other workers.
+struct WorkQueue {
+  std::mutex mutex;
+  std::deque<Stream *> streams;
+};
+
+}  // namespace
+
+class RecognizerPool::Impl {
+ public:
+  Impl(const Recognizer *recognizer, int32_t num_workers)
+      : recognizer_(recognizer) {
+    if (num_workers <= 0) {
+      int32_t num_threads = std::max(
+          1, recognizer->GetConfig().model_config.encoder_opt.num_threads);
+      int32_t num_cores =
+          static_cast<int32_t>(std::thread::hardware_concurrency());
+      num_cores = std::max(1, num_cores);
+      num_workers = std::max(1, num_cores / num_threads);
+    }
+
+    queues_.reserve(num_workers);
+    for (int32_t i = 0; i != num_workers; ++i) {
+      queues_.push_back(std::make_unique<WorkQueue>());
+    }
+
+    workers_.reserve(num_workers);
+    for (int32_t i = 0; i != num_workers; ++i) {
+      workers_.emplace_back([this, i]() { Run(i); });
+    }
+  }
+
+  ~Impl() {
+    Wait();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &w : workers_) {
+      w.join();
+    }
+  }
+
+  std::future<void> Submit(Stream *s, Callback callback) {
+    Request r;
+    r.callback = std::move(callback);
+    std::future<void> f = r.promise.get_future();
+
+    bool schedule = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // If the stream is already scheduled, the worker that owns it picks
+      // up the request once it finishes the current round, so chunks of
+      // a stream are never decoded concurrently.
+      auto it = streams_.find(s);
+      if (it == streams_.end()) {
+        it = streams_.emplace(s, StreamEntry{}).first;
+        schedule = true;
+      }
+      it->second.pending.push_back(std::move(r));
+    }
+
+    if (schedule) {
+      Push(s);
+    }
+
+    return f;
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]() { return streams_.empty(); });
+  }
+
+  int32_t NumWorkers() const { return static_cast<int32_t>(workers_.size()); }
+
+ private:
+  void Push(Stream *s) {
+    int32_t n = static_cast<int32_t>(queues_.size());
+    auto &q = *queues_[next_queue_.fetch_add(1) % n];
+    {
+      std::lock_guard<std::mutex> lock(q.mutex);
+      q.streams.push_back(s);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++num_tasks_;
+    }
+    cv_.notify_one();
+  }
+
+  bool Pop(int32_t id, Stream **s) {
+    int32_t n = static_cast<int32_t>(queues_.size());
+    for (int32_t k = 0; k != n; ++k) {
+      auto &q = *queues_[(id + k) % n];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (q.streams.empty()) {
+        continue;
+      }
+
+      if (k == 0) {
+        *s = q.streams.front();
+        q.streams.pop_front();
+      } else {
+        *s = q.streams.back();
+        q.streams.pop_back();
+      }
+      return true;
+    }
+
+    return false;
+  }
+
+  void Run(int32_t id) {
+    SetTraceThreadName("recognizer-pool");
+
+    while (true) {
+      Stream *s = nullptr;
+      if (Pop(id, &s)) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          --num_tasks_;
+        }
+        Process(s);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stop_ || num_tasks_ > 0; });
+      if (stop_ && num_tasks_ <= 0) {
+        return;
+      }
+    }
+  }
+
+  void Process(Stream *s) {
+    std::vector<Request> requests;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::swap(requests, streams_.at(s).pending);
+    }
+
+    // An exception must not kill the worker or leave the stream in
+    // streams_, or Wait() would block forever. It is passed to the futures
+    // instead.
+    std::exception_ptr error;
+    try {
+      while (recognizer_->IsReady(s)) {
+        recognizer_->DecodeStream(s);
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    for (auto &r : requests) {
+      if (error) {
+        r.promise.set_exception(error);
+        continue;
+      }
+
+      try {
+        if (r.callback) {
+          r.callback(s);
+        }
+        r.promise.set_value();
+      } catch (...) {
+        r.promise.set_exception(std::current_exception());
+      }
+    }
+
+    bool again = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = streams_.find(s);
+      if (it->second.pending.empty()) {
+        streams_.erase(it);
+        if (streams_.empty()) {
+          idle_cv_.notify_all();
+        }
+      } else {
+        again = true;
+      }
+    }
+
+    if (again) {
+      // Put it to the back of a queue so that other streams get a chance
+      Push(s);
+    }
+  }
+
+ private:
+  const Recognizer *recognizer_;  // not owned
+
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<uint32_t> next_queue_{0};
+
+  // It protects the members below
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable idle_cv_;
+  // Streams that are either in a queue or being decoded
+  std::unordered_map<Stream *, StreamEntry> streams_;
+  int32_t num_tasks_ = 0;
+  bool stop_ = false;
+};
+
+RecognizerPool::RecognizerPool(const Recognizer *recognizer,
+                               int32_t num_workers)
+    : impl_(std::make_unique<Impl>(recognizer, num_workers)) {}
+
+RecognizerPool::~RecognizerPool() = default;
+
+std::future<void> RecognizerPool::Submit(Stream *s, Callback callback) {
+  return impl_->Submit(s, std::move(callback));
+}
+
+void RecognizerPool::Wait() { impl_->Wait(); }
+
+int32_t RecognizerPool::NumWorkers() const { return impl_->NumWorkers(); }
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,87 @@
+// sherpa-ncnn/csrc/recognizer-pool.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_RECOGNIZER_POOL_H_
+#define SHERPA_NCNN_CSRC_RECOGNIZER_POOL_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace sherpa_ncnn {
+
+/**
+ * Decode streams of a Recognizer on a pool of worker threads.
+ *
+ * Usage:
+ *
+ *   RecognizerPool pool(&recognizer);
+ *
+ *   // For each incoming piece of audio of a stream
+ *   s->AcceptWaveform(sample_rate, samples, n);
+ *   pool.Submit(s, [&recognizer](Stream *s) {
+ *     auto result = recognizer.GetResult(s);
+ *     // ...
+ *   });
+ *
+ * Chunks of the same stream are decoded in order and never concurrently.
+ * Different streams are decoded in parallel. Each worker has its own queue
+ * and idle workers steal streams from the queues of busy workers.
+ */
+class RecognizerPool {
+ public:
+  using Callback = std::function<void(Stream *s)>;
+
+  /**
+   * @param recognizer  Not owned. It must outlive this object.
+   * @param num_workers Number of worker threads. If it is not positive,
+   *                    we use the number of CPU cores divided by
+   *                    encoder_opt.num_threads of the recognizer so that
+   *                    workers and the OpenMP threads of ncnn do not
+   *                    oversubscribe the CPU.
+   */
+  explicit RecognizerPool(const Recognizer *recognizer,
+                          int32_t num_workers = 0);
+
+  // It waits until all submitted streams have been decoded.
+  ~RecognizerPool();
+
+  /**
+   * Decode all chunks of the given stream that are ready at the time the
+   * stream is picked up by a worker.
+   *
+   * You can call AcceptWaveform() and InputFinished() of the stream at any
+   * time. You must not call other methods of the stream, or methods of the
+   * recognizer that take the stream, until the returned future becomes
+   * ready, except from inside the callback.
+   *
+   * @param s  The stream to decode. Not owned. It must be alive until the
+   *           returned future becomes ready.
+   * @param callback  If not empty, it is invoked on the worker thread after
+   *                  decoding, e.g., to call GetResult(), IsEndpoint() and
+   *                  Reset().
+   *
+   * @return Return a future that becomes ready after the callback returns.
+   *         If decoding or the callback throws, the future holds the
+   *         exception and the pool keeps working.
+   */
+  std::future<void> Submit(Stream *s, Callback callback = {});
+
+  // Block until all submitted streams have been decoded.
+  void Wait();
+
+  int32_t NumWorkers() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_RECOGNIZER_POOL_H_
@@ -19,16 +19,23 @@
 
 #include "sherpa-ncnn/csrc/recognizer.h"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <mutex>  // NOLINT
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/decoder-out-cache.h"
 #include "sherpa-ncnn/csrc/decoder.h"
 #include "sherpa-ncnn/csrc/greedy-search-decoder.h"
 #include "sherpa-ncnn/csrc/modified-beam-search-decoder.h"
+#include "sherpa-ncnn/csrc/search-pipeline.h"
+#include "sherpa-ncnn/csrc/stage-stats.h"
+#include "sherpa-ncnn/csrc/trace.h"
 
 #if __ANDROID_API__ >= 9
 #include <strstream>
@@ -88,23 +95,49 @@ std::string RecognizerConfig::ToString() const {
   os << "endpoint_config=" << endpoint_config.ToString() << ", ";
   os << "enable_endpoint=" << (enable_endpoint ? "True" : "False") << ", ";
   os << "hotwords_file=\"" << hotwords_file << "\", ";
-  os << "hotwrods_score=" << hotwords_score << ")";
+  os << "hotwrods_score=" << hotwords_score << ", ";
+  os << "enable_stats=" << (enable_stats ? "True" : "False") << ", ";
+  os << "max_pooled_streams=" << max_pooled_streams << ")";
 
   return os.str();
 }
 
+// The encoder is given features of the dimension of feat_config
+static ModelConfig GetModelConfig(const RecognizerConfig &config) {
+  ModelConfig ans = config.model_config;
+  ans.feature_dim = config.feat_config.feature_dim;
+  return ans;
+}
+
 class Recognizer::Impl {
  public:
   explicit Impl(const RecognizerConfig &config)
       : config_(config),
-        model_(Model::Create(config.model_config)),
+        model_(Model::Create(GetModelConfig(config))),
         endpoint_(config.endpoint_config),
         sym_(config.model_config.tokens) {
+    if (model_) {
+      init_states_ = model_->GetEncoderInitStates();
+    }
+
+    if (config.decoder_config.decoder_out_cache_size > 0) {
+      decoder_out_cache_ = std::make_unique<DecoderOutCache>(
+          config.decoder_config.decoder_out_cache_size);
+    }
+
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), decoder_out_cache_.get(),
+          config.decoder_config.greedy_batch_frames);
     } else if (config.decoder_config.method == "modified_beam_search") {
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
-          model_.get(), config.decoder_config.num_active_paths);
+          model_.get(), config.decoder_config.num_active_paths,
+          decoder_out_cache_.get());
+
+      // The hypotheses of a stream are decoded together
+      if (model_) {
+        model_->EnableDecoder2D();
+      }
 
       if (!config_.hotwords_file.empty()) {
         InitHotwords();
@@ -113,19 +146,41 @@ class Recognizer::Impl {
       NCNN_LOGE("Unsupported method: %s", config.decoder_config.method.c_str());
       exit(-1);
     }
+
+    if (config.enable_stats) {
+      stats_ = std::make_unique<StageStats>();
+      decoder_->SetStageStats(stats_.get());
+    }
   }
 
 #if __ANDROID_API__ >= 9
   Impl(AAssetManager *mgr, const RecognizerConfig &config)
       : config_(config),
-        model_(Model::Create(mgr, config.model_config)),
+        model_(Model::Create(mgr, GetModelConfig(config))),
         endpoint_(config.endpoint_config),
         sym_(mgr, config.model_config.tokens) {
+    if (model_) {
+      init_states_ = model_->GetEncoderInitStates();
+    }
+
+    if (config.decoder_config.decoder_out_cache_size > 0) {
+      decoder_out_cache_ = std::make_unique<DecoderOutCache>(
+          config.decoder_config.decoder_out_cache_size);
+    }
+
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), decoder_out_cache_.get(),
+          config.decoder_config.greedy_batch_frames);
     } else if (config.decoder_config.method == "modified_beam_search") {
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
-          model_.get(), config.decoder_config.num_active_paths);
+          model_.get(), config.decoder_config.num_active_paths,
+          decoder_out_cache_.get());
+
+      // The hypotheses of a stream are decoded together
+      if (model_) {
+        model_->EnableDecoder2D();
+      }
 
       if (!config_.hotwords_file.empty()) {
         InitHotwords(mgr);
@@ -134,35 +189,60 @@ class Recognizer::Impl {
       NCNN_LOGE("Unsupported method: %s", config.decoder_config.method.c_str());
       exit(-1);
     }
+
+    if (config.enable_stats) {
+      stats_ = std::make_unique<StageStats>();
+      decoder_->SetStageStats(stats_.get());
+    }
   }
 #endif
 
   std::unique_ptr<Stream> CreateStream() const {
-    if (hotwords_.empty()) {
-      auto stream = std::make_unique<Stream>(config_.feat_config);
-      stream->SetResult(decoder_->GetEmptyResult());
-      stream->SetStates(model_->GetEncoderInitStates());
-      return stream;
-    } else {
-      auto r = decoder_->GetEmptyResult();
-
-      auto context_graph =
+    ContextGraphPtr context_graph;
+    if (!hotwords_.empty()) {
+      context_graph =
           std::make_shared<ContextGraph>(hotwords_, config_.hotwords_score);
+    }
 
-      auto stream =
-          std::make_unique<Stream>(config_.feat_config, context_graph);
+    auto stream = std::make_unique<Stream>(config_.feat_config, context_graph);
+    InitStream(stream.get());
 
-      if (stream->GetContextGraph()) {
-        // r.hyps has only one element.
-        for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-          it->second.context_state = stream->GetContextGraph()->Root();
-        }
+    return stream;
+  }
+
+  std::unique_ptr<Stream> AcquireStream() const {
+    std::unique_ptr<Stream> stream;
+    {
+      std::lock_guard<std::mutex> lock(stream_pool_mutex_);
+      if (!stream_pool_.empty()) {
+        stream = std::move(stream_pool_.back());
+        stream_pool_.pop_back();
       }
+    }
 
-      stream->SetResult(r);
-      stream->SetStates(model_->GetEncoderInitStates());
+    if (!stream) {
+      return CreateStream();
+    }
+
+    // It has been reinitialized by ReleaseStream(). The context graph
+    // depends only on the hotwords, so it is reused as well.
+    InitStream(stream.get());
 
-      return stream;
+    return stream;
+  }
+
+  void ReleaseStream(std::unique_ptr<Stream> s) const {
+    if (!s) {
+      return;
+    }
+
+    // Free the audio samples and results before the stream is pooled
+    s->Reinitialize();
+
+    std::lock_guard<std::mutex> lock(stream_pool_mutex_);
+    if (static_cast<int32_t>(stream_pool_.size()) <
+        config_.max_pooled_streams) {
+      stream_pool_.push_back(std::move(s));
     }
   }
 
@@ -171,26 +251,174 @@ class Recognizer::Impl {
   }
 
   void DecodeStream(Stream *s) const {
+    ScopedTraceSpan span("DecodeStream");
+
+    if (config_.decoder_config.pipeline) {
+      DecodeStreamPipelined(s);
+      return;
+    }
+
+    ncnn::Mat encoder_out = RunEncoder(s, s->GetExecutionContext());
+
+    ScopedStageTimer timer(stats_.get(), Stage::kSearch);
+    decoder_->Decode(encoder_out, s, &s->GetResult());
+  }
+
+  // If the stream has fallen behind, several chunks are ready. They are
+  // decoded together to catch up faster.
+  int32_t NumChunksToDecode(Stream *s) const {
+    int32_t segment = model_->Segment();
+    int32_t offset = model_->Offset();
+
+    int32_t num_ready_frames =
+        s->NumFramesReady() - s->GetNumProcessedFrames() - segment;
+    int32_t num_chunks = (num_ready_frames - 1) / offset + 1;
+    return std::max(
+        1, std::min(num_chunks, config_.decoder_config.max_chunks_per_decode));
+  }
+
+  // Run the encoder on the next chunks of the stream, advance its states
+  // and release the frames of the chunks
+  ncnn::Mat RunEncoder(Stream *s, ExecutionContext *ctx) const {
     int32_t segment = model_->Segment();
     int32_t offset = model_->Offset();
+    int32_t num_chunks = NumChunksToDecode(s);
 
-    ncnn::Mat features = s->GetFrames(s->GetNumProcessedFrames(), segment);
-    s->GetNumProcessedFrames() += offset;
+    ncnn::Mat features;
+    {
+      ScopedStageTimer timer(stats_.get(), Stage::kGetFrames);
+      features = s->GetFrames(s->GetNumProcessedFrames(),
+                              segment + (num_chunks - 1) * offset);
+    }
+    s->GetNumProcessedFrames() += num_chunks * offset;
     std::vector<ncnn::Mat> states = s->GetStates();
 
     ncnn::Mat encoder_out;
-    std::tie(encoder_out, states) = model_->RunEncoder(features, states);
-
-    if (s->GetContextGraph()) {
-      decoder_->Decode(encoder_out, s, &s->GetResult());
-    } else {
-      decoder_->Decode(encoder_out, &s->GetResult());
+    {
+      ScopedStageTimer timer(stats_.get(), Stage::kEncoder);
+      std::tie(encoder_out, states) =
+          model_->RunEncoderChunks(features, num_chunks, states, ctx);
     }
+
     s->SetStates(states);
+    s->ReleaseProcessedFrames();
+
+    return encoder_out;
+  }
+
+  // The encoder runs on the calling thread and the search on the thread of
+  // the stream's SearchPipeline
+  void DecodeStreamPipelined(Stream *s) const {
+    SearchPipeline *pipeline = s->GetSearchPipeline();
+    if (!pipeline) {
+      s->SetSearchPipeline(std::make_unique<SearchPipeline>(
+          [this, s](ncnn::Mat &encoder_out) {
+            ScopedStageTimer timer(stats_.get(), Stage::kSearch);
+            decoder_->Decode(encoder_out, s, &s->GetResult());
+          }));
+      pipeline = s->GetSearchPipeline();
+    }
+
+    ncnn::Mat encoder_out = RunEncoder(s, pipeline->GetEncoderContext());
+
+    // It is released by the search thread, so it is copied out of the pool
+    // allocators of the encoder context, which are not thread-safe
+    pipeline->Push(encoder_out.clone());
+  }
+
+  // Wait for the pending searches of a stream in pipeline mode
+  void WaitForSearch(Stream *s) const {
+    if (SearchPipeline *pipeline = s->GetSearchPipeline()) {
+      pipeline->Wait();
+    }
+  }
+
+  void DecodeStreams(Stream **ss, int32_t n) const {
+    if (n <= 0) {
+      return;
+    }
+
+    if (n == 1) {
+      DecodeStream(ss[0]);
+      return;
+    }
+
+    ScopedTraceSpan span("DecodeStreams");
+
+    // The streams are decoded together
+    model_->EnableDecoder2D();
+
+    int32_t segment = model_->Segment();
+    int32_t offset = model_->Offset();
+
+    for (int32_t i = 0; i != n; ++i) {
+      WaitForSearch(ss[i]);
+    }
+
+    std::vector<ncnn::Mat> features(n);
+    std::vector<int32_t> num_chunks(n);
+    std::vector<std::vector<ncnn::Mat>> states(n);
+    std::vector<ExecutionContext *> ctx(n);
+    for (int32_t i = 0; i != n; ++i) {
+      Stream *s = ss[i];
+      ctx[i] = s->GetExecutionContext();
+      num_chunks[i] = NumChunksToDecode(s);
+      {
+        ScopedStageTimer timer(stats_.get(), Stage::kGetFrames);
+        features[i] = s->GetFrames(s->GetNumProcessedFrames(),
+                                   segment + (num_chunks[i] - 1) * offset);
+      }
+      s->GetNumProcessedFrames() += num_chunks[i] * offset;
+      states[i] = std::move(s->GetStates());
+    }
+
+    std::vector<ncnn::Mat> encoder_out;
+    {
+      ScopedStageTimer timer(stats_.get(), Stage::kEncoder);
+      encoder_out =
+          model_->RunEncoderChunksBatch(features, num_chunks, &states, ctx);
+    }
+
+    {
+      ScopedStageTimer timer(stats_.get(), Stage::kSearch);
+
+      // The search is batched over the streams with the same number of
+      // chunks, since their encoder_out have the same number of frames
+      std::vector<int32_t> order(n);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(),
+                       [&num_chunks](int32_t a, int32_t b) {
+                         return num_chunks[a] < num_chunks[b];
+                       });
+
+      std::vector<Stream *> group_streams;
+      std::vector<ncnn::Mat> group_encoder_out;
+      for (int32_t begin = 0; begin != n;) {
+        int32_t end = begin;
+        group_streams.clear();
+        group_encoder_out.clear();
+        while (end != n && num_chunks[order[end]] == num_chunks[order[begin]]) {
+          group_streams.push_back(ss[order[end]]);
+          group_encoder_out.push_back(encoder_out[order[end]]);
+          ++end;
+        }
+
+        decoder_->Decode(group_encoder_out.data(), group_streams.data(),
+                         end - begin);
+        begin = end;
+      }
+    }
+
+    for (int32_t i = 0; i != n; ++i) {
+      ss[i]->SetStates(states[i]);
+      ss[i]->ReleaseProcessedFrames();
+    }
   }
 
   bool IsEndpoint(Stream *s) const {
     if (!config_.enable_endpoint) return false;
+    WaitForSearch(s);
+
     int32_t num_processed_frames = s->GetNumProcessedFrames();
 
     // frame shift is 10 milliseconds
@@ -204,6 +432,8 @@ class Recognizer::Impl {
   }
 
   void Reset(Stream *s) const {
+    WaitForSearch(s);
+
     auto r = decoder_->GetEmptyResult();
 
     if (s->GetContextGraph()) {
@@ -220,12 +450,15 @@ class Recognizer::Impl {
     // s->SetStates(model_->GetEncoderInitStates());
 
     // reset feature extractor
-    // Note: We only reset the counter. The underlying audio samples are
-    // still kept in memory
+    // Note: We only reset the counter. The frames that have been decoded
+    // are released.
     s->Reset();
+    s->ReleaseProcessedFrames();
   }
 
   RecognitionResult GetResult(Stream *s) const {
+    WaitForSearch(s);
+
     if (IsEndpoint(s)) {
       s->Finalize();
     }
@@ -241,7 +474,34 @@ class Recognizer::Impl {
 
   const Model *GetModel() const { return model_.get(); }
 
+  const RecognizerConfig &GetConfig() const { return config_; }
+
+  const DecoderOutCache *GetDecoderOutCache() const {
+    return decoder_out_cache_.get();
+  }
+
+  StageStats *GetStageStats() const { return stats_.get(); }
+
  private:
+  // Set the result and the encoder states of a new or reinitialized stream
+  void InitStream(Stream *s) const {
+    auto r = decoder_->GetEmptyResult();
+
+    if (s->GetContextGraph()) {
+      // r.hyps has only one element.
+      for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
+        it->second.context_state = s->GetContextGraph()->Root();
+      }
+    }
+
+    s->SetResult(r);
+
+    // The states share memory with init_states_. It is never written to:
+    // the encoder returns new states instead of updating its inputs, and
+    // ncnn clones a shared input before running an in-place layer on it.
+    s->SetStates(init_states_);
+  }
+
 #if __ANDROID_API__ >= 9
   void InitHotwords(AAssetManager *mgr) {
     AAsset *asset = AAssetManager_open(mgr, config_.hotwords_file.c_str(),
@@ -312,11 +572,21 @@ class Recognizer::Impl {
  private:
   RecognizerConfig config_;
   std::unique_ptr<Model> model_;
+  // Initial encoder states shared by all streams
+  std::vector<ncnn::Mat> init_states_;
+  // shared by all streams. It is nullptr if the cache is disabled.
+  std::unique_ptr<DecoderOutCache> decoder_out_cache_;
   std::unique_ptr<Decoder> decoder_;
+  // It is nullptr if config_.enable_stats is false
+  std::unique_ptr<StageStats> stats_;
   Endpoint endpoint_;
   SymbolTable sym_;
   std::vector<std::vector<int32_t>> hotwords_;
   std::vector<float> boost_scores_;
+
+  // Streams returned by ReleaseStream()
+  mutable std::mutex stream_pool_mutex_;
+  mutable std::vector<std::unique_ptr<Stream>> stream_pool_;
 };
 
 Recognizer::Recognizer(const RecognizerConfig &config)
@@ -333,10 +603,22 @@ std::unique_ptr<Stream> Recognizer::CreateStream() const {
   return impl_->CreateStream();
 }
 
+std::unique_ptr<Stream> Recognizer::AcquireStream() const {
+  return impl_->AcquireStream();
+}
+
+void Recognizer::ReleaseStream(std::unique_ptr<Stream> s) const {
+  impl_->ReleaseStream(std::move(s));
+}
+
 bool Recognizer::IsReady(Stream *s) const { return impl_->IsReady(s); }
 
 void Recognizer::DecodeStream(Stream *s) const { impl_->DecodeStream(s); }
 
+void Recognizer::DecodeStreams(Stream **ss, int32_t n) const {
+  impl_->DecodeStreams(ss, n);
+}
+
 bool Recognizer::IsEndpoint(Stream *s) const { return impl_->IsEndpoint(s); }
 
 void Recognizer::Reset(Stream *s) const { impl_->Reset(s); }
@@ -347,4 +629,16 @@ RecognitionResult Recognizer::GetResult(Stream *s) const {
 
 const Model *Recognizer::GetModel() const { return impl_->GetModel(); }
 
+const RecognizerConfig &Recognizer::GetConfig() const {
+  return impl_->GetConfig();
+}
+
+const DecoderOutCache *Recognizer::GetDecoderOutCache() const {
+  return impl_->GetDecoderOutCache();
+}
+
+StageStats *Recognizer::GetStageStats() const {
+  return impl_->GetStageStats();
+}
+
 }  // namespace sherpa_ncnn
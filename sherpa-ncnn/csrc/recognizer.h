@@ -24,10 +24,12 @@
 #include <string>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/decoder-out-cache.h"
 #include "sherpa-ncnn/csrc/endpoint.h"
 #include "sherpa-ncnn/csrc/features.h"
 #include "sherpa-ncnn/csrc/hypothesis.h"
 #include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/stage-stats.h"
 #include "sherpa-ncnn/csrc/stream.h"
 #include "sherpa-ncnn/csrc/symbol-table.h"
 
@@ -61,6 +63,15 @@ struct RecognizerConfig {
   /// used only for modified_beam_search
   float hotwords_score = 1.5;
 
+  /// true to record the latency of each stage of decoding.
+  /// See Recognizer::GetStageStats()
+  bool enable_stats = false;
+
+  /// Maximum number of idle streams kept by Recognizer::ReleaseStream().
+  /// Each of them keeps the memory pools used for running the networks,
+  /// sized for the largest chunk it has decoded. 0 disables the pool.
+  int32_t max_pooled_streams = 16;
+
   RecognizerConfig() = default;
 
   RecognizerConfig(const FeatureExtractorConfig &feat_config,
@@ -92,6 +103,19 @@ class Recognizer {
   /// Create a stream for decoding.
   std::unique_ptr<Stream> CreateStream() const;
 
+  /// Like CreateStream(), but reuse a stream returned by ReleaseStream()
+  /// if there is one. Reusing a stream only resets its state; its feature
+  /// extractor and the memory pools used for running the networks are
+  /// kept. It is thread-safe.
+  std::unique_ptr<Stream> AcquireStream() const;
+
+  /// Return a stream to the pool used by AcquireStream(). The stream must
+  /// have been created by this recognizer. Its audio samples and results
+  /// are discarded. If the pool already holds
+  /// RecognizerConfig::max_pooled_streams streams, the stream is freed.
+  /// It is thread-safe.
+  void ReleaseStream(std::unique_ptr<Stream> s) const;
+
   /**
    * Return true if the given stream has enough frames for decoding.
    * Return false otherwise
@@ -100,6 +124,20 @@ class Recognizer {
 
   void DecodeStream(Stream *s) const;
 
+  /**
+   * Decode the next chunk of several streams together.
+   *
+   * It is equivalent to calling DecodeStream() on each of them, but the
+   * encoder is run for the whole batch at once, which gives a much better
+   * throughput when there are many concurrent streams.
+   *
+   * @param ss  Pointer to an array of streams. The caller has to ensure
+   *            IsReady() returns true for each of them and that a stream
+   *            does not appear twice.
+   * @param n  Number of streams in the array. It may be 0.
+   */
+  void DecodeStreams(Stream **ss, int32_t n) const;
+
   // Return true if we detect an endpoint for this stream.
   // Note: If this function returns true, you usually want to
   // invoke Reset(s).
@@ -116,6 +154,18 @@ class Recognizer {
   // The user should not free it.
   const Model *GetModel() const;
 
+  const RecognizerConfig &GetConfig() const;
+
+  // Return the cache of decoder outputs shared by all streams, e.g., to
+  // query its hit rate. It returns nullptr if
+  // decoder_config.decoder_out_cache_size is 0.
+  const DecoderOutCache *GetDecoderOutCache() const;
+
+  // Return the latency histograms of the stages of decoding, recorded
+  // across all streams of this recognizer. It returns nullptr if
+  // config.enable_stats is false.
+  StageStats *GetStageStats() const;
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
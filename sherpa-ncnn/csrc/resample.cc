@@ -28,9 +28,29 @@
 #include <math.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <cstdlib>
+#include <map>
+#include <mutex>  // NOLINT
+#include <tuple>
 #include <type_traits>
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SHERPA_NCNN_RESAMPLE_NEON 1
+#elif (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// Compiled for AVX2 regardless of the compiler flags. It is used only if
+// the CPU supports it.
+#define SHERPA_NCNN_RESAMPLE_AVX2 1
+#define SHERPA_NCNN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(__AVX2__)
+#include <immintrin.h>
+#define SHERPA_NCNN_RESAMPLE_AVX2 1
+#define SHERPA_NCNN_TARGET_AVX2
+#endif
+
 #ifndef M_2PI
 #define M_2PI 6.283185307179586476925286766559005
 #endif
@@ -73,7 +93,7 @@ I Lcm(I m, I n) {
   return gcd * (m / gcd) * (n / gcd);
 }
 
-static float DotProduct(const float *a, const float *b, int32_t n) {
+static float DotProductScalar(const float *a, const float *b, int32_t n) {
   float sum = 0;
   for (int32_t i = 0; i != n; ++i) {
     sum += a[i] * b[i];
@@ -81,76 +101,193 @@ static float DotProduct(const float *a, const float *b, int32_t n) {
   return sum;
 }
 
-LinearResample::LinearResample(int32_t samp_rate_in_hz,
-                               int32_t samp_rate_out_hz, float filter_cutoff_hz,
-                               int32_t num_zeros)
-    : samp_rate_in_(samp_rate_in_hz),
-      samp_rate_out_(samp_rate_out_hz),
-      filter_cutoff_(filter_cutoff_hz),
-      num_zeros_(num_zeros) {
-  assert(samp_rate_in_hz > 0.0 && samp_rate_out_hz > 0.0 &&
-         filter_cutoff_hz > 0.0 && filter_cutoff_hz * 2 <= samp_rate_in_hz &&
-         filter_cutoff_hz * 2 <= samp_rate_out_hz && num_zeros > 0);
+#if SHERPA_NCNN_RESAMPLE_AVX2
 
-  // base_freq is the frequency of the repeating unit, which is the gcd
-  // of the input frequencies.
-  int32_t base_freq = Gcd(samp_rate_in_, samp_rate_out_);
-  input_samples_in_unit_ = samp_rate_in_ / base_freq;
-  output_samples_in_unit_ = samp_rate_out_ / base_freq;
+SHERPA_NCNN_TARGET_AVX2 static float DotProductAvx2(const float *a,
+                                                    const float *b,
+                                                    int32_t n) {
+  __m256 sum = _mm256_setzero_ps();
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    sum = _mm256_add_ps(
+        sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
 
-  SetIndexesAndWeights();
-  Reset();
+  __m128 s =
+      _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+
+  return _mm_cvtss_f32(s) + DotProductScalar(a + i, b + i, n - i);
+}
+
+static bool CpuSupportsAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+  static const bool ans = __builtin_cpu_supports("avx2");
+  return ans;
+#else
+  return true;  // compiled with /arch:AVX2
+#endif
+}
+
+#endif  // SHERPA_NCNN_RESAMPLE_AVX2
+
+#if SHERPA_NCNN_RESAMPLE_NEON
+
+static float DotProductNeon(const float *a, const float *b, int32_t n) {
+  float32x4_t sum = vdupq_n_f32(0);
+  int32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    sum = vmlaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+  }
+
+  float32x2_t s = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+  s = vpadd_f32(s, s);
+
+  return vget_lane_f32(s, 0) + DotProductScalar(a + i, b + i, n - i);
+}
+
+#endif  // SHERPA_NCNN_RESAMPLE_NEON
+
+static float DotProduct(const float *a, const float *b, int32_t n) {
+#if SHERPA_NCNN_RESAMPLE_AVX2
+  if (CpuSupportsAvx2()) {
+    return DotProductAvx2(a, b, n);
+  }
+#elif SHERPA_NCNN_RESAMPLE_NEON
+  return DotProductNeon(a, b, n);
+#endif
+
+  return DotProductScalar(a, b, n);
+}
+
+struct ResampleFilter {
+  /// The first input-sample index that we sum over, for each output-sample
+  /// index in the repeating unit.  May be negative; any truncation at the
+  /// beginning is handled separately.  This is just for the first few output
+  /// samples, but we can extrapolate the correct input-sample index for
+  /// arbitrary output samples.
+  std::vector<int32_t> first_index;
+
+  /// Number of weights of each output-sample index in the repeating unit
+  std::vector<int32_t> num_weights;
+
+  /// Weights on the input samples. Those of the i-th output-sample index
+  /// start at i * stride.
+  std::vector<float> weights;
+  int32_t stride = 0;
+
+  const float *Weights(int32_t i) const { return weights.data() + i * stride; }
+};
+
+/** Here, t is a time in seconds representing an offset from
+    the center of the windowed filter function, and FilterFunction(t)
+    returns the windowed filter function, described
+    in the header as h(t) = f(t)g(t), evaluated at t.
+*/
+static float FilterFunc(float t, float filter_cutoff, int32_t num_zeros) {
+  float window,  // raised-cosine (Hanning) window of width
+                 // num_zeros/2*filter_cutoff
+      filter;    // sinc filter function
+  if (fabs(t) < num_zeros / (2.0 * filter_cutoff))
+    window = 0.5 * (1 + cos(M_2PI * filter_cutoff / num_zeros * t));
+  else
+    window = 0.0;  // outside support of window function
+  if (t != 0)
+    filter = sin(M_2PI * filter_cutoff * t) / (M_PI * t);
+  else
+    filter = 2 * filter_cutoff;  // limit of the function at t = 0
+  return filter * window;
 }
 
-void LinearResample::SetIndexesAndWeights() {
-  first_index_.resize(output_samples_in_unit_);
-  weights_.resize(output_samples_in_unit_);
+static std::shared_ptr<const ResampleFilter> CreateFilter(
+    int32_t samp_rate_in, int32_t samp_rate_out, float filter_cutoff,
+    int32_t num_zeros, int32_t output_samples_in_unit) {
+  auto filter = std::make_shared<ResampleFilter>();
+  filter->first_index.resize(output_samples_in_unit);
+  filter->num_weights.resize(output_samples_in_unit);
 
-  double window_width = num_zeros_ / (2.0 * filter_cutoff_);
+  double window_width = num_zeros / (2.0 * filter_cutoff);
 
-  for (int32_t i = 0; i < output_samples_in_unit_; i++) {
-    double output_t = i / static_cast<double>(samp_rate_out_);
+  std::vector<std::vector<float>> weights(output_samples_in_unit);
+  for (int32_t i = 0; i < output_samples_in_unit; i++) {
+    double output_t = i / static_cast<double>(samp_rate_out);
     double min_t = output_t - window_width, max_t = output_t + window_width;
     // we do ceil on the min and floor on the max, because if we did it
     // the other way around we would unnecessarily include indexes just
     // outside the window, with zero coefficients.  It's possible
     // if the arguments to the ceil and floor expressions are integers
-    // (e.g. if filter_cutoff_ has an exact ratio with the sample rates),
+    // (e.g. if filter_cutoff has an exact ratio with the sample rates),
     // that we unnecessarily include something with a zero coefficient,
     // but this is only a slight efficiency issue.
-    int32_t min_input_index = ceil(min_t * samp_rate_in_),
-            max_input_index = floor(max_t * samp_rate_in_),
+    int32_t min_input_index = ceil(min_t * samp_rate_in),
+            max_input_index = floor(max_t * samp_rate_in),
             num_indices = max_input_index - min_input_index + 1;
-    first_index_[i] = min_input_index;
-    weights_[i].resize(num_indices);
+    filter->first_index[i] = min_input_index;
+    filter->num_weights[i] = num_indices;
+    weights[i].resize(num_indices);
     for (int32_t j = 0; j < num_indices; j++) {
       int32_t input_index = min_input_index + j;
-      double input_t = input_index / static_cast<double>(samp_rate_in_),
+      double input_t = input_index / static_cast<double>(samp_rate_in),
              delta_t = input_t - output_t;
       // sign of delta_t doesn't matter.
-      weights_[i][j] = FilterFunc(delta_t) / samp_rate_in_;
+      weights[i][j] =
+          FilterFunc(delta_t, filter_cutoff, num_zeros) / samp_rate_in;
     }
+    filter->stride = std::max(filter->stride, num_indices);
   }
+
+  // Store the weights in one array so that they are close in memory
+  filter->weights.resize(output_samples_in_unit * filter->stride);
+  for (int32_t i = 0; i < output_samples_in_unit; i++) {
+    std::copy(weights[i].begin(), weights[i].end(),
+              filter->weights.begin() + i * filter->stride);
+  }
+
+  return filter;
 }
 
-/** Here, t is a time in seconds representing an offset from
-    the center of the windowed filter function, and FilterFunction(t)
-    returns the windowed filter function, described
-    in the header as h(t) = f(t)g(t), evaluated at t.
-*/
-float LinearResample::FilterFunc(float t) const {
-  float window,  // raised-cosine (Hanning) window of width
-                 // num_zeros_/2*filter_cutoff_
-      filter;    // sinc filter function
-  if (fabs(t) < num_zeros_ / (2.0 * filter_cutoff_))
-    window = 0.5 * (1 + cos(M_2PI * filter_cutoff_ / num_zeros_ * t));
-  else
-    window = 0.0;  // outside support of window function
-  if (t != 0)
-    filter = sin(M_2PI * filter_cutoff_ * t) / (M_PI * t);
-  else
-    filter = 2 * filter_cutoff_;  // limit of the function at t = 0
-  return filter * window;
+// Return the filter for the given arguments, computing it on first use.
+// Filters are never freed; there are only a few distinct sample rates.
+static std::shared_ptr<const ResampleFilter> GetFilter(
+    int32_t samp_rate_in, int32_t samp_rate_out, float filter_cutoff,
+    int32_t num_zeros, int32_t output_samples_in_unit) {
+  using Key = std::tuple<int32_t, int32_t, float, int32_t>;
+  static std::mutex mutex;
+  static std::map<Key, std::shared_ptr<const ResampleFilter>> filters;
+
+  Key key{samp_rate_in, samp_rate_out, filter_cutoff, num_zeros};
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &filter = filters[key];
+  if (!filter) {
+    filter = CreateFilter(samp_rate_in, samp_rate_out, filter_cutoff,
+                          num_zeros, output_samples_in_unit);
+  }
+
+  return filter;
+}
+
+LinearResample::LinearResample(int32_t samp_rate_in_hz,
+                               int32_t samp_rate_out_hz, float filter_cutoff_hz,
+                               int32_t num_zeros)
+    : samp_rate_in_(samp_rate_in_hz),
+      samp_rate_out_(samp_rate_out_hz),
+      filter_cutoff_(filter_cutoff_hz),
+      num_zeros_(num_zeros) {
+  assert(samp_rate_in_hz > 0.0 && samp_rate_out_hz > 0.0 &&
+         filter_cutoff_hz > 0.0 && filter_cutoff_hz * 2 <= samp_rate_in_hz &&
+         filter_cutoff_hz * 2 <= samp_rate_out_hz && num_zeros > 0);
+
+  // base_freq is the frequency of the repeating unit, which is the gcd
+  // of the input frequencies.
+  int32_t base_freq = Gcd(samp_rate_in_, samp_rate_out_);
+  input_samples_in_unit_ = samp_rate_in_ / base_freq;
+  output_samples_in_unit_ = samp_rate_out_ / base_freq;
+
+  filter_ = GetFilter(samp_rate_in_, samp_rate_out_, filter_cutoff_,
+                      num_zeros_, output_samples_in_unit_);
+  Reset();
 }
 
 void LinearResample::Reset() {
@@ -175,34 +312,37 @@ void LinearResample::Resample(const float *input, int32_t input_dim, bool flush,
     int64_t first_samp_in;
     int32_t samp_out_wrapped;
     GetIndexes(samp_out, &first_samp_in, &samp_out_wrapped);
-    const std::vector<float> &weights = weights_[samp_out_wrapped];
+    const float *weights = filter_->Weights(samp_out_wrapped);
+    int32_t num_weights = filter_->num_weights[samp_out_wrapped];
     // first_input_index is the first index into "input" that we have a weight
     // for.
     int32_t first_input_index =
         static_cast<int32_t>(first_samp_in - input_sample_offset_);
     float this_output;
     if (first_input_index >= 0 &&
-        first_input_index + static_cast<int32_t>(weights.size()) <= input_dim) {
-      this_output =
-          DotProduct(input + first_input_index, weights.data(), weights.size());
+        first_input_index + num_weights <= input_dim) {
+      this_output = DotProduct(input + first_input_index, weights, num_weights);
     } else {  // Handle edge cases.
-      this_output = 0.0;
-      for (int32_t i = 0; i < static_cast<int32_t>(weights.size()); i++) {
-        float weight = weights[i];
+      // Gather the input samples so that the result does not depend on how
+      // the input is split into chunks
+      edge_samples_.resize(num_weights);
+      for (int32_t i = 0; i < num_weights; i++) {
         int32_t input_index = first_input_index + i;
+        float sample = 0;
         if (input_index < 0 &&
             static_cast<int32_t>(input_remainder_.size()) + input_index >= 0) {
-          this_output +=
-              weight * input_remainder_[input_remainder_.size() + input_index];
+          sample = input_remainder_[input_remainder_.size() + input_index];
         } else if (input_index >= 0 && input_index < input_dim) {
-          this_output += weight * input[input_index];
+          sample = input[input_index];
         } else if (input_index >= input_dim) {
           // We're past the end of the input and are adding zero; should only
           // happen if the user specified flush == true, or else we would not
           // be trying to output this sample.
           assert(flush);
         }
+        edge_samples_[i] = sample;
       }
+      this_output = DotProduct(edge_samples_.data(), weights, num_weights);
     }
     int32_t output_index =
         static_cast<int32_t>(samp_out - output_sample_offset_);
@@ -275,12 +415,11 @@ void LinearResample::GetIndexes(int64_t samp_out, int64_t *first_samp_in,
   // samp_out_wrapped is equal to samp_out % output_samples_in_unit_
   *samp_out_wrapped =
       static_cast<int32_t>(samp_out - unit_index * output_samples_in_unit_);
-  *first_samp_in =
-      first_index_[*samp_out_wrapped] + unit_index * input_samples_in_unit_;
+  *first_samp_in = filter_->first_index[*samp_out_wrapped] +
+                   unit_index * input_samples_in_unit_;
 }
 
 void LinearResample::SetRemainder(const float *input, int32_t input_dim) {
-  std::vector<float> old_remainder(input_remainder_);
   // max_remainder_needed is the width of the filter from side to side,
   // measured in input samples.  you might think it should be half that,
   // but you have to consider that you might be wanting to output samples
@@ -288,22 +427,26 @@ void LinearResample::SetRemainder(const float *input, int32_t input_dim) {
   // input... anyway, storing more remainder than needed is not harmful.
   int32_t max_remainder_needed =
       ceil(samp_rate_in_ * num_zeros_ / filter_cutoff_);
-  input_remainder_.resize(max_remainder_needed);
-  for (int32_t index = -static_cast<int32_t>(input_remainder_.size());
-       index < 0; index++) {
-    // we interpret "index" as an offset from the end of "input" and
-    // from the end of input_remainder_.
-    int32_t input_index = index + input_dim;
-    if (input_index >= 0) {
-      input_remainder_[index + static_cast<int32_t>(input_remainder_.size())] =
-          input[input_index];
-    } else if (input_index + static_cast<int32_t>(old_remainder.size()) >= 0) {
-      input_remainder_[index + static_cast<int32_t>(input_remainder_.size())] =
-          old_remainder[input_index +
-                        static_cast<int32_t>(old_remainder.size())];
-      // else leave it at zero.
-    }
+
+  if (input_dim >= max_remainder_needed) {
+    input_remainder_.assign(input + input_dim - max_remainder_needed,
+                            input + input_dim);
+    return;
+  }
+
+  // The new remainder is the last (max_remainder_needed - input_dim)
+  // samples of the old one, padded with zeros at the front if it is too
+  // short, followed by the input. It is updated in-place so that no memory
+  // is allocated once the remainder has reached its final size.
+  int32_t num_kept = max_remainder_needed - input_dim;
+  int32_t old_size = static_cast<int32_t>(input_remainder_.size());
+  if (old_size >= num_kept) {
+    input_remainder_.erase(input_remainder_.begin(),
+                           input_remainder_.begin() + (old_size - num_kept));
+  } else {
+    input_remainder_.insert(input_remainder_.begin(), num_kept - old_size, 0);
   }
+  input_remainder_.insert(input_remainder_.end(), input, input + input_dim);
 }
 
 }  // namespace sherpa_ncnn
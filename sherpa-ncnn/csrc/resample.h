@@ -25,10 +25,16 @@
 #define SHERPA_NCNN_CSRC_RESAMPLE_H_
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace sherpa_ncnn {
 
+// The polyphase filter of a LinearResample. It depends only on the
+// constructor arguments and is shared by all LinearResample objects that
+// are constructed with the same arguments.
+struct ResampleFilter;
+
 /*
    We require that the input and output sampling rate be specified as
    integers, as this is an easy way to specify that their ratio be rational.
@@ -42,6 +48,9 @@ class LinearResample {
   /// than samp_rate_in_hz/2 and less than samp_rate_out_hz/2.  num_zeros
   /// controls the sharpness of the filter, more == sharper but less efficient.
   /// We suggest around 4 to 10 for normal use.
+  ///
+  /// The filter weights are computed only once for each combination of
+  /// the arguments, so it is cheap to create a resampler for each stream.
   LinearResample(int32_t samp_rate_in_hz, int32_t samp_rate_out_hz,
                  float filter_cutoff_hz, int32_t num_zeros);
 
@@ -70,6 +79,9 @@ class LinearResample {
   /// If your most recent call to the object was with flush == false, it will
   /// have internal state; you can remove this by calling Reset().
   /// Empty input is acceptable.
+  ///
+  /// The memory of output is reused if it is large enough, so passing the
+  /// same vector in every call avoids allocating memory.
   void Resample(const float *input, int32_t input_dim, bool flush,
                 std::vector<float> *output);
 
@@ -78,10 +90,6 @@ class LinearResample {
   int32_t GetOutputSamplingRate() const { return samp_rate_out_; }
 
  private:
-  void SetIndexesAndWeights();
-
-  float FilterFunc(float) const;
-
   /// This function outputs the number of output samples we will output
   /// for a signal with "input_num_samp" input samples.  If flush == true,
   /// we return the largest n such that
@@ -94,8 +102,8 @@ class LinearResample {
 
   /// Given an output-sample index, this function outputs to *first_samp_in the
   /// first input-sample index that we have a weight on (may be negative),
-  /// and to *samp_out_wrapped the index into weights_ where we can get the
-  /// corresponding weights on the input.
+  /// and to *samp_out_wrapped the index into the filter weights where we can
+  /// get the corresponding weights on the input.
   inline void GetIndexes(int64_t samp_out, int64_t *first_samp_in,
                          int32_t *samp_out_wrapped) const;
 
@@ -118,14 +126,9 @@ class LinearResample {
                                     ///< = samp_rate_out_hz /
                                     ///< Gcd(samp_rate_in_hz, samp_rate_out_hz)
 
-  /// The first input-sample index that we sum over, for this output-sample
-  /// index.  May be negative; any truncation at the beginning is handled
-  /// separately.  This is just for the first few output samples, but we can
-  /// extrapolate the correct input-sample index for arbitrary output samples.
-  std::vector<int32_t> first_index_;
-
-  /// Weights on the input samples, for this output-sample index.
-  std::vector<std::vector<float>> weights_;
+  /// The first input-sample index and the weights for each output sample
+  /// in the repeating unit.
+  std::shared_ptr<const ResampleFilter> filter_;
 
   // the following variables keep track of where we are in a particular signal,
   // if it is being provided over multiple calls to Resample().
@@ -137,6 +140,9 @@ class LinearResample {
                                   ///< output for this signal.
   std::vector<float> input_remainder_;  ///< A small trailing part of the
                                         ///< previously seen input signal.
+  std::vector<float> edge_samples_;  ///< Input samples of an output sample
+                                     ///< that spans input_remainder_ and
+                                     ///< the input.
 };
 
 }  // namespace sherpa_ncnn
@@ -0,0 +1,115 @@
+// sherpa-ncnn/csrc/search-pipeline.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/search-pipeline.h"
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "sherpa-ncnn/csrc/trace.h"
+
+namespace sherpa_ncnn {
+
+class SearchPipeline::Impl {
+ public:
+  Impl(Search search, int32_t capacity)
+      : search_(std::move(search)),
+        capacity_(capacity > 0 ? capacity : 1),
+        thread_([this]() { Run(); }) {}
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    not_empty_cv_.notify_one();
+    thread_.join();
+  }
+
+  void Push(ncnn::Mat encoder_out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_cv_.wait(lock, [this]() {
+      return static_cast<int32_t>(queue_.size()) < capacity_;
+    });
+
+    queue_.push_back(std::move(encoder_out));
+    ++num_pending_;
+    lock.unlock();
+
+    not_empty_cv_.notify_one();
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]() { return num_pending_ == 0; });
+  }
+
+  ExecutionContext *GetEncoderContext() { return &encoder_context_; }
+
+ private:
+  void Run() {
+    SetTraceThreadName("search-pipeline");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      // Pending outputs are searched before stopping
+      not_empty_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+
+      ncnn::Mat encoder_out = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      not_full_cv_.notify_one();
+
+      search_(encoder_out);
+      encoder_out.release();
+
+      lock.lock();
+      if (--num_pending_ == 0) {
+        idle_cv_.notify_all();
+      }
+    }
+  }
+
+ private:
+  Search search_;
+  int32_t capacity_;
+  ExecutionContext encoder_context_;
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_cv_;
+  std::condition_variable not_full_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<ncnn::Mat> queue_;
+
+  // Number of outputs that are queued or being searched
+  int32_t num_pending_ = 0;
+  bool stop_ = false;
+
+  // It is declared last so that it starts after the members above are
+  // initialized
+  std::thread thread_;
+};
+
+SearchPipeline::SearchPipeline(Search search, int32_t capacity)
+    : impl_(std::make_unique<Impl>(std::move(search), capacity)) {}
+
+SearchPipeline::~SearchPipeline() = default;
+
+void SearchPipeline::Push(ncnn::Mat encoder_out) {
+  impl_->Push(std::move(encoder_out));
+}
+
+void SearchPipeline::Wait() { impl_->Wait(); }
+
+ExecutionContext *SearchPipeline::GetEncoderContext() {
+  return impl_->GetEncoderContext();
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,63 @@
+// sherpa-ncnn/csrc/search-pipeline.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_SEARCH_PIPELINE_H_
+#define SHERPA_NCNN_CSRC_SEARCH_PIPELINE_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/execution-context.h"
+
+namespace sherpa_ncnn {
+
+/**
+ * The search stage of a stream that is decoded in pipeline mode. See
+ * DecoderConfig::pipeline.
+ *
+ * Recognizer::DecodeStream() runs the encoder on the calling thread and
+ * pushes its output to a bounded queue. A thread owned by this class pops
+ * the outputs in order and runs the search on them, so the encoder of the
+ * next chunk runs while the search of the current chunk is running.
+ */
+class SearchPipeline {
+ public:
+  using Search = std::function<void(ncnn::Mat &encoder_out)>;
+
+  /**
+   * @param search  It is invoked on the thread of this object for each
+   *                pushed encoder_out.
+   * @param capacity  Maximum number of encoder outputs waiting for the
+   *                  search. Push() blocks if there are so many of them.
+   */
+  explicit SearchPipeline(Search search, int32_t capacity = 2);
+
+  // It waits until all pushed encoder outputs have been searched.
+  ~SearchPipeline();
+
+  /**
+   * Queue the given encoder output for the search.
+   *
+   * The thread of this object releases it, so it must not be allocated
+   * from a pool allocator that is used by other threads.
+   */
+  void Push(ncnn::Mat encoder_out);
+
+  // Block until all pushed encoder outputs have been searched.
+  void Wait();
+
+  // Memory for running the encoder. It is used only by the thread that
+  // calls Push(), while the search uses that of the stream.
+  ExecutionContext *GetEncoderContext();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_SEARCH_PIPELINE_H_
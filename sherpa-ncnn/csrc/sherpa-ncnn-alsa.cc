@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <cctype>  // std::tolower
 #include <cstdint>
+#include <string>
 
 #include "sherpa-ncnn/csrc/alsa.h"
 #include "sherpa-ncnn/csrc/display.h"
@@ -35,6 +36,21 @@ static void Handler(int sig) {
 };
 
 int main(int32_t argc, char *argv[]) {
+  // --print-stats can be given at any position. It is removed from argv
+  // before the positional arguments are parsed.
+  bool print_stats = false;
+  {
+    int32_t n = 1;
+    for (int32_t i = 1; i != argc; ++i) {
+      if (std::string(argv[i]) == "--print-stats") {
+        print_stats = true;
+      } else {
+        argv[n++] = argv[i];
+      }
+    }
+    argc = n;
+  }
+
   if (argc < 9 || argc > 11) {
     const char *usage = R"usage(
 Usage:
@@ -70,6 +86,9 @@ and if you want to select card 3 and the device 0 on that card, please use:
   plughw:3,0
 
 as the device_name.
+
+Pass --print-stats to print the latency of each stage of decoding after
+Ctrl + C.
 )usage";
 
     fprintf(stderr, "%s\n", usage);
@@ -127,6 +146,8 @@ as the device_name.
   config.feat_config.sampling_rate = expected_sampling_rate;
   config.feat_config.feature_dim = 80;
 
+  config.enable_stats = print_stats;
+
   fprintf(stderr, "%s\n", config.ToString().c_str());
 
   sherpa_ncnn::Recognizer recognizer(config);
@@ -180,5 +201,9 @@ as the device_name.
     }
   }
 
+  if (print_stats) {
+    fprintf(stderr, "%s", recognizer.GetStageStats()->ToString().c_str());
+  }
+
   return 0;
 }
@@ -0,0 +1,705 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-batch.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/resample.h"
+#include "sherpa-ncnn/csrc/trace.h"
+#include "sherpa-ncnn/csrc/voice-activity-detector.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+namespace {
+
+struct FileResult {
+  std::string filename;
+  sherpa_ncnn::RecognitionResult result;
+  bool ok = false;
+
+  // In seconds
+  float duration = 0;
+  float elapsed = 0;
+
+  // In seconds since the start of decoding
+  float start_time = 0;
+  float end_time = 0;
+
+  // Start and end time in seconds of each speech segment if the file is
+  // split with VAD
+  std::vector<std::pair<float, float>> segments;
+};
+
+using Clock = std::chrono::steady_clock;
+
+float SecondsSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               start)
+             .count() /
+         1e6;
+}
+
+std::string EscapeJson(const std::string &s) {
+  std::ostringstream os;
+  for (char c : s) {
+    switch (c) {
+      case '"':
+        os << "\\\"";
+        break;
+      case '\\':
+        os << "\\\\";
+        break;
+      case '\n':
+        os << "\\n";
+        break;
+      case '\t':
+        os << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          os << buf;
+        } else {
+          os << c;
+        }
+    }
+  }
+  return os.str();
+}
+
+std::string ToJson(const FileResult &r) {
+  std::ostringstream os;
+  os << "{\"filename\": \"" << EscapeJson(r.filename) << "\"";
+  if (!r.ok) {
+    os << ", \"error\": \"Failed to read the file\"}";
+    return os.str();
+  }
+
+  os << ", \"text\": \"" << EscapeJson(r.result.text) << "\"";
+
+  os << ", \"tokens\": [";
+  std::string sep;
+  for (const auto &t : r.result.stokens) {
+    os << sep << "\"" << EscapeJson(t) << "\"";
+    sep = ", ";
+  }
+  os << "]";
+
+  os << ", \"timestamps\": [";
+  sep = "";
+  for (float t : r.result.timestamps) {
+    os << sep << t;
+    sep = ", ";
+  }
+  os << "]";
+
+  os << ", \"duration\": " << r.duration;
+  os << ", \"elapsed\": " << r.elapsed;
+  os << ", \"rtf\": " << (r.duration > 0 ? r.elapsed / r.duration : 0);
+  os << ", \"start_time\": " << r.start_time;
+  os << ", \"end_time\": " << r.end_time;
+
+  if (!r.segments.empty()) {
+    os << ", \"segments\": [";
+    sep = "";
+    for (const auto &p : r.segments) {
+      os << sep << "[" << p.first << ", " << p.second << "]";
+      sep = ", ";
+    }
+    os << "]";
+  }
+
+  os << "}";
+
+  return os.str();
+}
+
+// Wave files given on the commandline. A directory is searched recursively
+// for *.wav files.
+void AddFiles(const std::string &path, std::vector<std::string> *files) {
+  namespace fs = std::filesystem;
+
+  std::error_code ec;
+  if (!fs::is_directory(path, ec)) {
+    files->push_back(path);
+    return;
+  }
+
+  std::vector<std::string> found;
+  for (const auto &entry : fs::recursive_directory_iterator(path, ec)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".wav") {
+      found.push_back(entry.path().string());
+    }
+  }
+
+  std::sort(found.begin(), found.end());
+  files->insert(files->end(), found.begin(), found.end());
+}
+
+sherpa_ncnn::RecognitionResult DecodeSamples(
+    const sherpa_ncnn::Recognizer &recognizer, int32_t sampling_rate,
+    std::vector<float> samples, int32_t num_threads) {
+  // Tail paddings
+  samples.resize(samples.size() + static_cast<int32_t>(0.3 * sampling_rate));
+
+  auto stream = recognizer.AcquireStream();
+  stream->AcceptWaveformOffline(sampling_rate, samples.data(),
+                                samples.size(), num_threads);
+  while (recognizer.IsReady(stream.get())) {
+    recognizer.DecodeStream(stream.get());
+  }
+  stream->Finalize();
+  auto result = recognizer.GetResult(stream.get());
+  recognizer.ReleaseStream(std::move(stream));
+
+  return result;
+}
+
+std::vector<float> Resample(const std::vector<float> &samples,
+                            int32_t sampling_rate, int32_t target_rate) {
+  if (sampling_rate == target_rate) {
+    return samples;
+  }
+
+  float min_freq = std::min(sampling_rate, target_rate);
+  float lowpass_cutoff = 0.99 * 0.5 * min_freq;
+  int32_t lowpass_filter_width = 6;
+
+  sherpa_ncnn::LinearResample resampler(sampling_rate, target_rate,
+                                        lowpass_cutoff, lowpass_filter_width);
+  std::vector<float> ans;
+  resampler.Resample(samples.data(), samples.size(), true, &ans);
+  return ans;
+}
+
+// Append the result of a speech segment starting at offset seconds to the
+// result of the whole file. The texts of the segments are separated by a
+// space.
+void Append(const sherpa_ncnn::RecognitionResult &segment, float offset,
+            sherpa_ncnn::RecognitionResult *r) {
+  if (!r->text.empty() && !segment.text.empty() && r->text.back() != ' ' &&
+      segment.text.front() != ' ') {
+    r->text += ' ';
+  }
+  r->text += segment.text;
+  r->tokens.insert(r->tokens.end(), segment.tokens.begin(),
+                   segment.tokens.end());
+  r->stokens.insert(r->stokens.end(), segment.stokens.begin(),
+                    segment.stokens.end());
+  for (float t : segment.timestamps) {
+    r->timestamps.push_back(t + offset);
+  }
+}
+
+// A queue of tasks run by a fixed number of workers. A task may push
+// more tasks.
+class TaskQueue {
+ public:
+  // The argument is the index of the worker that runs the task
+  using Task = std::function<void(int32_t)>;
+
+  // Tasks pushed to the front are run first
+  void Push(Task task, bool front = false) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (front) {
+        tasks_.push_front(std::move(task));
+      } else {
+        tasks_.push_back(std::move(task));
+      }
+      ++num_pending_;
+    }
+    cv_.notify_one();
+  }
+
+  // Run tasks until all of them are done
+  void Run(int32_t worker) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return !tasks_.empty() || num_pending_ == 0; });
+      if (tasks_.empty()) {
+        return;
+      }
+
+      Task task = std::move(tasks_.front());
+      tasks_.pop_front();
+
+      lock.unlock();
+      task(worker);
+      lock.lock();
+
+      if (--num_pending_ == 0) {
+        cv_.notify_all();
+      }
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Task> tasks_;
+
+  // Number of tasks that are queued or running
+  int32_t num_pending_ = 0;
+};
+
+// State of a file that is split into speech segments with VAD. Its
+// segments are decoded concurrently and stitched together after the last
+// of them is done.
+struct SplitFile {
+  FileResult r;
+
+  std::mutex mutex;
+  std::deque<sherpa_ncnn::RecognitionResult> results;
+  int32_t num_segments = 0;
+  int32_t num_decoded_segments = 0;
+  bool vad_done = false;
+};
+
+float Percentile(const std::vector<float> &sorted, float p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+
+  int32_t i = static_cast<int32_t>(p / 100 * (sorted.size() - 1) + 0.5f);
+  return sorted[i];
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Decode many wave files concurrently with a single model shared by all
+workers.
+
+Usage:
+
+./bin/sherpa-ncnn-batch \
+  --tokens=/path/to/tokens.txt \
+  --encoder-param=/path/to/encoder.ncnn.param \
+  --encoder-bin=/path/to/encoder.ncnn.bin \
+  --decoder-param=/path/to/decoder.ncnn.param \
+  --decoder-bin=/path/to/decoder.ncnn.bin \
+  --joiner-param=/path/to/joiner.ncnn.param \
+  --joiner-bin=/path/to/joiner.ncnn.bin \
+  --num-workers=8 \
+  --num-threads=1 \
+  --output=results.jsonl \
+  /path/to/foo.wav /path/to/a/directory [--file-list=/path/to/wav.list]
+
+A directory is searched recursively for *.wav files. --file-list is a text
+file containing one wave file per line.
+
+To decode a few long recordings, e.g., of several hours, pass
+
+  --silero-vad-param=/path/to/silero.ncnn.param \
+  --silero-vad-bin=/path/to/silero.ncnn.bin
+
+Each file is then split into speech segments with VAD. The segments are
+decoded concurrently on independent streams and their results are joined,
+with timestamps relative to the start of the file.
+
+The result of each file is written as one line of JSON to --output, in the
+order the files are finished. A summary with the aggregate real time factor
+(RTF), the number of files per second and percentiles of the per-file
+latency is printed to stderr.
+
+Please refer to
+https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
+for a list of pre-trained models to download.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  auto &model_config = config.model_config;
+
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("num-active-paths", &config.decoder_config.num_active_paths,
+              "Number of active paths for modified_beam_search");
+  po.Register("hotwords-file", &config.hotwords_file,
+              "Path to the hotwords file. Used only for "
+              "modified_beam_search");
+  po.Register("hotwords-score", &config.hotwords_score,
+              "Bonus score of each token in hotwords");
+  po.Register("fast-fbank", &config.feat_config.fast_fbank,
+              "true to compute features with the SIMD fbank backend");
+
+  // All frames of a file are ready at once
+  config.decoder_config.max_chunks_per_decode = 16;
+  po.Register("max-chunks-per-decode",
+              &config.decoder_config.max_chunks_per_decode,
+              "Maximum number of chunks decoded by each call of "
+              "DecodeStream()");
+  po.Register("print-stats", &config.enable_stats,
+              "true to print the latency of each stage of decoding at the "
+              "end");
+
+  int32_t num_workers = 0;
+  int32_t num_threads = 1;
+  std::string file_list;
+  std::string output = "-";
+  std::string trace_file;
+  bool print_layer_profile = false;
+  std::string layer_profile_csv;
+
+  po.Register("num-workers", &num_workers,
+              "Number of files decoded concurrently. If it is not positive, "
+              "it is the number of CPU cores divided by --num-threads");
+  po.Register("num-threads", &num_threads,
+              "Number of threads used by ncnn in each worker");
+  po.Register("file-list", &file_list,
+              "A text file containing one wave file per line");
+  po.Register("output", &output,
+              "Path to the JSONL file for the results. - means stdout");
+  po.Register("trace-file", &trace_file,
+              "If not empty, write a timeline of the decoding in the Chrome "
+              "trace event format to this file. Open it with "
+              "https://ui.perfetto.dev");
+  po.Register("print-layer-profile", &print_layer_profile,
+              "true to print the time spent in each layer type and in the "
+              "slowest layers of the encoder, decoder and joiner at the end");
+  po.Register("layer-profile-csv", &layer_profile_csv,
+              "If not empty, write the time spent in each layer type and in "
+              "each layer of the encoder, decoder and joiner to this CSV file");
+
+  sherpa_ncnn::SileroVadModelConfig vad_config;
+  vad_config.opt.num_threads = 1;
+
+  po.Register("silero-vad-param", &vad_config.param,
+              "Path to silero.ncnn.param. If given, each file is split into "
+              "speech segments that are decoded concurrently");
+  po.Register("silero-vad-bin", &vad_config.bin, "Path to silero.ncnn.bin");
+  po.Register("vad-threshold", &vad_config.threshold,
+              "A window is speech if its probability is larger than it");
+  po.Register("vad-min-silence-duration", &vad_config.min_silence_duration,
+              "In seconds. Segments are split at silences longer than it");
+  po.Register("vad-min-speech-duration", &vad_config.min_speech_duration,
+              "In seconds. Shorter speech is ignored");
+
+  po.Read(argc, argv);
+
+  model_config.profile_layers =
+      print_layer_profile || !layer_profile_csv.empty();
+
+  std::vector<std::string> files;
+  for (int32_t i = 1; i <= po.NumArgs(); ++i) {
+    AddFiles(po.GetArg(i), &files);
+  }
+
+  if (!file_list.empty()) {
+    std::ifstream is(file_list);
+    if (!is) {
+      fprintf(stderr, "Failed to open %s\n", file_list.c_str());
+      exit(EXIT_FAILURE);
+    }
+
+    std::string line;
+    while (std::getline(is, line)) {
+      if (!line.empty()) {
+        files.push_back(line);
+      }
+    }
+  }
+
+  if (files.empty()) {
+    fprintf(stderr, "Error: Please provide at least one wave file.\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  num_threads = std::max(1, num_threads);
+  if (num_workers <= 0) {
+    int32_t num_cores =
+        static_cast<int32_t>(std::thread::hardware_concurrency());
+    num_workers = std::max(1, num_cores / num_threads);
+  }
+
+  bool use_vad = !vad_config.param.empty();
+  if (use_vad && !vad_config.Validate()) {
+    fprintf(stderr, "Errors in VAD config!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (!use_vad) {
+    num_workers = std::min<int32_t>(num_workers, files.size());
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  // Every worker reuses a pooled stream
+  config.max_pooled_streams = std::max(config.max_pooled_streams, num_workers);
+
+  fprintf(stderr, "%s\n", config.ToString().c_str());
+  if (use_vad) {
+    fprintf(stderr, "%s\n", vad_config.ToString().c_str());
+  }
+
+  sherpa_ncnn::Recognizer recognizer(config);
+  if (!recognizer.GetModel()) {
+    fprintf(stderr, "Failed to load the model\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::ofstream ofs;
+  if (output != "-") {
+    ofs.open(output);
+    if (!ofs) {
+      fprintf(stderr, "Failed to open %s\n", output.c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+  std::ostream &os = output == "-" ? std::cout : ofs;
+
+  fprintf(stderr, "Decoding %d files with %d workers, %d threads each\n",
+          static_cast<int32_t>(files.size()), num_workers, num_threads);
+
+  if (!trace_file.empty()) {
+    sherpa_ncnn::StartTracing();
+  }
+
+  std::mutex mutex;
+  std::vector<float> latencies;
+  float total_duration = 0;
+  int32_t num_failed = 0;
+
+  auto begin = Clock::now();
+
+  auto finish = [&](FileResult r) {
+    r.end_time = SecondsSince(begin);
+    r.elapsed = r.end_time - r.start_time;
+
+    std::string line = ToJson(r);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    os << line << "\n" << std::flush;
+    if (!r.ok) {
+      fprintf(stderr, "Failed to read %s\n", r.filename.c_str());
+      ++num_failed;
+      return;
+    }
+
+    latencies.push_back(r.elapsed);
+    total_duration += r.duration;
+  };
+
+  auto finish_split_file = [&](SplitFile *file) {
+    for (int32_t k = 0; k != file->num_segments; ++k) {
+      Append(file->results[k], file->r.segments[k].first, &file->r.result);
+    }
+    finish(std::move(file->r));
+  };
+
+  TaskQueue queue;
+
+  // Used only with VAD. Each worker has its own.
+  std::vector<std::unique_ptr<sherpa_ncnn::VoiceActivityDetector>> vads(
+      num_workers);
+
+  auto decode_file = [&](const std::string &filename, int32_t) {
+    FileResult r;
+    r.filename = filename;
+    r.start_time = SecondsSince(begin);
+
+    int32_t sampling_rate = 0;
+    std::vector<float> samples =
+        sherpa_ncnn::ReadWave(filename, &sampling_rate, &r.ok);
+    if (r.ok) {
+      r.duration = samples.size() / static_cast<float>(sampling_rate);
+      r.result = DecodeSamples(recognizer, sampling_rate, std::move(samples),
+                               num_threads);
+    }
+
+    finish(std::move(r));
+  };
+
+  // Run VAD on the file and push a task for each speech segment as soon
+  // as it is detected, so that other workers start decoding it while VAD
+  // is running on the rest of the file
+  auto split_file = [&](const std::string &filename, int32_t worker) {
+    auto file = std::make_shared<SplitFile>();
+    file->r.filename = filename;
+    file->r.start_time = SecondsSince(begin);
+
+    int32_t sampling_rate = 0;
+    std::vector<float> samples =
+        sherpa_ncnn::ReadWave(filename, &sampling_rate, &file->r.ok);
+    if (!file->r.ok) {
+      finish(std::move(file->r));
+      return;
+    }
+
+    file->r.duration = samples.size() / static_cast<float>(sampling_rate);
+
+    // Silero VAD supports only 16 kHz
+    samples = Resample(samples, sampling_rate, vad_config.sample_rate);
+    sampling_rate = vad_config.sample_rate;
+
+    auto &vad = vads[worker];
+    if (!vad) {
+      vad = std::make_unique<sherpa_ncnn::VoiceActivityDetector>(vad_config);
+    }
+
+    auto push_segments = [&]() {
+      while (!vad->Empty()) {
+        const auto &segment = vad->Front();
+        float start = segment.start / static_cast<float>(sampling_rate);
+        float end = start + segment.samples.size() /
+                                static_cast<float>(sampling_rate);
+        int32_t k;
+        {
+          std::lock_guard<std::mutex> lock(file->mutex);
+          k = file->num_segments++;
+          file->results.emplace_back();
+          file->r.segments.emplace_back(start, end);
+        }
+
+        queue.Push(
+            [&, file, k, sampling_rate,
+             samples = segment.samples](int32_t) mutable {
+              auto result = DecodeSamples(recognizer, sampling_rate,
+                                          std::move(samples), num_threads);
+              bool done;
+              {
+                std::lock_guard<std::mutex> lock(file->mutex);
+                file->results[k] = std::move(result);
+                done = ++file->num_decoded_segments == file->num_segments &&
+                       file->vad_done;
+              }
+
+              if (done) {
+                finish_split_file(file.get());
+              }
+            },
+            true);
+
+        vad->Pop();
+      }
+    };
+
+    int32_t window_size = vad_config.window_size;
+    int32_t num_samples = static_cast<int32_t>(samples.size());
+    int32_t i = 0;
+    for (; i + window_size <= num_samples; i += window_size) {
+      vad->AcceptWaveform(samples.data() + i, window_size);
+      push_segments();
+    }
+
+    if (i < num_samples) {
+      std::vector<float> last(window_size);
+      std::copy(samples.begin() + i, samples.end(), last.begin());
+      vad->AcceptWaveform(last.data(), window_size);
+      push_segments();
+    }
+
+    vad->Flush();
+    push_segments();
+    vad->Reset();
+
+    bool done;
+    {
+      std::lock_guard<std::mutex> lock(file->mutex);
+      file->vad_done = true;
+      done = file->num_decoded_segments == file->num_segments;
+    }
+
+    if (done) {
+      finish_split_file(file.get());
+    }
+  };
+
+  for (const auto &f : files) {
+    if (use_vad) {
+      queue.Push([&split_file, &f](int32_t worker) { split_file(f, worker); });
+    } else {
+      queue.Push(
+          [&decode_file, &f](int32_t worker) { decode_file(f, worker); });
+    }
+  }
+
+  std::vector<std::thread> workers;
+  for (int32_t i = 0; i != num_workers; ++i) {
+    workers.emplace_back([&queue, i]() {
+      sherpa_ncnn::SetTraceThreadName("worker");
+      queue.Run(i);
+    });
+  }
+
+  for (auto &w : workers) {
+    w.join();
+  }
+
+  if (!trace_file.empty() && !sherpa_ncnn::StopTracing(trace_file)) {
+    fprintf(stderr, "Failed to write %s\n", trace_file.c_str());
+  }
+
+  float elapsed_seconds = SecondsSince(begin);
+
+  std::sort(latencies.begin(), latencies.end());
+
+  fprintf(stderr, "Number of files: %d, failed: %d\n",
+          static_cast<int32_t>(files.size()), num_failed);
+  fprintf(stderr, "Audio duration: %.3f s\n", total_duration);
+  fprintf(stderr, "Elapsed seconds: %.3f s\n", elapsed_seconds);
+  fprintf(stderr, "Real time factor (RTF): %.3f / %.3f = %.4f\n",
+          elapsed_seconds, total_duration,
+          total_duration > 0 ? elapsed_seconds / total_duration : 0);
+  fprintf(stderr, "Files per second: %.2f\n", files.size() / elapsed_seconds);
+  fprintf(stderr,
+          "Latency per file (s): p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+          Percentile(latencies, 50), Percentile(latencies, 90),
+          Percentile(latencies, 99), Percentile(latencies, 100));
+
+  if (config.enable_stats) {
+    fprintf(stderr, "%s", recognizer.GetStageStats()->ToString().c_str());
+  }
+
+  const sherpa_ncnn::LayerProfile *layer_profile =
+      recognizer.GetModel()->GetLayerProfile();
+
+  if (!layer_profile_csv.empty() &&
+      !layer_profile->WriteCsv(layer_profile_csv)) {
+    fprintf(stderr, "Failed to write %s\n", layer_profile_csv.c_str());
+  }
+
+  if (print_layer_profile) {
+    fprintf(stderr, "%s", layer_profile->ToString().c_str());
+  }
+
+  return num_failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,535 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-bench.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/version.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+float MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               start)
+             .count() /
+         1e3;
+}
+
+struct Audio {
+  std::string name;
+  std::vector<float> samples;
+  int32_t sampling_rate = 16000;
+
+  float Duration() const {
+    return samples.size() / static_cast<float>(sampling_rate);
+  }
+};
+
+// A deterministic signal that looks a bit like speech to the encoder:
+// voiced syllables of about 200 ms with a varying pitch and their
+// harmonics, separated by short pauses, plus some noise.
+Audio GenerateAudio(float seconds, int32_t sampling_rate) {
+  Audio audio;
+  audio.name = "synthetic";
+  audio.sampling_rate = sampling_rate;
+  audio.samples.resize(static_cast<int32_t>(seconds * sampling_rate));
+
+  std::mt19937 gen(0);
+  std::normal_distribution<float> noise(0, 0.005f);
+  std::uniform_real_distribution<float> pitch(100, 220);
+
+  const float kPi = 3.14159265358979f;
+  int32_t syllable = static_cast<int32_t>(0.25f * sampling_rate);
+  float f0 = pitch(gen);
+  float phase = 0;
+
+  for (int32_t i = 0; i != static_cast<int32_t>(audio.samples.size()); ++i) {
+    int32_t k = i % syllable;
+    if (k == 0) {
+      f0 = pitch(gen);
+    }
+
+    // 200 ms of voice followed by 50 ms of silence
+    float t = k / (0.2f * sampling_rate);
+    float envelope = t < 1 ? std::sin(kPi * t) : 0;
+
+    phase += 2 * kPi * f0 / sampling_rate;
+
+    float s = 0;
+    for (int32_t h = 1; h <= 8; ++h) {
+      s += std::sin(h * phase) / h;
+    }
+
+    audio.samples[i] = 0.1f * envelope * s + noise(gen);
+  }
+
+  return audio;
+}
+
+// Peak resident set size of the process in MB. -1 if it is unknown.
+double PeakRssMb() {
+#if defined(_WIN32)
+  return -1;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+#if defined(__APPLE__)
+  // in bytes
+  return usage.ru_maxrss / 1024.0 / 1024.0;
+#else
+  // in KB
+  return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+struct Summary {
+  int32_t count = 0;
+  float mean = 0;
+  float p50 = 0;
+  float p95 = 0;
+  float p99 = 0;
+  float max = 0;
+};
+
+Summary Summarize(std::vector<float> v) {
+  Summary s;
+  if (v.empty()) {
+    return s;
+  }
+
+  std::sort(v.begin(), v.end());
+
+  auto percentile = [&v](float p) {
+    int32_t i = static_cast<int32_t>(p / 100 * (v.size() - 1) + 0.5f);
+    return v[i];
+  };
+
+  double sum = 0;
+  for (float f : v) {
+    sum += f;
+  }
+
+  s.count = static_cast<int32_t>(v.size());
+  s.mean = sum / v.size();
+  s.p50 = percentile(50);
+  s.p95 = percentile(95);
+  s.p99 = percentile(99);
+  s.max = v.back();
+
+  return s;
+}
+
+std::string ToJson(const Summary &s) {
+  std::ostringstream os;
+  os << "{\"count\": " << s.count << ", \"mean\": " << s.mean
+     << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95
+     << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}";
+  return os.str();
+}
+
+std::string EscapeJson(const std::string &s) {
+  std::ostringstream os;
+  for (char c : s) {
+    switch (c) {
+      case '"':
+        os << "\\\"";
+        break;
+      case '\\':
+        os << "\\\\";
+        break;
+      case '\n':
+        os << "\\n";
+        break;
+      case '\t':
+        os << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          os << buf;
+        } else {
+          os << c;
+        }
+    }
+  }
+  return os.str();
+}
+
+struct Measurements {
+  // In milliseconds. One entry per chunk of audio: the time to accept it
+  // and to decode all ready frames
+  std::vector<float> chunk_latency;
+
+  // In milliseconds. One entry per decoded audio: the time from the start
+  // of the stream until the first token is recognized
+  std::vector<float> first_token;
+
+  // In milliseconds. One entry per decoded audio: the amount of audio
+  // given to the stream when the first token is recognized
+  std::vector<float> first_token_audio;
+
+  // In milliseconds. One entry per decoded audio: the time from the end
+  // of the audio, i.e., adding the tail paddings and InputFinished(), to
+  // the final result
+  std::vector<float> finalize_latency;
+
+  // In seconds. Time spent in the recognizer, i.e., without waiting for
+  // the audio in real-time mode
+  double processing = 0;
+  double audio = 0;
+};
+
+// Decode an audio in chunks of chunk_ms milliseconds the way a streaming
+// application does and return the final text.
+//
+// If real_time is true, each chunk is given to the stream only when it
+// would have been recorded.
+std::string Decode(const sherpa_ncnn::Recognizer &recognizer,
+                   const Audio &audio, int32_t chunk_ms, bool real_time,
+                   Measurements *m) {
+  auto stream = recognizer.CreateStream();
+
+  int32_t n = static_cast<int32_t>(audio.samples.size());
+  int32_t chunk = std::max(1, audio.sampling_rate * chunk_ms / 1000);
+  bool has_token = false;
+
+  auto start = Clock::now();
+  for (int32_t offset = 0; offset < n; offset += chunk) {
+    int32_t k = std::min(chunk, n - offset);
+
+    if (real_time) {
+      std::this_thread::sleep_until(
+          start + std::chrono::microseconds(static_cast<int64_t>(
+                      1e6 * (offset + k) / audio.sampling_rate)));
+    }
+
+    auto chunk_start = Clock::now();
+    stream->AcceptWaveform(audio.sampling_rate, audio.samples.data() + offset,
+                           k);
+    while (recognizer.IsReady(stream.get())) {
+      recognizer.DecodeStream(stream.get());
+    }
+    float latency = MillisecondsSince(chunk_start);
+
+    m->chunk_latency.push_back(latency);
+    m->processing += latency / 1e3;
+
+    if (!has_token && !recognizer.GetResult(stream.get()).tokens.empty()) {
+      has_token = true;
+      m->first_token.push_back(MillisecondsSince(start));
+      m->first_token_audio.push_back(1e3f * (offset + k) /
+                                     audio.sampling_rate);
+    }
+  }
+
+  auto finalize_start = Clock::now();
+
+  std::vector<float> tail_paddings(
+      static_cast<int32_t>(0.3 * audio.sampling_rate));
+  stream->AcceptWaveform(audio.sampling_rate, tail_paddings.data(),
+                         tail_paddings.size());
+  stream->InputFinished();
+
+  while (recognizer.IsReady(stream.get())) {
+    recognizer.DecodeStream(stream.get());
+  }
+  stream->Finalize();
+  auto result = recognizer.GetResult(stream.get());
+
+  float latency = MillisecondsSince(finalize_start);
+  m->finalize_latency.push_back(latency);
+  m->processing += latency / 1e3;
+  m->audio += audio.Duration();
+
+  return result.text;
+}
+
+struct Workload {
+  std::string name;
+  std::string method;
+  bool hotwords = false;
+};
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Benchmark streaming recognition and write the results as JSON, so that
+runs can be compared across commits and hardware.
+
+Usage:
+
+./bin/sherpa-ncnn-bench \
+  --tokens=/path/to/tokens.txt \
+  --encoder-param=/path/to/encoder.ncnn.param \
+  --encoder-bin=/path/to/encoder.ncnn.bin \
+  --decoder-param=/path/to/decoder.ncnn.param \
+  --decoder-bin=/path/to/decoder.ncnn.bin \
+  --joiner-param=/path/to/joiner.ncnn.param \
+  --joiner-bin=/path/to/joiner.ncnn.bin \
+  [--hotwords-file=/path/to/hotwords.txt] \
+  [--output=bench.json] \
+  [/path/to/foo.wav ...]
+
+If no wave file is given, --synthetic-seconds of generated audio is used.
+
+The audio is decoded with greedy_search and modified_beam_search, and also
+with modified_beam_search and hotwords if --hotwords-file is given. Each
+audio is given to a stream in chunks of --chunk-ms milliseconds. The
+following is measured for each of them:
+
+  - rtf: time spent in the recognizer divided by the audio duration
+  - first_token_ms: time from the start of a stream to the first token
+  - first_token_audio_ms: audio given to the stream until the first token
+  - chunk_latency_ms: time to accept a chunk and decode the ready frames
+  - finalize_latency_ms: time from the end of the audio to the final
+    result, including the tail paddings and InputFinished()
+  - peak_rss_mb: peak resident set size of the process so far. The
+    workloads are run one after another, so it never decreases.
+
+Pass --real-time=true to give the chunks to the streams at the rate they
+would be recorded. first_token_ms is then the delay a user would see.
+
+Please refer to
+https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
+for a list of pre-trained models to download.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  auto &model_config = config.model_config;
+
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+
+  po.Register("num-active-paths", &config.decoder_config.num_active_paths,
+              "Number of active paths for modified_beam_search");
+  po.Register("hotwords-file", &config.hotwords_file,
+              "Path to the hotwords file. If given, modified_beam_search "
+              "is also run with it");
+  po.Register("hotwords-score", &config.hotwords_score,
+              "Bonus score of each token in hotwords");
+  po.Register("fast-fbank", &config.feat_config.fast_fbank,
+              "true to compute features with the SIMD fbank backend");
+
+  int32_t num_threads = 1;
+  int32_t chunk_ms = 100;
+  int32_t num_runs = 3;
+  int32_t num_warmup_runs = 1;
+  bool real_time = false;
+  float synthetic_seconds = 20;
+  std::string methods = "greedy_search,modified_beam_search";
+  std::string output = "-";
+
+  po.Register("num-threads", &num_threads,
+              "Number of threads used by ncnn");
+  po.Register("chunk-ms", &chunk_ms,
+              "Duration in milliseconds of the audio given to a stream at "
+              "a time");
+  po.Register("num-runs", &num_runs,
+              "Number of times each audio is decoded for each workload");
+  po.Register("num-warmup-runs", &num_warmup_runs,
+              "Number of times the first audio is decoded before measuring");
+  po.Register("real-time", &real_time,
+              "true to give the chunks to a stream at the rate they would "
+              "be recorded");
+  po.Register("synthetic-seconds", &synthetic_seconds,
+              "Duration of the generated audio used if no wave file is "
+              "given");
+  po.Register("methods", &methods,
+              "Comma separated decoding methods to benchmark");
+  po.Register("output", &output,
+              "Path to the JSON file for the results. - means stdout");
+
+  po.Read(argc, argv);
+
+  num_threads = std::max(1, num_threads);
+  chunk_ms = std::max(1, chunk_ms);
+  num_runs = std::max(1, num_runs);
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  std::vector<Audio> audios;
+  for (int32_t i = 1; i <= po.NumArgs(); ++i) {
+    Audio audio;
+    audio.name = po.GetArg(i);
+
+    bool is_ok = false;
+    audio.samples =
+        sherpa_ncnn::ReadWave(audio.name, &audio.sampling_rate, &is_ok);
+    if (!is_ok) {
+      fprintf(stderr, "Failed to read %s\n", audio.name.c_str());
+      exit(EXIT_FAILURE);
+    }
+
+    audios.push_back(std::move(audio));
+  }
+
+  if (audios.empty()) {
+    if (synthetic_seconds <= 0) {
+      fprintf(stderr, "Error: Please provide a wave file.\n\n");
+      po.PrintUsage();
+      exit(EXIT_FAILURE);
+    }
+
+    audios.push_back(GenerateAudio(synthetic_seconds,
+                                   config.feat_config.sampling_rate));
+  }
+
+  std::vector<Workload> workloads;
+  {
+    std::istringstream is(methods);
+    std::string method;
+    while (std::getline(is, method, ',')) {
+      if (method != "greedy_search" && method != "modified_beam_search") {
+        fprintf(stderr, "Unsupported method: %s\n", method.c_str());
+        exit(EXIT_FAILURE);
+      }
+
+      workloads.push_back({method, method, false});
+
+      // Only modified_beam_search supports hotwords
+      if (method == "modified_beam_search" && !config.hotwords_file.empty()) {
+        workloads.push_back({method + "+hotwords", method, true});
+      }
+    }
+  }
+
+  std::ostringstream os;
+  os << "{\"version\": \"" << sherpa_ncnn::GetVersionStr() << "\"";
+  os << ", \"git_sha1\": \"" << sherpa_ncnn::GetGitSha1() << "\"";
+  os << ", \"git_date\": \"" << sherpa_ncnn::GetGitDate() << "\"";
+  os << ", \"num_cores\": " << std::thread::hardware_concurrency();
+  os << ", \"num_threads\": " << num_threads;
+  os << ", \"chunk_ms\": " << chunk_ms;
+  os << ", \"real_time\": " << (real_time ? "true" : "false");
+  os << ", \"num_runs\": " << num_runs;
+
+  os << ", \"audio\": [";
+  std::string sep;
+  for (const auto &a : audios) {
+    os << sep << "{\"name\": \"" << EscapeJson(a.name)
+       << "\", \"duration_s\": " << a.Duration() << "}";
+    sep = ", ";
+  }
+  os << "]";
+
+  os << ", \"workloads\": [";
+  sep = "";
+  for (const auto &w : workloads) {
+    sherpa_ncnn::RecognizerConfig c = config;
+    c.decoder_config.method = w.method;
+    if (!w.hotwords) {
+      c.hotwords_file.clear();
+    }
+
+    auto load_start = Clock::now();
+    sherpa_ncnn::Recognizer recognizer(c);
+    float load_ms = MillisecondsSince(load_start);
+
+    Measurements m;
+    for (int32_t i = 0; i < num_warmup_runs; ++i) {
+      Decode(recognizer, audios[0], chunk_ms, real_time, &m);
+    }
+    m = Measurements();
+
+    std::vector<std::string> texts(audios.size());
+    for (int32_t r = 0; r != num_runs; ++r) {
+      for (size_t i = 0; i != audios.size(); ++i) {
+        texts[i] = Decode(recognizer, audios[i], chunk_ms, real_time, &m);
+      }
+    }
+
+    double rtf = m.audio > 0 ? m.processing / m.audio : 0;
+    Summary chunk_latency = Summarize(m.chunk_latency);
+    Summary first_token = Summarize(m.first_token);
+    Summary finalize_latency = Summarize(m.finalize_latency);
+    double peak_rss_mb = PeakRssMb();
+
+    fprintf(stderr,
+            "%-28s RTF %.4f, first token %.1f ms, chunk p50/p95/p99 "
+            "%.2f/%.2f/%.2f ms, finalize p50 %.1f ms, peak RSS %.1f MB\n",
+            w.name.c_str(), rtf, first_token.p50, chunk_latency.p50,
+            chunk_latency.p95, chunk_latency.p99, finalize_latency.p50,
+            peak_rss_mb);
+
+    os << sep << "{\"name\": \"" << w.name << "\"";
+    os << ", \"decoding_method\": \"" << w.method << "\"";
+    os << ", \"hotwords\": " << (w.hotwords ? "true" : "false");
+    os << ", \"num_active_paths\": " << c.decoder_config.num_active_paths;
+    os << ", \"load_ms\": " << load_ms;
+    os << ", \"audio_s\": " << m.audio;
+    os << ", \"processing_s\": " << m.processing;
+    os << ", \"rtf\": " << rtf;
+    os << ", \"first_token_ms\": " << ToJson(first_token);
+    os << ", \"first_token_audio_ms\": "
+       << ToJson(Summarize(m.first_token_audio));
+    os << ", \"chunk_latency_ms\": " << ToJson(chunk_latency);
+    os << ", \"finalize_latency_ms\": " << ToJson(finalize_latency);
+    os << ", \"peak_rss_mb\": " << peak_rss_mb;
+
+    os << ", \"texts\": [";
+    std::string text_sep;
+    for (const auto &t : texts) {
+      os << text_sep << "\"" << EscapeJson(t) << "\"";
+      text_sep = ", ";
+    }
+    os << "]}";
+
+    sep = ", ";
+  }
+  os << "]}\n";
+
+  if (output == "-") {
+    std::cout << os.str() << std::flush;
+  } else {
+    std::ofstream of(output);
+    if (!of) {
+      fprintf(stderr, "Failed to open %s\n", output.c_str());
+      exit(EXIT_FAILURE);
+    }
+    of << os.str();
+  }
+
+  return 0;
+}
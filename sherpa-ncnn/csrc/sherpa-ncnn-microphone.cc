@@ -21,6 +21,7 @@
 #include <stdlib.h>
 
 #include <cctype>  // std::tolower
+#include <string>
 
 #include "portaudio.h"  // NOLINT
 #include "sherpa-ncnn/csrc/display.h"
@@ -49,6 +50,21 @@ static void Handler(int32_t sig) {
 };
 
 int32_t main(int32_t argc, char *argv[]) {
+  // --print-stats can be given at any position. It is removed from argv
+  // before the positional arguments are parsed.
+  bool print_stats = false;
+  {
+    int32_t n = 1;
+    for (int32_t i = 1; i != argc; ++i) {
+      if (std::string(argv[i]) == "--print-stats") {
+        print_stats = true;
+      } else {
+        argv[n++] = argv[i];
+      }
+    }
+    argc = n;
+  }
+
   if (argc < 8 || argc > 10) {
     const char *usage = R"usage(
 Usage:
@@ -65,6 +81,9 @@ Usage:
 Please refer to
 https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
 for a list of pre-trained models to download.
+
+Pass --print-stats to print the latency of each stage of decoding after
+Ctrl + C.
 )usage";
     fprintf(stderr, "%s\n", usage);
     fprintf(stderr, "argc, %d\n", argc);
@@ -114,6 +133,8 @@ for a list of pre-trained models to download.
   config.feat_config.sampling_rate = expected_sampling_rate;
   config.feat_config.feature_dim = 80;
 
+  config.enable_stats = print_stats;
+
   fprintf(stderr, "%s\n", config.ToString().c_str());
 
   sherpa_ncnn::Recognizer recognizer(config);
@@ -206,5 +227,9 @@ for a list of pre-trained models to download.
     exit(EXIT_FAILURE);
   }
 
+  if (print_stats) {
+    fprintf(stderr, "%s", recognizer.GetStageStats()->ToString().c_str());
+  }
+
   return 0;
 }
@@ -4,9 +4,11 @@
 
 #include <chrono>  // NOLINT
 #include <fstream>
+#include <string>
 
 #include "sherpa-ncnn/csrc/offline-tts.h"
 #include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/trace.h"
 #include "sherpa-ncnn/csrc/wave-writer.h"
 
 static int32_t AudioCallback(const float * /*samples*/, int32_t num_samples,
@@ -43,11 +45,17 @@ or details.
 
   sherpa_ncnn::ParseOptions po(kUsageMessage);
   std::string output_filename = "./generated.wav";
+  std::string trace_file;
   int32_t sid = 0;
 
   po.Register("output-filename", &output_filename,
               "Path to save the generated audio");
 
+  po.Register("trace-file", &trace_file,
+              "If not empty, write a timeline of the TTS stages in the "
+              "Chrome trace event format to this file. Open it with "
+              "https://ui.perfetto.dev");
+
   po.Register("sid", &sid,
               "Speaker ID. Used only for multi-speaker models, e.g., models "
               "trained using the VCTK dataset. Not used for single-speaker "
@@ -83,6 +91,10 @@ or details.
 
   sherpa_ncnn::OfflineTts tts(config);
 
+  if (!trace_file.empty()) {
+    sherpa_ncnn::StartTracing();
+  }
+
   const auto begin = std::chrono::steady_clock::now();
   sherpa_ncnn::TtsArgs args;
   args.text = po.GetArg(1);
@@ -91,6 +103,10 @@ or details.
   auto audio = tts.Generate(args, AudioCallback);
   const auto end = std::chrono::steady_clock::now();
 
+  if (!trace_file.empty() && !sherpa_ncnn::StopTracing(trace_file)) {
+    fprintf(stderr, "Failed to write %s\n", trace_file.c_str());
+  }
+
   if (audio.samples.empty()) {
     fprintf(
         stderr,
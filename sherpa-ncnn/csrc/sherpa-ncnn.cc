@@ -23,12 +23,40 @@
 #include <chrono>  // NOLINT
 #include <fstream>
 #include <iostream>
+#include <string>
 
 #include "net.h"  // NOLINT
 #include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/trace.h"
 #include "sherpa-ncnn/csrc/wave-reader.h"
 
 int32_t main(int32_t argc, char *argv[]) {
+  // --print-stats, --trace-file, --print-layer-profile and
+  // --layer-profile-csv can be given at any position. They are removed from
+  // argv before the positional arguments are parsed.
+  bool print_stats = false;
+  std::string trace_file;
+  bool print_layer_profile = false;
+  std::string layer_profile_csv;
+  {
+    int32_t n = 1;
+    for (int32_t i = 1; i != argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "--print-stats") {
+        print_stats = true;
+      } else if (arg.rfind("--trace-file=", 0) == 0) {
+        trace_file = arg.substr(13);
+      } else if (arg == "--print-layer-profile") {
+        print_layer_profile = true;
+      } else if (arg.rfind("--layer-profile-csv=", 0) == 0) {
+        layer_profile_csv = arg.substr(20);
+      } else {
+        argv[n++] = argv[i];
+      }
+    }
+    argc = n;
+  }
+
   if (argc < 9 || argc > 13) {
     const char *usage = R"usage(
 Usage:
@@ -45,6 +73,16 @@ Usage:
 Please refer to
 https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
 for a list of pre-trained models to download.
+
+Pass --print-stats to print the latency of each stage of decoding at the
+end.
+
+Pass --trace-file=/path/to/trace.json to write a timeline of the decoding
+in the Chrome trace event format. Open it with https://ui.perfetto.dev
+
+Pass --print-layer-profile to print the time spent in each layer type and
+in the slowest layers of the encoder, decoder and joiner at the end, and
+--layer-profile-csv=/path/to/profile.csv to write it as CSV.
 )usage";
     std::cerr << usage << "\n";
 
@@ -85,6 +123,14 @@ for a list of pre-trained models to download.
   config.feat_config.sampling_rate = expected_sampling_rate;
   config.feat_config.feature_dim = 80;
 
+  // All frames of the file are ready at once, so decode several chunks
+  // with each call of DecodeStream()
+  config.decoder_config.max_chunks_per_decode = 16;
+
+  config.enable_stats = print_stats;
+  config.model_config.profile_layers =
+      print_layer_profile || !layer_profile_csv.empty();
+
   std::cout << config.ToString() << "\n";
 
   sherpa_ncnn::Recognizer recognizer(config);
@@ -103,15 +149,21 @@ for a list of pre-trained models to download.
   std::cout << "wav filename: " << wav_filename << "\n";
   std::cout << "wav duration (s): " << duration << "\n";
 
+  if (!trace_file.empty()) {
+    sherpa_ncnn::StartTracing();
+  }
+
   auto begin = std::chrono::steady_clock::now();
   std::cout << "Started!\n";
   auto stream = recognizer.CreateStream();
-  stream->AcceptWaveform(expected_sampling_rate, samples.data(),
-                         samples.size());
-  std::vector<float> tail_paddings(
-      static_cast<int>(0.3 * expected_sampling_rate));
-  stream->AcceptWaveform(expected_sampling_rate, tail_paddings.data(),
-                         tail_paddings.size());
+
+  // Tail paddings
+  samples.resize(samples.size() +
+                 static_cast<int>(0.3 * expected_sampling_rate));
+
+  // The whole file is available, so compute its features in parallel
+  stream->AcceptWaveformOffline(expected_sampling_rate, samples.data(),
+                                samples.size(), num_threads);
   while (recognizer.IsReady(stream.get())) {
     recognizer.DecodeStream(stream.get());
   }
@@ -119,6 +171,10 @@ for a list of pre-trained models to download.
   auto result = recognizer.GetResult(stream.get());
   std::cout << "Done!\n";
 
+  if (!trace_file.empty() && !sherpa_ncnn::StopTracing(trace_file)) {
+    fprintf(stderr, "Failed to write %s\n", trace_file.c_str());
+  }
+
   std::cout << "Recognition result for " << wav_filename << "\n"
             << result.ToString();
 
@@ -133,5 +189,21 @@ for a list of pre-trained models to download.
   fprintf(stderr, "Real time factor (RTF): %.3f / %.3f = %.3f\n",
           elapsed_seconds, duration, rtf);
 
+  if (print_stats) {
+    fprintf(stderr, "%s", recognizer.GetStageStats()->ToString().c_str());
+  }
+
+  const sherpa_ncnn::LayerProfile *layer_profile =
+      recognizer.GetModel()->GetLayerProfile();
+
+  if (print_layer_profile) {
+    fprintf(stderr, "%s", layer_profile->ToString().c_str());
+  }
+
+  if (!layer_profile_csv.empty() &&
+      !layer_profile->WriteCsv(layer_profile_csv)) {
+    fprintf(stderr, "Failed to write %s\n", layer_profile_csv.c_str());
+  }
+
   return 0;
 }
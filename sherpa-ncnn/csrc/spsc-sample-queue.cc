@@ -0,0 +1,69 @@
+// sherpa-ncnn/csrc/spsc-sample-queue.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/spsc-sample-queue.h"
+
+#include <algorithm>
+
+namespace sherpa_ncnn {
+
+SpscSampleQueue::SpscSampleQueue(int32_t capacity)
+    : buffer_(std::max(1, capacity)) {}
+
+int32_t SpscSampleQueue::Push(const float *samples, int32_t n) {
+  int64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+  // acquire: the consumer has finished reading the samples before read_pos
+  int64_t read_pos = read_pos_.load(std::memory_order_acquire);
+
+  int32_t capacity = Capacity();
+  int32_t num_free = capacity - static_cast<int32_t>(write_pos - read_pos);
+  n = std::min(n, num_free);
+  if (n <= 0) {
+    return 0;
+  }
+
+  int32_t start = static_cast<int32_t>(write_pos % capacity);
+  int32_t first = std::min(n, capacity - start);
+  std::copy(samples, samples + first, buffer_.begin() + start);
+  std::copy(samples + first, samples + n, buffer_.begin());
+
+  // release: the samples are visible to the consumer before write_pos
+  write_pos_.store(write_pos + n, std::memory_order_release);
+
+  return n;
+}
+
+int32_t SpscSampleQueue::Pop(float *samples, int32_t n) {
+  int64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+  int64_t write_pos = write_pos_.load(std::memory_order_acquire);
+
+  n = std::min(n, static_cast<int32_t>(write_pos - read_pos));
+  if (n <= 0) {
+    return 0;
+  }
+
+  int32_t capacity = Capacity();
+  int32_t start = static_cast<int32_t>(read_pos % capacity);
+  int32_t first = std::min(n, capacity - start);
+  std::copy(buffer_.begin() + start, buffer_.begin() + start + first,
+            samples);
+  std::copy(buffer_.begin(), buffer_.begin() + (n - first), samples + first);
+
+  read_pos_.store(read_pos + n, std::memory_order_release);
+
+  return n;
+}
+
+int32_t SpscSampleQueue::Size() const {
+  int64_t read_pos = read_pos_.load(std::memory_order_acquire);
+  int64_t write_pos = write_pos_.load(std::memory_order_acquire);
+  return static_cast<int32_t>(write_pos - read_pos);
+}
+
+void SpscSampleQueue::Clear() {
+  write_pos_.store(0);
+  read_pos_.store(0);
+}
+
+}  // namespace sherpa_ncnn
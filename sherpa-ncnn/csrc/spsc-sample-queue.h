@@ -0,0 +1,65 @@
+// sherpa-ncnn/csrc/spsc-sample-queue.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_SPSC_SAMPLE_QUEUE_H_
+#define SHERPA_NCNN_CSRC_SPSC_SAMPLE_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+/**
+ * A lock-free bounded queue of audio samples for exactly one producer
+ * thread and one consumer thread.
+ *
+ * Neither Push() nor Pop() ever blocks or allocates memory, so Push()
+ * can be called from an audio callback.
+ */
+class SpscSampleQueue {
+ public:
+  // @param capacity Maximum number of samples in the queue
+  explicit SpscSampleQueue(int32_t capacity);
+
+  SpscSampleQueue(const SpscSampleQueue &) = delete;
+  SpscSampleQueue &operator=(const SpscSampleQueue &) = delete;
+
+  // Called by the producer. Append up to n samples and return the number
+  // of samples appended. It is less than n if the queue is full.
+  int32_t Push(const float *samples, int32_t n);
+
+  // Called by the consumer. Remove up to n samples from the front of the
+  // queue and return the number of samples removed.
+  int32_t Pop(float *samples, int32_t n);
+
+  // Number of samples in the queue. It is exact only when called by the
+  // consumer with no concurrent Push(), or by the producer with no
+  // concurrent Pop().
+  int32_t Size() const;
+
+  int32_t Capacity() const { return static_cast<int32_t>(buffer_.size()); }
+
+  // Remove all samples. Neither the producer nor the consumer may access
+  // the queue concurrently.
+  void Clear();
+
+ private:
+  std::vector<float> buffer_;
+
+  // Both are positions in the infinite stream of samples; the index into
+  // buffer_ is the position modulo Capacity(). They are on separate cache
+  // lines so that the two threads do not invalidate each other's cache line
+  // on every update.
+
+  // Position of the next sample to write. Written only by the producer.
+  alignas(64) std::atomic<int64_t> write_pos_{0};
+
+  // Position of the next sample to read. Written only by the consumer.
+  alignas(64) std::atomic<int64_t> read_pos_{0};
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_SPSC_SAMPLE_QUEUE_H_
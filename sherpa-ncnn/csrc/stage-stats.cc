@@ -0,0 +1,183 @@
+// sherpa-ncnn/csrc/stage-stats.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/stage-stats.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "sherpa-ncnn/csrc/trace.h"
+
+namespace sherpa_ncnn {
+
+// Sum of the time recorded by the timers of the calling thread. A timer
+// subtracts from its own time what has been added to it in between.
+static thread_local int64_t t_timed_ns = 0;
+
+const char *StageName(Stage stage) {
+  switch (stage) {
+    case Stage::kGetFrames:
+      return "get_frames";
+    case Stage::kEncoder:
+      return "encoder";
+    case Stage::kDecoder:
+      return "decoder";
+    case Stage::kJoiner:
+      return "joiner";
+    case Stage::kLogSoftmaxTopk:
+      return "log_softmax_topk";
+    case Stage::kSearch:
+      return "search";
+    default:
+      return "unknown";
+  }
+}
+
+int32_t StageStats::BucketIndex(int64_t nanoseconds) {
+  if (nanoseconds < 4) {
+    return static_cast<int32_t>(std::max<int64_t>(nanoseconds, 0));
+  }
+
+  int32_t b = 0;  // floor(log2(nanoseconds))
+  for (uint64_t v = nanoseconds; v > 1; v >>= 1) {
+    ++b;
+  }
+
+  int32_t index =
+      4 * (b - 1) + static_cast<int32_t>((nanoseconds >> (b - 2)) & 3);
+  return std::min(index, kNumBuckets - 1);
+}
+
+double StageStats::BucketValue(int32_t index) {
+  if (index < 4) {
+    return index;
+  }
+
+  int32_t b = index / 4 + 1;
+  int32_t sub = index % 4;
+  double width = static_cast<double>(int64_t(1) << (b - 2));
+  return (4 + sub) * width + width / 2;
+}
+
+void StageStats::Record(Stage stage, int64_t nanoseconds) {
+  Histogram &h = histograms_[static_cast<int32_t>(stage)];
+  h.total_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+  h.buckets[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+
+  int64_t max_ns = h.max_ns.load(std::memory_order_relaxed);
+  while (nanoseconds > max_ns &&
+         !h.max_ns.compare_exchange_weak(max_ns, nanoseconds,
+                                         std::memory_order_relaxed)) {
+  }
+}
+
+std::vector<StageSummary> StageStats::GetSummary() const {
+  std::vector<StageSummary> ans;
+  ans.reserve(histograms_.size());
+
+  for (int32_t i = 0; i != static_cast<int32_t>(histograms_.size()); ++i) {
+    const Histogram &h = histograms_[i];
+
+    StageSummary s;
+    s.stage = static_cast<Stage>(i);
+    s.name = StageName(s.stage);
+
+    std::array<int64_t, kNumBuckets> buckets;
+    int64_t count = 0;
+    for (int32_t k = 0; k != kNumBuckets; ++k) {
+      buckets[k] = h.buckets[k].load(std::memory_order_relaxed);
+      count += buckets[k];
+    }
+
+    s.count = count;
+    s.total_ms = h.total_ns.load(std::memory_order_relaxed) / 1e6;
+    s.max_ms = h.max_ns.load(std::memory_order_relaxed) / 1e6;
+
+    if (count > 0) {
+      s.mean_ms = s.total_ms / count;
+
+      double *percentiles[] = {&s.p50_ms, &s.p90_ms, &s.p99_ms};
+      double fractions[] = {0.5, 0.9, 0.99};
+      for (int32_t p = 0; p != 3; ++p) {
+        // The rank of the percentile, starting from 1
+        int64_t rank = std::max<int64_t>(
+            1, static_cast<int64_t>(fractions[p] * count + 0.5));
+        int64_t seen = 0;
+        int32_t k = 0;
+        for (; k != kNumBuckets - 1; ++k) {
+          seen += buckets[k];
+          if (seen >= rank) {
+            break;
+          }
+        }
+        *percentiles[p] = std::min(BucketValue(k) / 1e6, s.max_ms);
+      }
+    }
+
+    ans.push_back(s);
+  }
+
+  return ans;
+}
+
+std::string StageStats::ToString() const {
+  std::vector<StageSummary> summary = GetSummary();
+
+  double total_ms = 0;
+  for (const auto &s : summary) {
+    total_ms += s.total_ms;
+  }
+
+  std::ostringstream os;
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-18s %10s %11s %6s %9s %9s %9s %9s %9s\n",
+           "stage", "count", "total(ms)", "share", "mean(ms)", "p50(ms)",
+           "p90(ms)", "p99(ms)", "max(ms)");
+  os << buf;
+
+  for (const auto &s : summary) {
+    double share = total_ms > 0 ? 100 * s.total_ms / total_ms : 0;
+    snprintf(buf, sizeof(buf),
+             "%-18s %10lld %11.3f %5.1f%% %9.4f %9.4f %9.4f %9.4f %9.4f\n",
+             s.name, static_cast<long long>(s.count), s.total_ms,  // NOLINT
+             share, s.mean_ms, s.p50_ms, s.p90_ms, s.p99_ms, s.max_ms);
+    os << buf;
+  }
+
+  return os.str();
+}
+
+void StageStats::Reset() {
+  for (auto &h : histograms_) {
+    h.total_ns.store(0, std::memory_order_relaxed);
+    h.max_ns.store(0, std::memory_order_relaxed);
+    for (auto &b : h.buckets) {
+      b.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void ScopedStageTimer::Start() {
+  timed_ns_ = t_timed_ns;
+  start_ns_ = TraceNowNs();
+}
+
+void ScopedStageTimer::Stop() {
+  int64_t stop_ns = TraceNowNs();
+  int64_t elapsed = stop_ns - start_ns_;
+  int64_t nested = t_timed_ns - timed_ns_;
+
+  if (stats_) {
+    stats_->Record(stage_, std::max<int64_t>(elapsed - nested, 0));
+  }
+
+  // For the enclosing timer, all of this scope is nested
+  t_timed_ns = timed_ns_ + elapsed;
+
+  AddTraceSpan(StageName(stage_), "asr", start_ns_, stop_ns);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,128 @@
+// sherpa-ncnn/csrc/stage-stats.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_STAGE_STATS_H_
+#define SHERPA_NCNN_CSRC_STAGE_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/trace.h"
+
+namespace sherpa_ncnn {
+
+// Stages of Recognizer::DecodeStream()
+enum class Stage : int32_t {
+  // Copy the features of a chunk out of the feature extractor
+  kGetFrames = 0,
+  kEncoder,
+  // Including lookups in the decoder output cache
+  kDecoder,
+  // Including the encoder projection of the joiner
+  kJoiner,
+  // LogSoftmaxTopk() of modified_beam_search
+  kLogSoftmaxTopk,
+  // Everything else in the search, i.e., the bookkeeping of the
+  // hypotheses and of the results
+  kSearch,
+  kNumStages,
+};
+
+const char *StageName(Stage stage);
+
+struct StageSummary {
+  Stage stage;
+  const char *name;
+
+  // Number of times the stage was run
+  int64_t count = 0;
+
+  // Latencies in milliseconds. The percentiles are estimated from a
+  // histogram with 4 buckets per power of 2, so they are within 12.5%
+  // of the exact values.
+  double total_ms = 0;
+  double mean_ms = 0;
+  double p50_ms = 0;
+  double p90_ms = 0;
+  double p99_ms = 0;
+  double max_ms = 0;
+};
+
+// Latency histograms of the stages of a Recognizer.
+//
+// The time recorded for a stage excludes the time of the stages timed
+// inside it on the same thread, e.g., kSearch does not include kJoiner.
+// So the stages add up to the total decoding time.
+//
+// Record() is lock-free and can be called from several threads.
+class StageStats {
+ public:
+  void Record(Stage stage, int64_t nanoseconds);
+
+  std::vector<StageSummary> GetSummary() const;
+
+  // Return a table of GetSummary()
+  std::string ToString() const;
+
+  // It is not atomic with respect to concurrent calls of Record()
+  void Reset();
+
+ private:
+  // Bucket i < 4 holds the value i. For larger values, there are
+  // 4 buckets per power of 2. Values of 2^40 ns (about 18 minutes) or
+  // more go to the last bucket.
+  static constexpr int32_t kNumBuckets = 160;
+
+  struct Histogram {
+    std::atomic<int64_t> total_ns{0};
+    std::atomic<int64_t> max_ns{0};
+    std::array<std::atomic<int64_t>, kNumBuckets> buckets{};
+  };
+
+  static int32_t BucketIndex(int64_t nanoseconds);
+
+  // Midpoint of the range of values of a bucket
+  static double BucketValue(int32_t index);
+
+  std::array<Histogram, static_cast<int32_t>(Stage::kNumStages)> histograms_;
+};
+
+// Record the time spent in a scope to a stage, and as a span of the trace
+// if IsTracing() is true. It does nothing if stats is nullptr and tracing
+// is off.
+class ScopedStageTimer {
+ public:
+  ScopedStageTimer(StageStats *stats, Stage stage)
+      : stats_(stats), stage_(stage) {
+    if (stats_ || IsTracing()) {
+      Start();
+    }
+  }
+
+  ~ScopedStageTimer() {
+    if (start_ns_) {
+      Stop();
+    }
+  }
+
+  ScopedStageTimer(const ScopedStageTimer &) = delete;
+  ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+ private:
+  void Start();
+  void Stop();
+
+  StageStats *stats_;
+  Stage stage_;
+  int64_t start_ns_ = 0;
+  // Time of the timers of this thread when Start() was called
+  int64_t timed_ns_ = 0;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_STAGE_STATS_H_
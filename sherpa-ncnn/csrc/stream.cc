@@ -21,18 +21,36 @@
 #include <iostream>
 #include <utility>
 
+#include "sherpa-ncnn/csrc/search-pipeline.h"
+
 namespace sherpa_ncnn {
 
+// Rebase the frame indexes of the feature extractor once this many frames,
+// i.e., about 3 hours, have been released
+static constexpr int32_t kRebaseFrameIndex = 1 << 20;
+
+static int64_t NumBytes(const ncnn::Mat &m) {
+  return static_cast<int64_t>(m.total()) * m.elemsize;
+}
+
 class Stream::Impl {
  public:
   explicit Impl(const FeatureExtractorConfig &config,
                 ContextGraphPtr context_graph)
       : feat_extractor_(config), context_graph_(context_graph) {}
 
+  ~Impl() { WaitForSearch(); }
+
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
     feat_extractor_.AcceptWaveform(sampling_rate, waveform, n);
   }
 
+  void AcceptWaveformOffline(int32_t sampling_rate, const float *waveform,
+                             int32_t n, int32_t num_threads) {
+    feat_extractor_.AcceptWaveformOffline(sampling_rate, waveform, n,
+                                          num_threads);
+  }
+
   void InputFinished() { feat_extractor_.InputFinished(); }
 
   int32_t NumFramesReady() const {
@@ -52,7 +70,51 @@ class Stream::Impl {
     num_processed_frames_ = 0;
   }
 
+  void ReleaseProcessedFrames() {
+    int32_t frame_index = start_frame_index_ + num_processed_frames_;
+    feat_extractor_.ReleaseFrames(frame_index);
+
+    if (frame_index >= kRebaseFrameIndex) {
+      start_frame_index_ -= feat_extractor_.Rebase();
+    }
+  }
+
+  StreamMemoryUsage GetMemoryUsage() const {
+    WaitForSearch();
+
+    StreamMemoryUsage ans;
+    ans.feature_bytes = feat_extractor_.NumBytes();
+
+    for (const auto &s : states_) {
+      ans.state_bytes += NumBytes(s);
+    }
+
+    ans.result_bytes =
+        (result_.tokens.capacity() + result_.timestamps.capacity()) *
+            sizeof(int32_t) +
+        NumBytes(result_.decoder_out);
+
+    for (const auto &p : result_.hyps) {
+      ans.result_bytes += sizeof(p.second) +
+                          p.second.NumTokens() * sizeof(HypothesisNode);
+    }
+
+    return ans;
+  }
+
+  void Reinitialize() {
+    WaitForSearch();
+
+    feat_extractor_.Reset();
+    num_processed_frames_ = 0;
+    start_frame_index_ = 0;
+    result_ = {};
+    states_.clear();
+  }
+
   void Finalize() {
+    WaitForSearch();
+
     if (!context_graph_) return;
     auto &cur = result_.hyps;
     for (auto iter = cur.begin(); iter != cur.end(); ++iter) {
@@ -61,7 +123,7 @@ class Stream::Impl {
       iter->second.context_state = context_res.second;
     }
     auto hyp = result_.hyps.GetMostProbable(true);
-    result_.tokens = std::move(hyp.ys);
+    result_.tokens = hyp.Ys();
   }
 
   int32_t &GetNumProcessedFrames() { return num_processed_frames_; }
@@ -80,7 +142,28 @@ class Stream::Impl {
 
   const ContextGraphPtr &GetContextGraph() const { return context_graph_; }
 
+  ExecutionContext *GetExecutionContext() { return &execution_context_; }
+
+  SearchPipeline *GetSearchPipeline() { return search_pipeline_.get(); }
+
+  void SetSearchPipeline(std::unique_ptr<SearchPipeline> pipeline) {
+    WaitForSearch();
+    search_pipeline_ = std::move(pipeline);
+  }
+
  private:
+  void WaitForSearch() const {
+    if (search_pipeline_) {
+      search_pipeline_->Wait();
+    }
+  }
+
+ private:
+  // They are declared first so that they are destroyed after the states and
+  // results, which may hold memory allocated from them. The destructor
+  // waits for the search thread, which uses the other members.
+  std::unique_ptr<SearchPipeline> search_pipeline_;
+  ExecutionContext execution_context_;
   FeatureExtractor feat_extractor_;
   ContextGraphPtr context_graph_;
   int32_t num_processed_frames_ = 0;  // before subsampling
@@ -100,6 +183,12 @@ void Stream::AcceptWaveform(int32_t sampling_rate, const float *waveform,
   impl_->AcceptWaveform(sampling_rate, waveform, n);
 }
 
+void Stream::AcceptWaveformOffline(int32_t sampling_rate,
+                                   const float *waveform, int32_t n,
+                                   int32_t num_threads) {
+  impl_->AcceptWaveformOffline(sampling_rate, waveform, n, num_threads);
+}
+
 void Stream::InputFinished() { impl_->InputFinished(); }
 
 int32_t Stream::NumFramesReady() const { return impl_->NumFramesReady(); }
@@ -114,6 +203,14 @@ ncnn::Mat Stream::GetFrames(int32_t frame_index, int32_t n) const {
 
 void Stream::Reset() { impl_->Reset(); }
 
+void Stream::ReleaseProcessedFrames() { impl_->ReleaseProcessedFrames(); }
+
+StreamMemoryUsage Stream::GetMemoryUsage() const {
+  return impl_->GetMemoryUsage();
+}
+
+void Stream::Reinitialize() { impl_->Reinitialize(); }
+
 void Stream::Finalize() { impl_->Finalize(); }
 
 int32_t &Stream::GetNumProcessedFrames() {
@@ -133,4 +230,17 @@ std::vector<ncnn::Mat> &Stream::GetStates() { return impl_->GetStates(); }
 const ContextGraphPtr &Stream::GetContextGraph() const {
   return impl_->GetContextGraph();
 }
+
+ExecutionContext *Stream::GetExecutionContext() {
+  return impl_->GetExecutionContext();
+}
+
+SearchPipeline *Stream::GetSearchPipeline() {
+  return impl_->GetSearchPipeline();
+}
+
+void Stream::SetSearchPipeline(std::unique_ptr<SearchPipeline> pipeline) {
+  impl_->SetSearchPipeline(std::move(pipeline));
+}
+
 }  // namespace sherpa_ncnn
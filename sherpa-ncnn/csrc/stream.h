@@ -24,9 +24,27 @@
 
 #include "sherpa-ncnn/csrc/context-graph.h"
 #include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/execution-context.h"
 #include "sherpa-ncnn/csrc/features.h"
 
 namespace sherpa_ncnn {
+
+class SearchPipeline;
+
+struct StreamMemoryUsage {
+  // Feature frames and audio samples that are not released yet
+  int64_t feature_bytes = 0;
+
+  // Encoder states
+  int64_t state_bytes = 0;
+
+  // Decoding results. Tokens shared by hypotheses of modified beam search
+  // are counted once per hypothesis, so it is an upper bound.
+  int64_t result_bytes = 0;
+
+  int64_t Total() const { return feature_bytes + state_bytes + result_bytes; }
+};
+
 class Stream {
  public:
   explicit Stream(const FeatureExtractorConfig &config = {},
@@ -44,6 +62,16 @@ class Stream {
    */
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n);
 
+  /**
+   * Accept the whole waveform of the stream and finish the input. See
+   * FeatureExtractor::AcceptWaveformOffline(). It must be called before
+   * anything else is done with the stream.
+   *
+   * @param num_threads Maximum number of threads for computing the features
+   */
+  void AcceptWaveformOffline(int32_t sampling_rate, const float *waveform,
+                             int32_t n, int32_t num_threads = 1);
+
   /**
    * InputFinished() tells the class you won't be providing any
    * more waveform.  This will help flush out the last frame or two
@@ -65,11 +93,39 @@ class Stream {
    * @param n  Number of frames to get.
    * @return Return a 2-D tensor of shape (n, feature_dim).
    *         which is flattened into a 1-D vector (flattened in in row major)
+   *         It is not a copy. Its content is valid until the frames are
+   *         released, e.g., by ReleaseProcessedFrames().
    */
   ncnn::Mat GetFrames(int32_t frame_index, int32_t n) const;
 
   void Reset();
 
+  /**
+   * Release the feature frames and audio samples before the next frame to
+   * be decoded, i.e., GetNumProcessedFrames(). Frames before it cannot be
+   * accessed afterwards. It also renumbers the frames internally once
+   * in a while so that frame indexes do not overflow for streams that run
+   * for days.
+   *
+   * Recognizer calls it after decoding a chunk and in Recognizer::Reset(),
+   * so memory usage stays bounded for long-running streams.
+   */
+  void ReleaseProcessedFrames();
+
+  // Return the memory used by this stream. The memory pools of
+  // GetExecutionContext() are not included.
+  StreamMemoryUsage GetMemoryUsage() const;
+
+  /**
+   * Discard all audio samples, features, decoding results and encoder
+   * states so that the stream can be used for a new utterance. Unlike
+   * Reset(), which is called at an endpoint, nothing is kept except the
+   * context graph and the memory pools of GetExecutionContext().
+   *
+   * The caller has to invoke SetResult() and SetStates() afterwards.
+   */
+  void Reinitialize();
+
   /**
    * Finalize the decoding result. This is mainly for decoding with hotwords
    * (i.e. providing context_graph). It will cancel the boosting score of the
@@ -98,6 +154,21 @@ class Stream {
    */
   const ContextGraphPtr &GetContextGraph() const;
 
+  // Return the memory pools used when decoding this stream.
+  ExecutionContext *GetExecutionContext();
+
+  /**
+   * Return the search stage of this stream in pipeline mode, or nullptr if
+   * it has not been set. See DecoderConfig::pipeline.
+   *
+   * If it is set, Finalize(), Reinitialize(), GetMemoryUsage() and the
+   * destructor wait for the pending searches. GetResult() does not wait;
+   * use Recognizer::GetResult() instead.
+   */
+  SearchPipeline *GetSearchPipeline();
+
+  void SetSearchPipeline(std::unique_ptr<SearchPipeline> pipeline);
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
@@ -0,0 +1,217 @@
+// sherpa-ncnn/csrc/test-batched-search.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Check that decoding a batch of streams with
+// Decoder::Decode(encoder_out, ss, n) gives the same results as decoding
+// each stream on its own, for greedy search with and without batch_frames
+// and for modified beam search.
+//
+// A synthetic model with a smooth decoder and joiner is used, so that
+// streams emit different tokens at different frames.
+//
+// Usage:
+//
+//  ./bin/test-batched-search
+
+#include <stdio.h>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/greedy-search-decoder.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/modified-beam-search-decoder.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace {
+
+class SyntheticModel : public sherpa_ncnn::Model {
+ public:
+  static constexpr int32_t kEncoderDim = 6;
+  static constexpr int32_t kDecoderDim = 5;
+  static constexpr int32_t kVocabSize = 12;
+
+  ncnn::Net &GetEncoder() override { return net_; }
+  ncnn::Net &GetDecoder() override { return net_; }
+  ncnn::Net &GetJoiner() override { return net_; }
+
+  std::vector<ncnn::Mat> GetEncoderInitStates() const override { return {}; }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states) override {
+    return {features, states};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
+      ncnn::Extractor * /*extractor*/) override {
+    return RunEncoder(features, states);
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override {
+    const int32_t *p = decoder_input;
+    ncnn::Mat decoder_out(kDecoderDim);
+    for (int32_t j = 0; j != kDecoderDim; ++j) {
+      decoder_out[j] = std::sin(p[0] * 0.7f + p[1] * 1.3f + j);
+    }
+
+    return decoder_out;
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
+                       ncnn::Extractor * /*extractor*/) override {
+    return RunDecoder(decoder_input);
+  }
+
+  // Row r of the output depends only on row r of the inputs. Like the
+  // real joiner, a single row of encoder_out is broadcast to all rows of
+  // decoder_out.
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
+                      ncnn::Mat &decoder_out) override {
+    int32_t num_rows = decoder_out.h;
+    ncnn::Mat joiner_out(kVocabSize, num_rows);
+    for (int32_t r = 0; r != num_rows; ++r) {
+      const float *e = encoder_out.row(encoder_out.h == 1 ? 0 : r);
+      const float *d = decoder_out.row(r);
+      float *p = joiner_out.row(r);
+      for (int32_t v = 0; v != kVocabSize; ++v) {
+        p[v] = 4 * std::cos(e[v % kEncoderDim] * 2.1f +
+                            d[v % kDecoderDim] * 1.9f + v * 0.3f);
+      }
+
+      // Make the blank a bit more likely
+      p[0] += 1.5f;
+    }
+
+    return joiner_out;
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ncnn::Extractor * /*extractor*/) override {
+    return RunJoiner(encoder_out, decoder_out);
+  }
+
+  int32_t Segment() const override { return 1; }
+  int32_t Offset() const override { return 1; }
+
+ private:
+  ncnn::Net net_;
+};
+
+}  // namespace
+
+// Decode chunks[i] with streams[i]. If batched is true, the i-th chunk of
+// all streams is decoded with a single call.
+static std::vector<sherpa_ncnn::DecoderResult> Decode(
+    sherpa_ncnn::Decoder *decoder,
+    const std::vector<std::vector<ncnn::Mat>> &chunks, bool batched) {
+  int32_t num_streams = static_cast<int32_t>(chunks.size());
+  std::vector<std::unique_ptr<sherpa_ncnn::Stream>> streams;
+  std::vector<sherpa_ncnn::Stream *> ss;
+  for (int32_t i = 0; i != num_streams; ++i) {
+    streams.push_back(std::make_unique<sherpa_ncnn::Stream>());
+    streams.back()->SetResult(decoder->GetEmptyResult());
+    ss.push_back(streams.back().get());
+  }
+
+  std::vector<ncnn::Mat> encoder_out(num_streams);
+  for (size_t c = 0; c != chunks[0].size(); ++c) {
+    for (int32_t i = 0; i != num_streams; ++i) {
+      encoder_out[i] = chunks[i][c];
+    }
+
+    if (batched) {
+      decoder->Decode(encoder_out.data(), ss.data(), num_streams);
+    } else {
+      for (int32_t i = 0; i != num_streams; ++i) {
+        decoder->Decode(encoder_out[i], ss[i], &ss[i]->GetResult());
+      }
+    }
+  }
+
+  std::vector<sherpa_ncnn::DecoderResult> ans;
+  for (auto s : ss) {
+    sherpa_ncnn::DecoderResult r = s->GetResult();
+    decoder->StripLeadingBlanks(&r);
+    ans.push_back(std::move(r));
+  }
+
+  return ans;
+}
+
+static bool Check(sherpa_ncnn::Decoder *decoder, const std::string &name,
+                  int32_t num_streams) {
+  std::mt19937 gen(num_streams);
+  std::uniform_real_distribution<float> dist(-1, 1);
+
+  int32_t num_chunks = 6;
+  int32_t num_frames = 5;
+
+  std::vector<std::vector<ncnn::Mat>> chunks(num_streams);
+  for (auto &c : chunks) {
+    for (int32_t k = 0; k != num_chunks; ++k) {
+      ncnn::Mat m(SyntheticModel::kEncoderDim, num_frames);
+      for (int32_t j = 0; j != static_cast<int32_t>(m.total()); ++j) {
+        m[j] = dist(gen);
+      }
+      c.push_back(m);
+    }
+  }
+
+  std::vector<sherpa_ncnn::DecoderResult> expected =
+      Decode(decoder, chunks, false);
+  std::vector<sherpa_ncnn::DecoderResult> results =
+      Decode(decoder, chunks, true);
+
+  bool ok = true;
+  int32_t num_tokens = 0;
+  for (int32_t i = 0; i != num_streams; ++i) {
+    num_tokens += static_cast<int32_t>(expected[i].tokens.size());
+
+    if (results[i].tokens != expected[i].tokens ||
+        results[i].timestamps != expected[i].timestamps ||
+        results[i].num_trailing_blanks != expected[i].num_trailing_blanks) {
+      fprintf(stderr, "%s, %d streams: stream %d gives a different result\n",
+              name.c_str(), num_streams, i);
+      ok = false;
+    }
+  }
+
+  fprintf(stderr, "%s, %d streams: %d tokens\n", name.c_str(), num_streams,
+          num_tokens);
+
+  return ok;
+}
+
+int32_t main() {
+  SyntheticModel model;
+
+  sherpa_ncnn::GreedySearchDecoder greedy(&model);
+  sherpa_ncnn::GreedySearchDecoder greedy_batch_frames(&model, nullptr, true);
+  sherpa_ncnn::ModifiedBeamSearchDecoder beam(&model, 4);
+
+  std::vector<std::pair<sherpa_ncnn::Decoder *, std::string>> decoders = {
+      {&greedy, "greedy_search"},
+      {&greedy_batch_frames, "greedy_search with batch_frames"},
+      {&beam, "modified_beam_search"},
+  };
+
+  bool ok = true;
+  for (const auto &p : decoders) {
+    for (int32_t num_streams : {1, 2, 5, 16}) {
+      ok = Check(p.first, p.second, num_streams) && ok;
+    }
+  }
+
+  if (!ok) {
+    fprintf(stderr, "Failed!\n");
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,181 @@
+// sherpa-ncnn/csrc/test-decode-streams.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Compare the throughput of decoding 16, 32 and 64 concurrent streams by
+// calling DecodeStream() on each ready stream with that of a single
+// DecodeStreams() call for all ready streams, and check that both give
+// the same results.
+//
+// Usage:
+//
+//  ./bin/test-decode-streams tokens.txt encoder.ncnn.param encoder.ncnn.bin
+//    decoder.ncnn.param decoder.ncnn.bin joiner.ncnn.param joiner.ncnn.bin
+//    [foo.wav] [num_threads]
+//
+// If no wave file is given, 2 seconds of generated audio are used.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+// Decode num_streams streams concurrently. Stream i is given the samples
+// starting at a different offset, so that the streams are not identical.
+//
+// If batched is true, all ready streams of a round are decoded with a
+// single DecodeStreams() call. Otherwise, DecodeStream() is called on
+// each of them.
+//
+// Return the elapsed seconds. The results are saved in texts.
+static float Run(const sherpa_ncnn::Recognizer &recognizer,
+                 int32_t num_streams, const std::vector<float> &samples,
+                 bool batched, std::vector<std::string> *texts) {
+  std::vector<std::unique_ptr<sherpa_ncnn::Stream>> streams;
+  for (int32_t i = 0; i != num_streams; ++i) {
+    auto s = recognizer.CreateStream();
+
+    int32_t offset = (i * 1601) % (samples.size() / 2);
+    s->AcceptWaveform(16000, samples.data() + offset,
+                      samples.size() - offset);
+
+    std::vector<float> tail_paddings(4800);
+    s->AcceptWaveform(16000, tail_paddings.data(), tail_paddings.size());
+    s->InputFinished();
+
+    streams.push_back(std::move(s));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<sherpa_ncnn::Stream *> ready;
+  while (true) {
+    ready.clear();
+    for (auto &s : streams) {
+      if (recognizer.IsReady(s.get())) {
+        ready.push_back(s.get());
+      }
+    }
+
+    if (ready.empty()) {
+      break;
+    }
+
+    if (batched) {
+      recognizer.DecodeStreams(ready.data(),
+                               static_cast<int32_t>(ready.size()));
+    } else {
+      for (auto s : ready) {
+        recognizer.DecodeStream(s);
+      }
+    }
+  }
+
+  texts->clear();
+  for (auto &s : streams) {
+    texts->push_back(recognizer.GetResult(s.get()).text);
+  }
+
+  auto stop = std::chrono::steady_clock::now();
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(stop - start)
+             .count() /
+         1e6f;
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  if (argc < 8 || argc > 10) {
+    fprintf(stderr, "Usage: %s tokens.txt encoder.param encoder.bin ",
+            argv[0]);
+    fprintf(stderr,
+            "decoder.param decoder.bin joiner.param joiner.bin "
+            "[foo.wav] [num_threads]\n");
+    return -1;
+  }
+
+  sherpa_ncnn::RecognizerConfig config;
+  config.model_config.tokens = argv[1];
+  config.model_config.encoder_param = argv[2];
+  config.model_config.encoder_bin = argv[3];
+  config.model_config.decoder_param = argv[4];
+  config.model_config.decoder_bin = argv[5];
+  config.model_config.joiner_param = argv[6];
+  config.model_config.joiner_bin = argv[7];
+  config.model_config.use_vulkan_compute = false;
+
+  int32_t num_threads = argc == 10 ? std::max(1, atoi(argv[9])) : 1;
+  config.model_config.encoder_opt.num_threads = num_threads;
+  config.model_config.decoder_opt.num_threads = num_threads;
+  config.model_config.joiner_opt.num_threads = num_threads;
+
+  sherpa_ncnn::Recognizer recognizer(config);
+  if (!recognizer.GetModel()) {
+    fprintf(stderr, "Failed to create the model\n");
+    return -1;
+  }
+
+  std::vector<float> samples;
+  if (argc >= 9) {
+    bool is_ok = false;
+    samples = sherpa_ncnn::ReadWave(argv[8], 16000, &is_ok);
+    if (!is_ok) {
+      fprintf(stderr, "Failed to read %s\n", argv[8]);
+      return -1;
+    }
+  } else {
+    // 2 seconds of tones with a varying pitch
+    samples.resize(32000);
+    for (size_t i = 0; i != samples.size(); ++i) {
+      float f = 150 + 100 * std::sin(i / 4000.0f);
+      samples[i] = 0.1f * std::sin(2 * 3.14159265f * f * i / 16000);
+    }
+  }
+
+  fprintf(stderr, "num_threads: %d\n", num_threads);
+  fprintf(stderr, "%-12s %22s %22s %9s\n", "num_streams",
+          "DecodeStream (s/core)", "DecodeStreams (s/core)", "speedup");
+
+  // warm up
+  std::vector<std::string> texts;
+  Run(recognizer, 2, samples, false, &texts);
+  Run(recognizer, 2, samples, true, &texts);
+
+  bool ok = true;
+  for (int32_t num_streams : {16, 32, 64}) {
+    std::vector<std::string> expected;
+    float loop_seconds =
+        Run(recognizer, num_streams, samples, false, &expected);
+    float batch_seconds = Run(recognizer, num_streams, samples, true, &texts);
+
+    if (texts != expected) {
+      fprintf(stderr,
+              "DecodeStreams() gives different results for %d streams\n",
+              num_streams);
+      ok = false;
+    }
+
+    // Seconds of audio decoded per second per core
+    float audio_seconds = num_streams * samples.size() / 16000.0f;
+    float loop_rate = audio_seconds / loop_seconds / num_threads;
+    float batch_rate = audio_seconds / batch_seconds / num_threads;
+
+    fprintf(stderr, "%-12d %22.2f %22.2f %8.2fx\n", num_streams, loop_rate,
+            batch_rate, batch_rate / loop_rate);
+  }
+
+  if (!ok) {
+    fprintf(stderr, "Failed!\n");
+    return -1;
+  }
+
+  return 0;
+}
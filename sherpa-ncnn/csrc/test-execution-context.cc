@@ -0,0 +1,215 @@
+// sherpa-ncnn/csrc/test-execution-context.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Compare running the networks with the default allocators and with
+// the pool allocators of ExecutionContext.
+//
+// Usage:
+//
+//  ./bin/test-execution-context encoder.ncnn.param encoder.ncnn.bin
+//    decoder.ncnn.param decoder.ncnn.bin joiner.ncnn.param joiner.ncnn.bin
+//    [num_chunks]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/execution-context.h"
+#include "sherpa-ncnn/csrc/model.h"
+
+// It forwards requests to another allocator, or to the heap if there is none,
+// and counts them.
+class CountingAllocator : public ncnn::Allocator {
+ public:
+  explicit CountingAllocator(ncnn::Allocator *other = nullptr)
+      : other_(other) {}
+
+  void *fastMalloc(size_t size) override {
+    ++num_requests_;
+    if (!other_) {
+      ++num_heap_allocations_;
+      return ncnn::fastMalloc(size);
+    }
+
+    void *p = other_->fastMalloc(size);
+
+    // A pool allocator hands out the same buffers again and again. A pointer
+    // that we have not seen before comes from the heap.
+    if (seen_.insert(p).second) {
+      ++num_heap_allocations_;
+    }
+    return p;
+  }
+
+  void fastFree(void *ptr) override {
+    if (!other_) {
+      ncnn::fastFree(ptr);
+      return;
+    }
+    other_->fastFree(ptr);
+  }
+
+  int64_t NumRequests() const { return num_requests_; }
+  int64_t NumHeapAllocations() const { return num_heap_allocations_; }
+
+  void ResetCounters() {
+    num_requests_ = 0;
+    num_heap_allocations_ = 0;
+  }
+
+ private:
+  ncnn::Allocator *other_;
+  std::unordered_set<void *> seen_;
+  int64_t num_requests_ = 0;
+  int64_t num_heap_allocations_ = 0;
+};
+
+// Simulate decoding num_chunks chunks: run the encoder once per chunk,
+// the joiner once per frame and the decoder once per frame.
+//
+// create_extractor is called with a network and returns an extractor for it.
+template <typename F>
+static float Run(sherpa_ncnn::Model *model, int32_t num_chunks,
+                 F create_extractor) {
+  int32_t feature_dim = 80;
+  ncnn::Mat features(feature_dim, model->Segment());
+  features.fill(0.5f);
+
+  int32_t context_size = model->ContextSize();
+  ncnn::Mat decoder_input(context_size);
+  for (int32_t i = 0; i != context_size; ++i) {
+    static_cast<int32_t *>(decoder_input)[i] = i + 1;
+  }
+
+  std::vector<ncnn::Mat> states = model->GetEncoderInitStates();
+
+  auto start = std::chrono::steady_clock::now();
+  for (int32_t c = 0; c != num_chunks; ++c) {
+    ncnn::Mat encoder_out;
+    {
+      ncnn::Extractor ex = create_extractor(model->GetEncoder());
+      std::tie(encoder_out, states) = model->RunEncoder(features, states, &ex);
+    }
+
+    ncnn::Mat decoder_out;
+    for (int32_t t = 0; t != encoder_out.h; ++t) {
+      ncnn::Extractor decoder_ex = create_extractor(model->GetDecoder());
+      decoder_out = model->RunDecoder(decoder_input, &decoder_ex);
+
+      ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
+      ncnn::Extractor joiner_ex = create_extractor(model->GetJoiner());
+      ncnn::Mat joiner_out =
+          model->RunJoiner(encoder_out_t, decoder_out, &joiner_ex);
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(stop - start)
+             .count() /
+         1000.f / num_chunks;
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  if (argc != 7 && argc != 8) {
+    fprintf(stderr, "Usage: %s encoder.param encoder.bin decoder.param ",
+            argv[0]);
+    fprintf(stderr, "decoder.bin joiner.param joiner.bin [num_chunks]\n");
+    return -1;
+  }
+
+  sherpa_ncnn::ModelConfig config;
+  config.encoder_param = argv[1];
+  config.encoder_bin = argv[2];
+  config.decoder_param = argv[3];
+  config.decoder_bin = argv[4];
+  config.joiner_param = argv[5];
+  config.joiner_bin = argv[6];
+  config.use_vulkan_compute = false;
+
+  int32_t num_threads = 1;
+  config.encoder_opt.num_threads = num_threads;
+  config.decoder_opt.num_threads = num_threads;
+  config.joiner_opt.num_threads = num_threads;
+
+  int32_t num_chunks = argc == 8 ? atoi(argv[7]) : 50;
+
+  auto model = sherpa_ncnn::Model::Create(config);
+  if (!model) {
+    fprintf(stderr, "Failed to create the model\n");
+    return -1;
+  }
+
+  // warm up
+  Run(model.get(), 2,
+      [](const ncnn::Net &net) { return net.create_extractor(); });
+
+  float default_ms = Run(model.get(), num_chunks, [](const ncnn::Net &net) {
+    return net.create_extractor();
+  });
+
+  sherpa_ncnn::ExecutionContext ctx;
+  Run(model.get(), 2,
+      [&ctx](const ncnn::Net &net) { return ctx.CreateExtractor(net); });
+
+  float ctx_ms = Run(model.get(), num_chunks, [&ctx](const ncnn::Net &net) {
+    return ctx.CreateExtractor(net);
+  });
+
+  // Count allocations. The first chunk warms up the pools, so we
+  // skip it.
+  CountingAllocator heap_blob;
+  CountingAllocator heap_workspace;
+  auto heap = [&](const ncnn::Net &net) {
+    ncnn::Extractor ex = net.create_extractor();
+    ex.set_blob_allocator(&heap_blob);
+    ex.set_workspace_allocator(&heap_workspace);
+    return ex;
+  };
+  Run(model.get(), 1, heap);
+  heap_blob.ResetCounters();
+  heap_workspace.ResetCounters();
+  Run(model.get(), num_chunks, heap);
+
+  ncnn::UnlockedPoolAllocator blob_pool;
+  ncnn::UnlockedPoolAllocator workspace_pool;
+  CountingAllocator pool_blob(&blob_pool);
+  CountingAllocator pool_workspace(&workspace_pool);
+  auto pool = [&](const ncnn::Net &net) {
+    ncnn::Extractor ex = net.create_extractor();
+    ex.set_blob_allocator(&pool_blob);
+    ex.set_workspace_allocator(&pool_workspace);
+    return ex;
+  };
+  Run(model.get(), 1, pool);
+  pool_blob.ResetCounters();
+  pool_workspace.ResetCounters();
+  Run(model.get(), num_chunks, pool);
+
+  fprintf(stderr, "num_chunks: %d, num_threads: %d\n", num_chunks,
+          num_threads);
+  fprintf(stderr, "%-20s %15s %20s %20s\n", "", "ms per chunk",
+          "requests per chunk", "heap allocs per chunk");
+  fprintf(stderr, "%-20s %15.3f %20.1f %20.1f\n", "default", default_ms,
+          (heap_blob.NumRequests() + heap_workspace.NumRequests()) * 1.f /
+              num_chunks,
+          (heap_blob.NumHeapAllocations() +
+           heap_workspace.NumHeapAllocations()) *
+              1.f / num_chunks);
+  fprintf(stderr, "%-20s %15.3f %20.1f %20.1f\n", "ExecutionContext", ctx_ms,
+          (pool_blob.NumRequests() + pool_workspace.NumRequests()) * 1.f /
+              num_chunks,
+          (pool_blob.NumHeapAllocations() +
+           pool_workspace.NumHeapAllocations()) *
+              1.f / num_chunks);
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+// sherpa-ncnn/csrc/test-fast-fbank.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Compare the features computed with FeatureExtractorConfig::fast_fbank
+// with those of kaldi-native-fbank, and report the number of frames
+// computed per second by each of them.
+//
+// Usage:
+//
+//  ./bin/test-fast-fbank [num_seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/math.h"
+
+// Feed the samples in chunks of 10 ms, as in streaming recognition, and
+// return the number of frames computed per second
+static double Run(bool fast_fbank, const std::vector<float> &samples,
+                  ncnn::Mat *features) {
+  sherpa_ncnn::FeatureExtractorConfig config;
+  config.fast_fbank = fast_fbank;
+  sherpa_ncnn::FeatureExtractor extractor(config);
+
+  auto start = std::chrono::steady_clock::now();
+
+  int32_t chunk_size = config.sampling_rate / 100;
+  for (int32_t i = 0; i < static_cast<int32_t>(samples.size());
+       i += chunk_size) {
+    int32_t n = std::min<int32_t>(chunk_size, samples.size() - i);
+    extractor.AcceptWaveform(config.sampling_rate, samples.data() + i, n);
+  }
+  extractor.InputFinished();
+
+  auto stop = std::chrono::steady_clock::now();
+  double elapsed_seconds =
+      std::chrono::duration_cast<std::chrono::microseconds>(stop - start)
+          .count() /
+      1e6;
+
+  int32_t num_frames = extractor.NumFramesReady();
+  *features = extractor.GetFrames(0, num_frames).clone();
+
+  return num_frames / elapsed_seconds;
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  int32_t num_seconds = argc > 1 ? atoi(argv[1]) : 60;
+
+  // Noise with a slowly varying amplitude, with some silence in between
+  std::vector<float> samples(num_seconds * 16000);
+  sherpa_ncnn::RandomVectorFill(samples.data(), samples.size(), -1, 1);
+  for (int32_t i = 0; i != static_cast<int32_t>(samples.size()); ++i) {
+    float t = i / 16000.0f;
+    samples[i] *= 0.5f * (1 + std::sin(t)) * (static_cast<int32_t>(t) % 5 != 4);
+  }
+
+  ncnn::Mat expected;
+  ncnn::Mat features;
+  double knf_fps = Run(false, samples, &expected);
+  double fast_fps = Run(true, samples, &features);
+
+  if (expected.h != features.h || expected.w != features.w) {
+    fprintf(stderr, "Shapes differ: (%d, %d) vs (%d, %d)\n", expected.h,
+            expected.w, features.h, features.w);
+    return -1;
+  }
+
+  float max_diff = 0;
+  for (int32_t i = 0; i != expected.h * expected.w; ++i) {
+    max_diff = std::max(max_diff, std::abs(static_cast<float *>(expected)[i] -
+                                           static_cast<float *>(features)[i]));
+  }
+
+  fprintf(stderr, "num_frames: %d, max abs difference: %g\n", expected.h,
+          max_diff);
+  fprintf(stderr, "kaldi-native-fbank: %.0f frames/s\n", knf_fps);
+  fprintf(stderr, "fast fbank: %.0f frames/s, speedup: %.2fx\n", fast_fps,
+          fast_fps / knf_fps);
+
+  // The features are log energies
+  if (max_diff > 1e-3) {
+    fprintf(stderr, "Failed!\n");
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,248 @@
+// sherpa-ncnn/csrc/test-greedy-search-decoder.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Check that greedy search with batch_frames, i.e., with
+// DecodeFramesSpeculatively(), gives the same tokens and timestamps as
+// DecodeFrameByFrame().
+//
+// A synthetic model is used. Frame t of encoder_out proposes a token c_t,
+// and the joiner emits it only if it differs from the last token, which is
+// all that decoder_out knows about. Frames that repeat a token just
+// emitted are therefore predicted wrongly by the speculative joiner run
+// and have to be decoded again after decoder_out is updated.
+//
+// Usage:
+//
+//  ./bin/test-greedy-search-decoder
+
+#include <stdio.h>
+
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/greedy-search-decoder.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace {
+
+class SyntheticModel : public sherpa_ncnn::Model {
+ public:
+  static constexpr int32_t kVocabSize = 8;
+
+  ncnn::Net &GetEncoder() override { return net_; }
+  ncnn::Net &GetDecoder() override { return net_; }
+  ncnn::Net &GetJoiner() override { return net_; }
+
+  std::vector<ncnn::Mat> GetEncoderInitStates() const override { return {}; }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states) override {
+    return {features, states};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
+      ncnn::Extractor * /*extractor*/) override {
+    return RunEncoder(features, states);
+  }
+
+  // decoder_out is the one-hot vector of the last token
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override {
+    const int32_t *p = decoder_input;
+    ncnn::Mat decoder_out(kVocabSize);
+    decoder_out.fill(0.0f);
+    decoder_out[p[decoder_input.w - 1]] = 1;
+
+    return decoder_out;
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
+                       ncnn::Extractor * /*extractor*/) override {
+    return RunDecoder(decoder_input);
+  }
+
+  // Each row of encoder_out is the one-hot vector of the proposed token.
+  // The blank wins unless the proposed token differs from the last one.
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
+                      ncnn::Mat &decoder_out) override {
+    int32_t num_rows = encoder_out.h;
+    ncnn::Mat joiner_out(kVocabSize, num_rows);
+    for (int32_t r = 0; r != num_rows; ++r) {
+      const float *e = encoder_out.row(r);
+      const float *d = decoder_out.row(r);
+      float *p = joiner_out.row(r);
+
+      p[0] = 0.5f;
+      for (int32_t v = 1; v != kVocabSize; ++v) {
+        p[v] = e[v] - 2 * d[v];
+      }
+    }
+
+    num_joiner_rows_ += num_rows;
+
+    return joiner_out;
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ncnn::Extractor * /*extractor*/) override {
+    return RunJoiner(encoder_out, decoder_out);
+  }
+
+  int32_t Segment() const override { return 1; }
+  int32_t Offset() const override { return 1; }
+
+  // Number of rows computed by the joiner since the last call
+  int32_t TakeNumJoinerRows() {
+    int32_t ans = num_joiner_rows_;
+    num_joiner_rows_ = 0;
+    return ans;
+  }
+
+ private:
+  ncnn::Net net_;
+  int32_t num_joiner_rows_ = 0;
+};
+
+}  // namespace
+
+// Return encoder_out proposing the given tokens, one per frame. Token 0
+// is the blank. Token 2 is not used since greedy search treats it as a
+// blank as well.
+static ncnn::Mat EncoderOut(const std::vector<int32_t> &tokens) {
+  ncnn::Mat ans(SyntheticModel::kVocabSize,
+                static_cast<int32_t>(tokens.size()));
+  ans.fill(0.0f);
+  for (int32_t t = 0; t != static_cast<int32_t>(tokens.size()); ++t) {
+    ans.row(t)[tokens[t]] = 1;
+  }
+
+  return ans;
+}
+
+// Decode the chunks of each stream, all streams in a batch, and return
+// the results
+static std::vector<sherpa_ncnn::DecoderResult> Decode(
+    SyntheticModel *model, bool batch_frames,
+    const std::vector<std::vector<ncnn::Mat>> &chunks) {
+  sherpa_ncnn::GreedySearchDecoder decoder(model, nullptr, batch_frames);
+
+  int32_t num_streams = static_cast<int32_t>(chunks.size());
+  std::vector<std::unique_ptr<sherpa_ncnn::Stream>> streams;
+  std::vector<sherpa_ncnn::Stream *> ss;
+  for (int32_t i = 0; i != num_streams; ++i) {
+    streams.push_back(std::make_unique<sherpa_ncnn::Stream>());
+    streams.back()->SetResult(decoder.GetEmptyResult());
+    ss.push_back(streams.back().get());
+  }
+
+  std::vector<ncnn::Mat> encoder_out(num_streams);
+  for (size_t c = 0; c != chunks[0].size(); ++c) {
+    for (int32_t i = 0; i != num_streams; ++i) {
+      encoder_out[i] = chunks[i][c];
+    }
+    decoder.Decode(encoder_out.data(), ss.data(), num_streams);
+  }
+
+  std::vector<sherpa_ncnn::DecoderResult> ans;
+  for (auto s : ss) {
+    sherpa_ncnn::DecoderResult r = s->GetResult();
+    decoder.StripLeadingBlanks(&r);
+    ans.push_back(std::move(r));
+  }
+
+  return ans;
+}
+
+static bool Check(SyntheticModel *model,
+                  const std::vector<std::vector<ncnn::Mat>> &chunks,
+                  const char *name) {
+  int32_t num_frames = 0;
+  for (const auto &c : chunks) {
+    for (const auto &m : c) {
+      num_frames += m.h;
+    }
+  }
+
+  std::vector<sherpa_ncnn::DecoderResult> expected =
+      Decode(model, false, chunks);
+  model->TakeNumJoinerRows();
+
+  std::vector<sherpa_ncnn::DecoderResult> results =
+      Decode(model, true, chunks);
+  int32_t num_rows = model->TakeNumJoinerRows();
+
+  bool ok = true;
+  for (size_t i = 0; i != results.size(); ++i) {
+    if (results[i].tokens != expected[i].tokens ||
+        results[i].timestamps != expected[i].timestamps ||
+        results[i].num_trailing_blanks != expected[i].num_trailing_blanks) {
+      fprintf(stderr, "%s: stream %d gives a different result\n", name,
+              static_cast<int32_t>(i));
+      ok = false;
+    }
+  }
+
+  // Rows computed in addition to one row per frame were discarded, i.e.,
+  // at least one speculative prediction was wrong and rolled back
+  if (num_rows <= num_frames) {
+    fprintf(stderr, "%s: no speculative prediction was rolled back\n", name);
+    ok = false;
+  }
+
+  fprintf(stderr, "%s: %d frames, %d joiner rows\n", name, num_frames,
+          num_rows);
+
+  return ok;
+}
+
+int32_t main() {
+  SyntheticModel model;
+  bool ok = true;
+
+  // Repeated tokens after an emission are mispredicted
+  ok = Check(&model, {{EncoderOut({5, 5, 5, 7, 7, 0, 7, 3})}}, "repeats") &&
+       ok;
+
+  // A token is carried over to the next chunk through decoder_out
+  ok = Check(&model,
+             {{EncoderOut({4, 4, 0}), EncoderOut({4, 4, 6}),
+               EncoderOut({6, 1, 1})}},
+             "chunks") &&
+       ok;
+
+  // Streams in a batch with different emissions
+  ok = Check(&model,
+             {{EncoderOut({1, 1, 0, 3}), EncoderOut({3, 3, 3, 3})},
+              {EncoderOut({0, 0, 0, 0}), EncoderOut({0, 0, 0, 5})},
+              {EncoderOut({6, 6, 6, 6}), EncoderOut({7, 6, 7, 6})}},
+             "batch") &&
+       ok;
+
+  // Random proposals
+  std::mt19937 gen(20260);
+  std::uniform_int_distribution<int32_t> dist(0, 4);
+  std::vector<std::vector<ncnn::Mat>> chunks(8);
+  for (auto &c : chunks) {
+    for (int32_t k = 0; k != 5; ++k) {
+      std::vector<int32_t> tokens(6);
+      for (auto &t : tokens) {
+        // 0, 1, 3, 4, 5. Small values make repeats likely
+        t = dist(gen);
+        t += t >= 2;
+      }
+      c.push_back(EncoderOut(tokens));
+    }
+  }
+  ok = Check(&model, chunks, "random") && ok;
+
+  if (!ok) {
+    fprintf(stderr, "Failed!\n");
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+// sherpa-ncnn/csrc/test-log-softmax-topk.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Compare LogSoftmaxTopk() with LogSoftmax() + TopkIndex() as used by
+// modified beam search, for different vocabulary sizes.
+//
+// Usage:
+//
+//  ./bin/test-log-softmax-topk [num_active_paths]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/log-softmax-topk.h"
+#include "sherpa-ncnn/csrc/math.h"
+
+// The original implementation in modified-beam-search-decoder.cc
+static std::vector<int32_t> Reference(std::vector<float> x, int32_t num_rows,
+                                      int32_t num_cols,
+                                      const std::vector<float> &offsets,
+                                      int32_t k) {
+  for (int32_t r = 0; r != num_rows; ++r) {
+    float *p = x.data() + r * num_cols;
+    sherpa_ncnn::LogSoftmax(p, num_cols);
+    for (int32_t c = 0; c != num_cols; ++c) {
+      p[c] += offsets[r];
+    }
+  }
+
+  return sherpa_ncnn::TopkIndex(x.data(), num_rows * num_cols, k);
+}
+
+template <typename F>
+static double TimeIt(int32_t num_iterations, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i != num_iterations; ++i) {
+    f();
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+             .count() /
+         1000. / num_iterations;
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  int32_t k = argc > 1 ? atoi(argv[1]) : 4;
+  int32_t num_rows = k;
+  int32_t num_iterations = 2000;
+
+  fprintf(stderr, "num_active_paths: %d\n", k);
+  fprintf(stderr, "%10s %18s %18s %10s\n", "vocab_size", "reference (us)",
+          "fused (us)", "speedup");
+
+  for (int32_t vocab_size : {500, 1000, 2000, 4000, 6000}) {
+    std::vector<float> x(num_rows * vocab_size);
+    sherpa_ncnn::RandomVectorFill(x.data(), x.size(), -10, 10);
+
+    std::vector<float> offsets(num_rows);
+    sherpa_ncnn::RandomVectorFill(offsets.data(), offsets.size(), -5, 0);
+
+    std::vector<int32_t> expected =
+        Reference(x, num_rows, vocab_size, offsets, k);
+
+    std::vector<int32_t> topk;
+    std::vector<float> values;
+    sherpa_ncnn::LogSoftmaxTopk(x.data(), num_rows, vocab_size,
+                                offsets.data(), k, &topk, &values);
+
+    if (topk != expected) {
+      fprintf(stderr, "vocab_size %d: results differ!\n", vocab_size);
+      return -1;
+    }
+
+    double reference_us = TimeIt(num_iterations, [&]() {
+      expected = Reference(x, num_rows, vocab_size, offsets, k);
+    });
+
+    double fused_us = TimeIt(num_iterations, [&]() {
+      sherpa_ncnn::LogSoftmaxTopk(x.data(), num_rows, vocab_size,
+                                  offsets.data(), k, &topk, &values);
+    });
+
+    fprintf(stderr, "%10d %18.3f %18.3f %9.2fx\n", vocab_size, reference_us,
+            fused_us, reference_us / fused_us);
+  }
+
+  return 0;
+}
@@ -0,0 +1,140 @@
+// sherpa-ncnn/csrc/test-recognizer-pool.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Submit several streams to a RecognizerPool and check that every future
+// completes, including the one whose callback throws, and that the pool
+// keeps decoding afterwards.
+//
+// Usage:
+//
+//  ./bin/test-recognizer-pool tokens.txt encoder.ncnn.param encoder.ncnn.bin
+//    decoder.ncnn.param decoder.ncnn.bin joiner.ncnn.param joiner.ncnn.bin
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/recognizer-pool.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+// Submit num_streams streams. The callback of stream bad throws.
+// Return false if a future does not complete or has a wrong state.
+static bool Run(const sherpa_ncnn::Recognizer &recognizer,
+                sherpa_ncnn::RecognizerPool *pool, int32_t num_streams,
+                int32_t bad) {
+  // 0.5 seconds of low-level noise
+  std::vector<float> samples(8000);
+  for (size_t i = 0; i != samples.size(); ++i) {
+    samples[i] = ((i * 7919) % 200) / 100000.0f - 0.001f;
+  }
+
+  std::vector<std::unique_ptr<sherpa_ncnn::Stream>> streams;
+  std::vector<std::future<void>> futures;
+  std::atomic<int32_t> num_callbacks{0};
+
+  for (int32_t i = 0; i != num_streams; ++i) {
+    auto s = recognizer.CreateStream();
+    s->AcceptWaveform(16000, samples.data(), samples.size());
+    s->InputFinished();
+
+    auto callback = [&recognizer, &num_callbacks, i,
+                     bad](sherpa_ncnn::Stream *s) {
+      recognizer.GetResult(s);
+      ++num_callbacks;
+      if (i == bad) {
+        throw std::runtime_error("callback failed");
+      }
+    };
+
+    futures.push_back(pool->Submit(s.get(), callback));
+
+    streams.push_back(std::move(s));
+  }
+
+  bool ok = true;
+  for (int32_t i = 0; i != num_streams; ++i) {
+    if (futures[i].wait_for(std::chrono::seconds(60)) !=
+        std::future_status::ready) {
+      fprintf(stderr, "The future of stream %d does not complete\n", i);
+      return false;
+    }
+
+    bool thrown = false;
+    try {
+      futures[i].get();
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+
+    if (thrown != (i == bad)) {
+      fprintf(stderr, "Wrong exception state of stream %d\n", i);
+      ok = false;
+    }
+  }
+
+  pool->Wait();
+
+  if (num_callbacks != num_streams) {
+    fprintf(stderr, "Expected %d callbacks. Actual %d\n", num_streams,
+            num_callbacks.load());
+    ok = false;
+  }
+
+  return ok;
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  if (argc != 8) {
+    fprintf(stderr, "Usage: %s tokens.txt encoder.param encoder.bin ",
+            argv[0]);
+    fprintf(stderr, "decoder.param decoder.bin joiner.param joiner.bin\n");
+    return -1;
+  }
+
+  sherpa_ncnn::RecognizerConfig config;
+  config.model_config.tokens = argv[1];
+  config.model_config.encoder_param = argv[2];
+  config.model_config.encoder_bin = argv[3];
+  config.model_config.decoder_param = argv[4];
+  config.model_config.decoder_bin = argv[5];
+  config.model_config.joiner_param = argv[6];
+  config.model_config.joiner_bin = argv[7];
+  config.model_config.use_vulkan_compute = false;
+  config.model_config.encoder_opt.num_threads = 1;
+  config.model_config.decoder_opt.num_threads = 1;
+  config.model_config.joiner_opt.num_threads = 1;
+
+  sherpa_ncnn::Recognizer recognizer(config);
+  if (!recognizer.GetModel()) {
+    fprintf(stderr, "Failed to create the model\n");
+    return -1;
+  }
+
+  bool ok = true;
+  {
+    // Fewer workers than streams, so that the worker that runs the
+    // throwing callback has to decode other streams afterwards
+    sherpa_ncnn::RecognizerPool pool(&recognizer, 2);
+
+    ok = Run(recognizer, &pool, 8, 3) && ok;
+
+    // The pool still works after a callback threw
+    ok = Run(recognizer, &pool, 8, -1) && ok;
+
+    // The destructor must not block, even if the last callback throws
+    Run(recognizer, &pool, 4, 3);
+  }
+
+  if (!ok) {
+    fprintf(stderr, "Failed!\n");
+    return -1;
+  }
+
+  return 0;
+}
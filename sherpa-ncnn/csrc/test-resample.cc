@@ -18,16 +18,101 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/math.h"
 #include "sherpa-ncnn/csrc/resample.h"
 
+static std::unique_ptr<sherpa_ncnn::LinearResample> CreateResampler(
+    int32_t in_sample_rate, int32_t out_sample_rate) {
+  float min_freq = std::min(in_sample_rate, out_sample_rate);
+  float lowpass_cutoff = 0.99 * 0.5 * min_freq;
+
+  int32_t lowpass_filter_width = 6;
+  return std::make_unique<sherpa_ncnn::LinearResample>(
+      in_sample_rate, out_sample_rate, lowpass_cutoff, lowpass_filter_width);
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(stop - start)
+             .count() /
+         1e6;
+}
+
+// Resample num_seconds of noise to 16 kHz in chunks of 10 ms, as in
+// streaming recognition, and check that the result is exactly the same as
+// that of resampling it at once.
+static bool Benchmark(int32_t in_sample_rate, int32_t num_seconds) {
+  int32_t out_sample_rate = 16000;
+
+  std::vector<float> in(in_sample_rate * num_seconds);
+  sherpa_ncnn::RandomVectorFill(in.data(), in.size(), -1, 1);
+
+  auto start = std::chrono::steady_clock::now();
+  auto resampler = CreateResampler(in_sample_rate, out_sample_rate);
+  double create_seconds = Seconds(start);
+
+  // The filter is computed only once for each sample rate
+  start = std::chrono::steady_clock::now();
+  auto another_resampler = CreateResampler(in_sample_rate, out_sample_rate);
+  double create_again_seconds = Seconds(start);
+
+  std::vector<float> expected;
+  another_resampler->Resample(in.data(), in.size(), true, &expected);
+
+  int32_t chunk = in_sample_rate / 100;
+  std::vector<float> out;
+  std::vector<float> tmp;
+
+  start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i < static_cast<int32_t>(in.size()); i += chunk) {
+    int32_t n = std::min<int32_t>(chunk, in.size() - i);
+    bool flush = i + n == static_cast<int32_t>(in.size());
+    resampler->Resample(in.data() + i, n, flush, &tmp);
+    out.insert(out.end(), tmp.begin(), tmp.end());
+  }
+  double elapsed_seconds = Seconds(start);
+
+  if (out.size() != expected.size()) {
+    fprintf(stderr, "%d -> %d: expected %d samples, given %d\n",
+            in_sample_rate, out_sample_rate,
+            static_cast<int32_t>(expected.size()),
+            static_cast<int32_t>(out.size()));
+    return false;
+  }
+
+  float max_diff = 0;
+  for (int32_t i = 0; i != static_cast<int32_t>(out.size()); ++i) {
+    max_diff = std::max(max_diff, std::abs(out[i] - expected[i]));
+  }
+
+  fprintf(stderr,
+          "%5d -> %d: %.0f input samples/s, %.0fx real time, "
+          "max abs difference: %g, "
+          "constructor: %.3f ms (first), %.3f ms (cached)\n",
+          in_sample_rate, out_sample_rate, in.size() / elapsed_seconds,
+          num_seconds / elapsed_seconds, max_diff, create_seconds * 1e3,
+          create_again_seconds * 1e3);
+
+  return max_diff == 0;
+}
+
 int32_t main(int32_t argc, char *argv[]) {
   const char *kUsage = R"(
 Usage:
 
+  ./bin/test-resample
+
+It resamples 60 seconds of noise from 8 kHz, 44.1 kHz and 48 kHz to 16 kHz
+and reports the throughput.
+
   ./bin/test-resample in.raw in_sample_rate out.raw out_sample_rate
 
 where
@@ -50,6 +135,20 @@ You can compare the number of samples in in.wav and out.wav.
 Also, you can play a.wav and b.wav.
 
   )";
+  if (argc == 1) {
+    bool ok = true;
+    for (int32_t in_sample_rate : {8000, 44100, 48000}) {
+      ok = Benchmark(in_sample_rate, 60) && ok;
+    }
+
+    if (!ok) {
+      fprintf(stderr, "Failed!\n");
+      return -1;
+    }
+
+    return 0;
+  }
+
   if (argc != 5) {
     fprintf(stderr, "%s", kUsage);
     exit(-1);
@@ -81,12 +180,7 @@ Also, you can play a.wav and b.wav.
     in_float[i] = p[i] / 32768.0f;
   }
 
-  float min_freq = std::min(in_sample_rate, out_sample_rate);
-  float lowpass_cutoff = 0.99 * 0.5 * min_freq;
-
-  int32_t lowpass_filter_width = 6;
-  sherpa_ncnn::LinearResample resampler(in_sample_rate, out_sample_rate,
-                                        lowpass_cutoff, lowpass_filter_width);
+  auto resampler = CreateResampler(in_sample_rate, out_sample_rate);
 
   // simulate streaming
   int32_t chunk = 100;
@@ -97,13 +191,13 @@ Also, you can play a.wav and b.wav.
   int32_t start = 0;
   for (start = 0; start + chunk < num_samples; start += chunk) {
     std::vector<float> tmp;
-    resampler.Resample(q, chunk, false, &tmp);
+    resampler->Resample(q, chunk, false, &tmp);
     out_float.insert(out_float.end(), tmp.begin(), tmp.end());
     q += chunk;
   }
 
   std::vector<float> tmp;
-  resampler.Resample(q, num_samples - start, true, &tmp);
+  resampler->Resample(q, num_samples - start, true, &tmp);
   out_float.insert(out_float.end(), tmp.begin(), tmp.end());
 
   std::vector<int16_t> out_short(out_float.size());
@@ -0,0 +1,111 @@
+// sherpa-ncnn/csrc/test-spsc-sample-queue.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// A producer thread pushes a known sequence of samples in small blocks,
+// like an audio callback, while a consumer thread pops them. It checks that
+// every sample arrives exactly once and in order, and reports the
+// throughput.
+//
+// Usage:
+//
+//  ./bin/test-spsc-sample-queue [num_samples]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "sherpa-ncnn/csrc/spsc-sample-queue.h"
+
+int32_t main(int32_t argc, char *argv[]) {
+  int64_t num_samples = argc > 1 ? atoll(argv[1]) : 50000000;
+
+  // 1 second at 16 kHz. The values are exactly representable as floats.
+  sherpa_ncnn::SpscSampleQueue queue(16000);
+
+  std::atomic<bool> done{false};
+  int64_t num_retries = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread producer([&]() {
+    // 10 ms blocks
+    std::vector<float> block(160);
+    int64_t next = 0;
+    while (next < num_samples) {
+      int32_t n = static_cast<int32_t>(
+          std::min<int64_t>(block.size(), num_samples - next));
+      for (int32_t i = 0; i != n; ++i) {
+        block[i] = static_cast<float>((next + i) % (1 << 24));
+      }
+
+      int32_t k = 0;
+      while (k < n) {
+        int32_t m = queue.Push(block.data() + k, n - k);
+        if (m == 0) {
+          ++num_retries;
+          std::this_thread::yield();
+        }
+        k += m;
+      }
+      next += n;
+    }
+    done = true;
+  });
+
+  std::vector<float> buffer(4000);
+  int64_t expected = 0;
+  bool ok = true;
+  while (expected < num_samples) {
+    int32_t n = queue.Pop(buffer.data(), buffer.size());
+    if (n == 0) {
+      if (done && queue.Size() == 0 && expected < num_samples) {
+        // The producer has finished but some samples are missing
+        ok = false;
+        break;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+
+    for (int32_t i = 0; i != n; ++i, ++expected) {
+      if (buffer[i] != static_cast<float>(expected % (1 << 24))) {
+        fprintf(stderr, "Sample %lld: expected %f, given %f\n",
+                static_cast<long long>(expected),  // NOLINT
+                static_cast<float>(expected % (1 << 24)), buffer[i]);
+        ok = false;
+        break;
+      }
+    }
+
+    if (!ok) {
+      break;
+    }
+  }
+
+  producer.join();
+
+  auto stop = std::chrono::steady_clock::now();
+  float elapsed_seconds =
+      std::chrono::duration_cast<std::chrono::microseconds>(stop - start)
+          .count() /
+      1e6f;
+
+  if (!ok || queue.Size() != 0) {
+    fprintf(stderr, "Failed!\n");
+    return -1;
+  }
+
+  fprintf(stderr, "num_samples: %lld, elapsed: %.3f s, %.1f M samples/s\n",
+          static_cast<long long>(num_samples),  // NOLINT
+          elapsed_seconds, num_samples / elapsed_seconds / 1e6);
+  fprintf(stderr, "producer found the queue full %lld times\n",
+          static_cast<long long>(num_retries));  // NOLINT
+
+  return 0;
+}
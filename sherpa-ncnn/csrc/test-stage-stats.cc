@@ -0,0 +1,126 @@
+// sherpa-ncnn/csrc/test-stage-stats.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Check the percentiles, the counts recorded from several threads and the
+// exclusion of nested stages of StageStats, and report the cost of a
+// ScopedStageTimer when the stats are enabled and disabled.
+//
+// Usage:
+//
+//  ./bin/test-stage-stats
+
+#include <stdio.h>
+
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "sherpa-ncnn/csrc/stage-stats.h"
+
+using sherpa_ncnn::ScopedStageTimer;
+using sherpa_ncnn::Stage;
+using sherpa_ncnn::StageStats;
+using sherpa_ncnn::StageSummary;
+
+static StageSummary Get(const StageStats &stats, Stage stage) {
+  return stats.GetSummary()[static_cast<int32_t>(stage)];
+}
+
+static bool TestPercentiles() {
+  // 1, 2, ..., 1000 microseconds
+  StageStats stats;
+  for (int32_t i = 1; i <= 1000; ++i) {
+    stats.Record(Stage::kEncoder, i * 1000);
+  }
+
+  StageSummary s = Get(stats, Stage::kEncoder);
+  fprintf(stderr, "p50: %.4f ms, p90: %.4f ms, p99: %.4f ms, max: %.4f ms\n",
+          s.p50_ms, s.p90_ms, s.p99_ms, s.max_ms);
+
+  return s.count == 1000 && std::abs(s.mean_ms - 0.5005) < 1e-6 &&
+         std::abs(s.p50_ms - 0.5) < 0.5 * 0.125 &&
+         std::abs(s.p90_ms - 0.9) < 0.9 * 0.125 &&
+         std::abs(s.p99_ms - 0.99) < 0.99 * 0.125 && s.max_ms == 1;
+}
+
+static bool TestThreads() {
+  StageStats stats;
+
+  std::vector<std::thread> threads;
+  for (int32_t t = 0; t != 4; ++t) {
+    threads.emplace_back([&stats]() {
+      for (int32_t i = 0; i != 100000; ++i) {
+        stats.Record(Stage::kJoiner, i);
+      }
+    });
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  StageSummary s = Get(stats, Stage::kJoiner);
+  return s.count == 400000 && s.max_ms == 99999 / 1e6;
+}
+
+static bool TestNesting() {
+  StageStats stats;
+  {
+    ScopedStageTimer search(&stats, Stage::kSearch);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    {
+      ScopedStageTimer joiner(&stats, Stage::kJoiner);
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  }
+
+  double search_ms = Get(stats, Stage::kSearch).total_ms;
+  double joiner_ms = Get(stats, Stage::kJoiner).total_ms;
+  fprintf(stderr, "search: %.3f ms, joiner: %.3f ms\n", search_ms, joiner_ms);
+
+  return search_ms >= 5 && search_ms < 15 && joiner_ms >= 20;
+}
+
+// Return the cost in nanoseconds of a timer
+static double TimerCost(StageStats *stats) {
+  int32_t n = 1000000;
+  auto start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i != n; ++i) {
+    ScopedStageTimer timer(stats, Stage::kDecoder);
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(stop - start).count() / n;
+}
+
+int32_t main() {
+  bool ok = true;
+
+  if (!TestPercentiles()) {
+    fprintf(stderr, "Wrong percentiles\n");
+    ok = false;
+  }
+
+  if (!TestThreads()) {
+    fprintf(stderr, "Wrong counts from several threads\n");
+    ok = false;
+  }
+
+  if (!TestNesting()) {
+    fprintf(stderr, "The nested stage is not excluded\n");
+    ok = false;
+  }
+
+  StageStats stats;
+  fprintf(stderr, "Cost of a timer: %.1f ns enabled, %.1f ns disabled\n",
+          TimerCost(&stats), TimerCost(nullptr));
+
+  if (!ok) {
+    fprintf(stderr, "Failed!\n");
+    return -1;
+  }
+
+  return 0;
+}
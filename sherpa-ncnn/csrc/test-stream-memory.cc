@@ -0,0 +1,187 @@
+// sherpa-ncnn/csrc/test-stream-memory.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Feed hours of synthetic audio to a single stream and check that the
+// resident set size (RSS) of the process and the memory used by the stream
+// stay flat. It also covers the renumbering of frame indexes, which happens
+// about every 3 hours of audio.
+//
+// Usage:
+//
+//  ./bin/test-stream-memory tokens.txt encoder.ncnn.param encoder.ncnn.bin
+//    decoder.ncnn.param decoder.ncnn.bin joiner.ncnn.param joiner.ncnn.bin
+//    [num_hours]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Return the RSS in MB, or -1 if it is not available on this platform.
+static float GetRssInMB() {
+#ifdef __linux__
+  FILE *fp = fopen("/proc/self/statm", "r");
+  if (!fp) {
+    return -1;
+  }
+
+  long size = 0;      // NOLINT
+  long resident = 0;  // NOLINT
+  int32_t n = fscanf(fp, "%ld %ld", &size, &resident);
+  fclose(fp);
+  if (n != 2) {
+    return -1;
+  }
+
+  return resident * static_cast<float>(sysconf(_SC_PAGESIZE)) / 1024 / 1024;
+#else
+  return -1;
+#endif
+}
+
+// One second of audio. Speech-like bursts of tones alternate with silence,
+// so that endpoints are detected from time to time.
+static void GenerateAudio(int32_t second, std::vector<float> *samples) {
+  const float kPi = 3.14159265358979f;
+  int32_t sample_rate = samples->size();
+  bool silence = (second / 3) % 4 == 3;
+  float freq = 200 + 50 * (second % 7);
+
+  for (int32_t i = 0; i != sample_rate; ++i) {
+    if (silence) {
+      (*samples)[i] = 0;
+      continue;
+    }
+
+    float t = static_cast<float>(i) / sample_rate;
+    float envelope = 0.5f + 0.5f * std::sin(2 * kPi * 3 * t);
+    (*samples)[i] = 0.1f * envelope *
+                    (std::sin(2 * kPi * freq * t) +
+                     0.5f * std::sin(2 * kPi * 2.5f * freq * t));
+  }
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  if (argc != 8 && argc != 9) {
+    fprintf(stderr, "Usage: %s tokens.txt encoder.param encoder.bin ",
+            argv[0]);
+    fprintf(stderr,
+            "decoder.param decoder.bin joiner.param joiner.bin "
+            "[num_hours]\n");
+    return -1;
+  }
+
+  sherpa_ncnn::RecognizerConfig config;
+  config.model_config.tokens = argv[1];
+  config.model_config.encoder_param = argv[2];
+  config.model_config.encoder_bin = argv[3];
+  config.model_config.decoder_param = argv[4];
+  config.model_config.decoder_bin = argv[5];
+  config.model_config.joiner_param = argv[6];
+  config.model_config.joiner_bin = argv[7];
+  config.model_config.use_vulkan_compute = false;
+  config.enable_endpoint = true;
+
+  float num_hours = argc == 9 ? atof(argv[8]) : 4;
+
+  sherpa_ncnn::Recognizer recognizer(config);
+  if (!recognizer.GetModel()) {
+    fprintf(stderr, "Failed to create the model\n");
+    return -1;
+  }
+
+  auto s = recognizer.CreateStream();
+
+  int32_t sample_rate = 16000;
+  std::vector<float> samples(sample_rate);
+
+  int32_t num_seconds = static_cast<int32_t>(num_hours * 3600);
+  int32_t warmup_seconds = 600;
+
+  float warmup_rss = 0;
+  float max_rss = 0;
+  int64_t warmup_stream_bytes = 0;
+  int64_t max_stream_bytes = 0;
+  int32_t num_endpoints = 0;
+
+  fprintf(stderr, "%10s %10s %15s %15s\n", "minutes", "RSS (MB)",
+          "stream (bytes)", "endpoints");
+
+  for (int32_t sec = 0; sec != num_seconds; ++sec) {
+    GenerateAudio(sec, &samples);
+    s->AcceptWaveform(sample_rate, samples.data(), samples.size());
+
+    while (recognizer.IsReady(s.get())) {
+      recognizer.DecodeStream(s.get());
+    }
+
+    if (recognizer.IsEndpoint(s.get())) {
+      recognizer.GetResult(s.get());
+      recognizer.Reset(s.get());
+      ++num_endpoints;
+    }
+
+    if ((sec + 1) % 60 != 0) {
+      continue;
+    }
+
+    float rss = GetRssInMB();
+    int64_t stream_bytes = s->GetMemoryUsage().Total();
+
+    if (sec + 1 == warmup_seconds) {
+      warmup_rss = rss;
+      warmup_stream_bytes = stream_bytes;
+    } else if (sec + 1 > warmup_seconds) {
+      max_rss = std::max(max_rss, rss);
+      max_stream_bytes = std::max(max_stream_bytes, stream_bytes);
+    }
+
+    if ((sec + 1) % 600 == 0) {
+      fprintf(stderr, "%10d %10.2f %15lld %15d\n", (sec + 1) / 60, rss,
+              static_cast<long long>(stream_bytes),  // NOLINT
+              num_endpoints);
+    }
+  }
+
+  if (num_seconds <= warmup_seconds) {
+    fprintf(stderr, "Please use more than %d minutes of audio\n",
+            warmup_seconds / 60);
+    return -1;
+  }
+
+  fprintf(stderr, "RSS after warm up: %.2f MB, max: %.2f MB\n", warmup_rss,
+          max_rss);
+  fprintf(stderr, "Stream after warm up: %lld bytes, max: %lld bytes\n",
+          static_cast<long long>(warmup_stream_bytes),  // NOLINT
+          static_cast<long long>(max_stream_bytes));    // NOLINT
+
+  // Allow some slack for the heap
+  float max_rss_growth_mb = 16;
+  if (warmup_rss > 0 && max_rss > warmup_rss + max_rss_growth_mb) {
+    fprintf(stderr, "RSS grows by more than %.0f MB!\n", max_rss_growth_mb);
+    return -1;
+  }
+
+  // A stream holds at most one utterance of results and a few chunks of
+  // features
+  int64_t max_stream_growth = 4 * 1024 * 1024;
+  if (max_stream_bytes > warmup_stream_bytes + max_stream_growth) {
+    fprintf(stderr, "Stream memory grows by more than %lld bytes!\n",
+            static_cast<long long>(max_stream_growth));  // NOLINT
+    return -1;
+  }
+
+  fprintf(stderr, "OK\n");
+
+  return 0;
+}
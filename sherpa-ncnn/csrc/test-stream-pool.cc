@@ -0,0 +1,188 @@
+// sherpa-ncnn/csrc/test-stream-pool.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+// Compare the stream churn rate of CreateStream() and destroying the stream
+// with that of AcquireStream() and ReleaseStream(), and check that a
+// recycled stream gives the same result as a fresh one.
+//
+// Usage:
+//
+//  ./bin/test-stream-pool tokens.txt encoder.ncnn.param encoder.ncnn.bin
+//    decoder.ncnn.param decoder.ncnn.bin joiner.ncnn.param joiner.ncnn.bin
+//    [num_streams]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+// Create num_streams streams one after another. Each stream accepts
+// num_samples samples and decodes them if decode is true.
+//
+// Return the number of streams per second.
+template <typename Acquire, typename Release>
+static float Run(const sherpa_ncnn::Recognizer &recognizer,
+                 int32_t num_streams, const std::vector<float> &samples,
+                 bool decode, Acquire acquire, Release release) {
+  auto start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i != num_streams; ++i) {
+    std::unique_ptr<sherpa_ncnn::Stream> s = acquire();
+    if (decode) {
+      s->AcceptWaveform(16000, samples.data(), samples.size());
+      s->InputFinished();
+      while (recognizer.IsReady(s.get())) {
+        recognizer.DecodeStream(s.get());
+      }
+      recognizer.GetResult(s.get());
+    }
+    release(std::move(s));
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  float elapsed_seconds =
+      std::chrono::duration_cast<std::chrono::microseconds>(stop - start)
+          .count() /
+      1e6f;
+
+  return num_streams / elapsed_seconds;
+}
+
+// Decode the samples with the given stream
+static sherpa_ncnn::RecognitionResult Decode(
+    const sherpa_ncnn::Recognizer &recognizer, sherpa_ncnn::Stream *s,
+    const std::vector<float> &samples) {
+  s->AcceptWaveform(16000, samples.data(), samples.size());
+
+  std::vector<float> tail_paddings(4800);
+  s->AcceptWaveform(16000, tail_paddings.data(), tail_paddings.size());
+  s->InputFinished();
+
+  while (recognizer.IsReady(s)) {
+    recognizer.DecodeStream(s);
+  }
+
+  return recognizer.GetResult(s);
+}
+
+// Return true if a stream that has decoded other samples and is returned
+// to the pool gives the same result on samples as a fresh stream.
+static bool CheckRecycledStream(const sherpa_ncnn::Recognizer &recognizer,
+                                const std::vector<float> &samples) {
+  auto fresh = recognizer.CreateStream();
+  sherpa_ncnn::RecognitionResult expected =
+      Decode(recognizer, fresh.get(), samples);
+
+  // Leave the states, results and memory pools of the stream dirty with
+  // longer audio before it is recycled
+  std::vector<float> other(samples.size() * 3);
+  for (size_t i = 0; i != other.size(); ++i) {
+    other[i] = samples[(i * 31) % samples.size()] * 10;
+  }
+
+  auto s = recognizer.AcquireStream();
+  Decode(recognizer, s.get(), other);
+  sherpa_ncnn::Stream *p = s.get();
+  recognizer.ReleaseStream(std::move(s));
+
+  s = recognizer.AcquireStream();
+  if (s.get() != p) {
+    fprintf(stderr, "The stream is not recycled\n");
+    return false;
+  }
+
+  sherpa_ncnn::RecognitionResult r = Decode(recognizer, s.get(), samples);
+  recognizer.ReleaseStream(std::move(s));
+
+  if (r.text != expected.text || r.tokens != expected.tokens ||
+      r.timestamps != expected.timestamps) {
+    fprintf(stderr, "A recycled stream gives a different result\n");
+    fprintf(stderr, "fresh: %s\nrecycled: %s\n", expected.ToString().c_str(),
+            r.ToString().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  if (argc != 8 && argc != 9) {
+    fprintf(stderr, "Usage: %s tokens.txt encoder.param encoder.bin ",
+            argv[0]);
+    fprintf(stderr,
+            "decoder.param decoder.bin joiner.param joiner.bin "
+            "[num_streams]\n");
+    return -1;
+  }
+
+  sherpa_ncnn::RecognizerConfig config;
+  config.model_config.tokens = argv[1];
+  config.model_config.encoder_param = argv[2];
+  config.model_config.encoder_bin = argv[3];
+  config.model_config.decoder_param = argv[4];
+  config.model_config.decoder_bin = argv[5];
+  config.model_config.joiner_param = argv[6];
+  config.model_config.joiner_bin = argv[7];
+  config.model_config.use_vulkan_compute = false;
+
+  int32_t num_threads = 1;
+  config.model_config.encoder_opt.num_threads = num_threads;
+  config.model_config.decoder_opt.num_threads = num_threads;
+  config.model_config.joiner_opt.num_threads = num_threads;
+
+  int32_t num_streams = argc == 9 ? atoi(argv[8]) : 1000;
+
+  sherpa_ncnn::Recognizer recognizer(config);
+  if (!recognizer.GetModel()) {
+    fprintf(stderr, "Failed to create the model\n");
+    return -1;
+  }
+
+  // 0.5 seconds of low-level noise
+  std::vector<float> samples(8000);
+  for (size_t i = 0; i != samples.size(); ++i) {
+    samples[i] = ((i * 7919) % 200) / 100000.0f - 0.001f;
+  }
+
+  if (!CheckRecycledStream(recognizer, samples)) {
+    fprintf(stderr, "Failed!\n");
+    return -1;
+  }
+
+  auto create = [&recognizer]() { return recognizer.CreateStream(); };
+  auto destroy = [](std::unique_ptr<sherpa_ncnn::Stream> s) {};
+
+  auto acquire = [&recognizer]() { return recognizer.AcquireStream(); };
+  auto release = [&recognizer](std::unique_ptr<sherpa_ncnn::Stream> s) {
+    recognizer.ReleaseStream(std::move(s));
+  };
+
+  fprintf(stderr, "num_streams: %d, num_threads: %d\n", num_streams,
+          num_threads);
+  fprintf(stderr, "%-20s %20s %20s\n", "", "create/destroy (/s)",
+          "acquire/release (/s)");
+
+  for (bool decode : {false, true}) {
+    int32_t n = decode ? num_streams / 10 + 1 : num_streams;
+
+    // warm up
+    Run(recognizer, 2, samples, decode, create, destroy);
+    Run(recognizer, 2, samples, decode, acquire, release);
+
+    float create_rate = Run(recognizer, n, samples, decode, create, destroy);
+    float acquire_rate =
+        Run(recognizer, n, samples, decode, acquire, release);
+
+    fprintf(stderr, "%-20s %20.1f %20.1f\n",
+            decode ? "decode 0.5s" : "empty stream", create_rate,
+            acquire_rate);
+  }
+
+  return 0;
+}
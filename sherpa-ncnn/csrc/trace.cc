@@ -0,0 +1,244 @@
+// sherpa-ncnn/csrc/trace.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/trace.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace sherpa_ncnn {
+
+namespace internal {
+std::atomic<bool> g_tracing{false};
+}  // namespace internal
+
+namespace {
+
+struct TraceSpan {
+  const char *name;
+  const char *category;
+  int64_t begin_ns;
+  int64_t end_ns;
+};
+
+// Spans are stored in blocks of this size, so they are never moved
+constexpr int32_t kBlockSize = 4096;
+
+// Maximum number of spans of a thread in a session. Later spans are
+// dropped. It is 32 MB.
+constexpr int64_t kMaxSpansPerThread = 1 << 20;
+
+struct ThreadBuffer {
+  int32_t tid = 0;
+
+  // Owned by the thread while busy is true. The other threads access them
+  // only when tracing is off and busy is false.
+  std::vector<std::unique_ptr<TraceSpan[]>> blocks;
+  int64_t num_spans = 0;
+  int64_t num_dropped = 0;
+
+  // true while the thread is adding a span
+  std::atomic<bool> busy{false};
+
+  // Guarded by Registry::mutex
+  std::string name;
+  bool exited = false;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  int32_t next_tid = 1;
+  int64_t begin_ns = 0;
+};
+
+// It is never freed, since threads may still exit after main() returns
+Registry &GetRegistry() {
+  static Registry *registry = new Registry;
+  return *registry;
+}
+
+// The buffer of a thread is kept after the thread exits, so that its spans
+// can be written by StopTracing(). It is freed by the next StartTracing().
+struct ThreadBufferHolder {
+  ThreadBuffer *buffer = nullptr;
+
+  ~ThreadBufferHolder() {
+    if (buffer) {
+      Registry &registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      buffer->exited = true;
+    }
+  }
+};
+
+thread_local ThreadBufferHolder t_holder;
+
+ThreadBuffer *GetThreadBuffer() {
+  if (!t_holder.buffer) {
+    Registry &registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->tid = registry.next_tid++;
+    buffer->name = "thread " + std::to_string(buffer->tid);
+
+    t_holder.buffer = buffer.get();
+    registry.buffers.push_back(std::move(buffer));
+  }
+
+  return t_holder.buffer;
+}
+
+// Turn tracing off and wait for the threads that are adding a span.
+// The caller holds registry.mutex.
+void StopWriters(Registry *registry) {
+  // It pairs with the stores and loads of AddTraceSpan(): either a thread
+  // sees that tracing is off, or we see that it is busy.
+  internal::g_tracing.store(false);
+
+  for (const auto &buffer : registry->buffers) {
+    while (buffer->busy.load()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void WriteJsonString(FILE *fp, const std::string &s) {
+  fputc('"', fp);
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      fputc('\\', fp);
+      fputc(c, fp);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      fprintf(fp, "\\u%04x", c);
+    } else {
+      fputc(c, fp);
+    }
+  }
+  fputc('"', fp);
+}
+
+}  // namespace
+
+void StartTracing() {
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  StopWriters(&registry);
+
+  auto it = std::remove_if(
+      registry.buffers.begin(), registry.buffers.end(),
+      [](const std::unique_ptr<ThreadBuffer> &b) { return b->exited; });
+  registry.buffers.erase(it, registry.buffers.end());
+
+  for (auto &buffer : registry.buffers) {
+    buffer->blocks.clear();
+    buffer->num_spans = 0;
+    buffer->num_dropped = 0;
+  }
+
+  registry.begin_ns = TraceNowNs();
+  internal::g_tracing.store(true);
+}
+
+bool StopTracing(const std::string &filename) {
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  StopWriters(&registry);
+
+  FILE *fp = fopen(filename.c_str(), "w");
+  if (!fp) {
+    return false;
+  }
+
+  fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  fprintf(fp,
+          "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+          "\"args\": {\"name\": \"sherpa-ncnn\"}}");
+
+  for (const auto &buffer : registry.buffers) {
+    if (buffer->num_spans == 0 && buffer->num_dropped == 0) {
+      continue;
+    }
+
+    fprintf(fp,
+            ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": %d, \"args\": {\"name\": ",
+            buffer->tid);
+    WriteJsonString(fp, buffer->name);
+    fprintf(fp, ", \"dropped_spans\": %lld}}",
+            static_cast<long long>(buffer->num_dropped));  // NOLINT
+
+    for (int64_t i = 0; i != buffer->num_spans; ++i) {
+      const TraceSpan &span = buffer->blocks[i / kBlockSize][i % kBlockSize];
+      if (span.begin_ns < registry.begin_ns) {
+        // It was started before this session
+        continue;
+      }
+
+      fprintf(fp, ",\n{\"name\": ");
+      WriteJsonString(fp, span.name);
+      fprintf(fp, ", \"cat\": ");
+      WriteJsonString(fp, span.category);
+      fprintf(fp,
+              ", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, "
+              "\"tid\": %d}",
+              (span.begin_ns - registry.begin_ns) / 1e3,
+              (span.end_ns - span.begin_ns) / 1e3, buffer->tid);
+    }
+  }
+
+  fprintf(fp, "\n]}\n");
+
+  return fclose(fp) == 0;
+}
+
+void SetTraceThreadName(const std::string &name) {
+  ThreadBuffer *buffer = GetThreadBuffer();
+
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  buffer->name = name + " " + std::to_string(buffer->tid);
+}
+
+int64_t TraceNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void AddTraceSpan(const char *name, const char *category, int64_t begin_ns,
+                  int64_t end_ns) {
+  if (!IsTracing()) {
+    return;
+  }
+
+  ThreadBuffer *buffer = GetThreadBuffer();
+
+  buffer->busy.store(true);
+  if (internal::g_tracing.load()) {
+    if (buffer->num_spans == kMaxSpansPerThread) {
+      ++buffer->num_dropped;
+    } else {
+      int64_t k = buffer->num_spans % kBlockSize;
+      if (k == 0) {
+        buffer->blocks.emplace_back(new TraceSpan[kBlockSize]);
+      }
+
+      buffer->blocks.back()[k] = {name, category, begin_ns, end_ns};
+      ++buffer->num_spans;
+    }
+  }
+  buffer->busy.store(false, std::memory_order_release);
+}
+
+}  // namespace sherpa_ncnn
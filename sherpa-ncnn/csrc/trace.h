@@ -0,0 +1,83 @@
+// sherpa-ncnn/csrc/trace.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_TRACE_H_
+#define SHERPA_NCNN_CSRC_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace sherpa_ncnn {
+
+// A timeline of the work done by all threads of the process, e.g., the
+// feature extraction, the encoder chunks and the joiner calls of each
+// stream, VAD windows and TTS stages.
+//
+// Usage:
+//
+//   StartTracing();
+//   ... decode ...
+//   StopTracing("trace.json");
+//
+// and open trace.json with https://ui.perfetto.dev or chrome://tracing.
+//
+// Each thread records its spans to its own buffer without locking.
+// StartTracing() and StopTracing() must not be called concurrently.
+
+// Start recording spans. The spans of a previous session are discarded.
+void StartTracing();
+
+// Stop recording and write the spans in the Chrome trace event format to
+// the given file. Return false if the file cannot be written.
+bool StopTracing(const std::string &filename);
+
+namespace internal {
+extern std::atomic<bool> g_tracing;
+}  // namespace internal
+
+inline bool IsTracing() {
+  return internal::g_tracing.load(std::memory_order_relaxed);
+}
+
+// Name the calling thread in the trace, e.g., "search-pipeline".
+// It can be called before StartTracing().
+void SetTraceThreadName(const std::string &name);
+
+// Nanoseconds of a monotonic clock
+int64_t TraceNowNs();
+
+// Record a span of the calling thread. It does nothing if IsTracing() is
+// false. name and category are not copied, so they are usually string
+// literals.
+void AddTraceSpan(const char *name, const char *category, int64_t begin_ns,
+                  int64_t end_ns);
+
+// Record the scope as a span. It costs a relaxed atomic load if tracing
+// is off.
+class ScopedTraceSpan {
+ public:
+  explicit ScopedTraceSpan(const char *name, const char *category = "asr")
+      : name_(name),
+        category_(category),
+        begin_ns_(IsTracing() ? TraceNowNs() : 0) {}
+
+  ~ScopedTraceSpan() {
+    if (begin_ns_) {
+      AddTraceSpan(name_, category_, begin_ns_, TraceNowNs());
+    }
+  }
+
+  ScopedTraceSpan(const ScopedTraceSpan &) = delete;
+  ScopedTraceSpan &operator=(const ScopedTraceSpan &) = delete;
+
+ private:
+  const char *name_;
+  const char *category_;
+  int64_t begin_ns_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_TRACE_H_
@@ -23,6 +23,7 @@
 
 #include "sherpa-ncnn/csrc/circular-buffer.h"
 #include "sherpa-ncnn/csrc/silero-vad-model.h"
+#include "sherpa-ncnn/csrc/trace.h"
 
 namespace sherpa_ncnn {
 
@@ -71,6 +72,7 @@ class VoiceActivityDetector::Impl {
     for (int32_t i = 0; i < k; ++i, p += window_shift) {
       buffer_.Push(p, window_shift);
       // NOTE(fangjun): Please don't use a very large n.
+      ScopedTraceSpan span("vad_window", "vad");
       bool this_window_is_speech = model_->IsSpeech(p, window_size);
       is_speech = is_speech || this_window_is_speech;
     }
@@ -31,6 +31,12 @@ void PybindDecoder(py::module *m) {
            py::arg("num_active_paths"))
       .def_readwrite("method", &PyClass::method)
       .def_readwrite("num_active_paths", &PyClass::num_active_paths)
+      .def_readwrite("decoder_out_cache_size",
+                     &PyClass::decoder_out_cache_size)
+      .def_readwrite("greedy_batch_frames", &PyClass::greedy_batch_frames)
+      .def_readwrite("max_chunks_per_decode",
+                     &PyClass::max_chunks_per_decode)
+      .def_readwrite("pipeline", &PyClass::pipeline)
       .def("__str__", &PyClass::ToString);
 }
 
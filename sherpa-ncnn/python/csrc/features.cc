@@ -36,6 +36,8 @@ void PybindFeatures(py::module *m) {
            py::arg("sampling_rate"), py::arg("feature_dim"))
       .def_readwrite("sampling_rate", &PyClass::sampling_rate)
       .def_readwrite("feature_dim", &PyClass::feature_dim)
+      .def_readwrite("audio_queue_size", &PyClass::audio_queue_size)
+      .def_readwrite("fast_fbank", &PyClass::fast_fbank)
       .def("__str__", &PyClass::ToString);
 }
 
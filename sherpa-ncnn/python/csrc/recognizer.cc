@@ -76,22 +76,57 @@ static void PybindRecognizerConfig(py::module *m) {
       .def_readwrite("endpoint_config", &PyClass::endpoint_config)
       .def_readwrite("enable_endpoint", &PyClass::enable_endpoint)
       .def_readwrite("hotwords_file", &PyClass::hotwords_file)
-      .def_readwrite("hotwords_score", &PyClass::hotwords_score);
+      .def_readwrite("hotwords_score", &PyClass::hotwords_score)
+      .def_readwrite("enable_stats", &PyClass::enable_stats)
+      .def_readwrite("max_pooled_streams", &PyClass::max_pooled_streams);
+}
+
+static void PybindStageStats(py::module *m) {
+  {
+    using PyClass = StageSummary;
+    py::class_<PyClass>(*m, "StageSummary")
+        .def_property_readonly("name",
+                               [](const PyClass &self) -> std::string {
+                                 return self.name;
+                               })
+        .def_readonly("count", &PyClass::count)
+        .def_readonly("total_ms", &PyClass::total_ms)
+        .def_readonly("mean_ms", &PyClass::mean_ms)
+        .def_readonly("p50_ms", &PyClass::p50_ms)
+        .def_readonly("p90_ms", &PyClass::p90_ms)
+        .def_readonly("p99_ms", &PyClass::p99_ms)
+        .def_readonly("max_ms", &PyClass::max_ms);
+  }
+
+  using PyClass = StageStats;
+  py::class_<PyClass>(*m, "StageStats")
+      .def("get_summary", &PyClass::GetSummary)
+      .def("reset", &PyClass::Reset)
+      .def("__str__", &PyClass::ToString);
 }
 
 void PybindRecognizer(py::module *m) {
   PybindRecognitionResult(m);
   PybindRecognizerConfig(m);
+  PybindStageStats(m);
 
   using PyClass = Recognizer;
   py::class_<PyClass>(*m, "Recognizer")
       .def(py::init<const RecognizerConfig &>(), py::arg("config"))
       .def("create_stream", &PyClass::CreateStream)
       .def("decode_stream", &PyClass::DecodeStream, py::arg("s"))
+      .def(
+          "decode_streams",
+          [](const PyClass &self, std::vector<Stream *> &ss) {
+            self.DecodeStreams(ss.data(), static_cast<int32_t>(ss.size()));
+          },
+          py::arg("ss"))
       .def("is_ready", &PyClass::IsReady, py::arg("s"))
       .def("reset", &PyClass::Reset, py::arg("s"))
       .def("is_endpoint", &PyClass::IsEndpoint, py::arg("s"))
-      .def("get_result", &PyClass::GetResult, py::arg("s"));
+      .def("get_result", &PyClass::GetResult, py::arg("s"))
+      .def_property_readonly("stage_stats", &PyClass::GetStageStats,
+                             py::return_value_policy::reference_internal);
 }
 
 }  // namespace sherpa_ncnn
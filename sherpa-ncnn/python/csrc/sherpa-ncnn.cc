@@ -27,6 +27,7 @@
 #include "sherpa-ncnn/python/csrc/offline-tts.h"
 #include "sherpa-ncnn/python/csrc/recognizer.h"
 #include "sherpa-ncnn/python/csrc/stream.h"
+#include "sherpa-ncnn/python/csrc/trace.h"
 
 namespace sherpa_ncnn {
 
@@ -45,6 +46,8 @@ PYBIND11_MODULE(_sherpa_ncnn, m) {
   PybindAlsa(&m);
 
   PybindOfflineTts(&m);
+
+  PybindTrace(&m);
 }
 
 }  // namespace sherpa_ncnn
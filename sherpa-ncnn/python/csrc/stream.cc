@@ -24,7 +24,18 @@
 
 namespace sherpa_ncnn {
 
+static void PybindStreamMemoryUsage(py::module *m) {
+  using PyClass = StreamMemoryUsage;
+  py::class_<PyClass>(*m, "StreamMemoryUsage")
+      .def_readonly("feature_bytes", &PyClass::feature_bytes)
+      .def_readonly("state_bytes", &PyClass::state_bytes)
+      .def_readonly("result_bytes", &PyClass::result_bytes)
+      .def_property_readonly("total", &PyClass::Total);
+}
+
 void PybindStream(py::module *m) {
+  PybindStreamMemoryUsage(m);
+
   using PyClass = Stream;
   py::class_<PyClass>(*m, "Stream")
       .def(
@@ -34,8 +45,19 @@ void PybindStream(py::module *m) {
             self.AcceptWaveform(sample_rate, waveform.data(), waveform.size());
           },
           py::call_guard<py::gil_scoped_release>())
+      .def(
+          "accept_waveform_offline",
+          [](PyClass &self, float sample_rate,
+             const std::vector<float> &waveform, int32_t num_threads) {
+            self.AcceptWaveformOffline(sample_rate, waveform.data(),
+                                       waveform.size(), num_threads);
+          },
+          py::arg("sample_rate"), py::arg("waveform"),
+          py::arg("num_threads") = 1,
+          py::call_guard<py::gil_scoped_release>())
       .def("input_finished", &PyClass::InputFinished,
-           py::call_guard<py::gil_scoped_release>());
+           py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("memory_usage", &PyClass::GetMemoryUsage);
 }
 
 }  // namespace sherpa_ncnn
@@ -0,0 +1,32 @@
+// sherpa-ncnn/python/csrc/trace.cc
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#include "sherpa-ncnn/python/csrc/trace.h"
+
+#include <string>
+
+#include "sherpa-ncnn/csrc/trace.h"
+
+namespace sherpa_ncnn {
+
+static constexpr const char *kStopTracingDoc = R"doc(
+Stop recording and write the spans of all threads since start_tracing()
+in the Chrome trace event format. Open the file with
+https://ui.perfetto.dev or chrome://tracing.
+
+Args:
+  filename:
+    Path to the JSON file.
+Returns:
+  Return False if the file cannot be written.
+)doc";
+
+void PybindTrace(py::module *m) {
+  m->def("start_tracing", &StartTracing,
+         "Start recording a timeline of the recognizer, VAD and TTS work "
+         "of all threads");
+  m->def("stop_tracing", &StopTracing, py::arg("filename"), kStopTracingDoc);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,16 @@
+// sherpa-ncnn/python/csrc/trace.h
+//
+// Copyright (c)  2026  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_PYTHON_CSRC_TRACE_H_
+#define SHERPA_NCNN_PYTHON_CSRC_TRACE_H_
+
+#include "sherpa-ncnn/python/csrc/sherpa-ncnn.h"
+
+namespace sherpa_ncnn {
+
+void PybindTrace(py::module *m);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_PYTHON_CSRC_TRACE_H_
@@ -6,6 +6,8 @@ from sherpa_ncnn.lib._sherpa_ncnn import (
     OfflineTtsConfig,
     OfflineTts,
     TtsArgs,
+    start_tracing,
+    stop_tracing,
 )
 
 from .recognizer import Recognizer
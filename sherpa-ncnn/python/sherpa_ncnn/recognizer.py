@@ -93,6 +93,7 @@ class Recognizer(object):
         model_sample_rate: int = 16000,
         hotwords_file: str = "",
         hotwords_score: float = 1.5,
+        enable_stats: bool = False,
     ):
         """
         Please refer to
@@ -153,6 +154,9 @@ class Recognizer(object):
           hotwords_score:
             The scale applied to hotwords score. Used only
             when hotwords_file is not empty.
+          enable_stats:
+            True to record the latency of each stage of decoding.
+            See :attr:`stage_stats`.
         """
         _assert_file_exists(tokens)
         _assert_file_exists(encoder_param)
@@ -203,6 +207,7 @@ class Recognizer(object):
             hotwords_file=hotwords_file,
             hotwords_score=hotwords_score,
         )
+        self.config.enable_stats = enable_stats
 
         self.sample_rate = self.config.feat_config.sampling_rate
 
@@ -249,6 +254,13 @@ class Recognizer(object):
     def timestamps(self):
         return self.recognizer.get_result(self.stream).timestamps
 
+    @property
+    def stage_stats(self):
+        """Latency histograms of the stages of decoding, or None if
+        enable_stats is False. ``print(recognizer.stage_stats)`` prints
+        them as a table."""
+        return self.recognizer.stage_stats
+
     @property
     def is_endpoint(self):
         return self.recognizer.is_endpoint(self.stream)
@@ -29,7 +29,7 @@ static_assert(sizeof(SherpaNcnnFeatureExtractorConfig) == 4 * 2, "");
 static_assert(sizeof(SherpaNcnnModelConfig) == 4 * 9, "");
 static_assert(sizeof(SherpaNcnnDecoderConfig) == 4 * 2, "");
 static_assert(sizeof(SherpaNcnnRecognizerConfig) ==
-                  4 * 2 + 4 * 9 + 4 * 2 + 4 * 4 + 4 * 2,
+                  4 * 2 + 4 * 9 + 4 * 2 + 4 * 4 + 4 * 3,
               "");
 
 void CopyHeap(const char *src, int32_t num_bytes, char *dst) {
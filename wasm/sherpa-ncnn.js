@@ -122,7 +122,7 @@ function initSherpaNcnnRecognizerConfig(config, Module) {
   let decoderConfig = initSherpaNcnnDecoderConfig(config.decoderConfig, Module);
 
   let numBytes =
-      featConfig.len + modelConfig.len + decoderConfig.len + 4 * 4 + 4 * 2;
+      featConfig.len + modelConfig.len + decoderConfig.len + 4 * 4 + 4 * 3;
 
   let ptr = Module._malloc(numBytes);
   let offset = 0;
@@ -160,6 +160,9 @@ function initSherpaNcnnRecognizerConfig(config, Module) {
       ptr + offset, config.hotwordsScore || 0.5, 'float');  // hotwords_score
   offset += 4;
 
+  Module.setValue(ptr + offset, config.enableStats || 0, 'i32');
+  offset += 4;
+
   return {
     ptr: ptr, len: numBytes, featConfig: featConfig, modelConfig: modelConfig,
         decoderConfig: decoderConfig, buffer: buffer,